@@ -0,0 +1,90 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+// Per-edge kernels used inside the RoSy and PoSy passes. Inputs are gathered
+// from the synthetic graph up front so only the kernel itself is timed.
+
+#include "SyntheticGraph.h"
+#include <PoSy/PoSy.h>
+#include <RoSy/RoSy.h>
+#include <benchmark/benchmark.h>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace {
+  const float RHO = 0.05f;
+
+  struct EdgeEnd {
+    Eigen::Vector3f vertex;
+    Eigen::Vector3f normal;
+    Eigen::Vector3f tangent;
+    Eigen::Vector3f orth_tangent;
+    Eigen::Vector3f lattice_vertex;
+  };
+
+  EdgeEnd
+  edge_end(const std::shared_ptr<Surfel> &surfel, unsigned int frame_idx) {
+    EdgeEnd end;
+    surfel->get_vertex_tangent_normal_for_frame(frame_idx, end.vertex, end.tangent, end.normal);
+    end.orth_tangent = end.normal.cross(end.tangent);
+    end.lattice_vertex = surfel->reference_lattice_vertex_in_frame(frame_idx, RHO);
+    return end;
+  }
+
+  /*
+   * Collect both ends of every edge in the first frame they share.
+   */
+  std::vector<std::pair<EdgeEnd, EdgeEnd>>
+  edge_ends(const SurfelGraphPtr &graph) {
+    using namespace std;
+
+    vector<pair<EdgeEnd, EdgeEnd>> ends;
+    ends.reserve(graph->num_edges());
+    for (const auto &edge: graph->edges()) {
+      const auto &from = edge.from()->data();
+      const auto &to = edge.to()->data();
+      for (const auto frame_idx: from->frames()) {
+        if (to->is_in_frame(frame_idx)) {
+          ends.emplace_back(edge_end(from, frame_idx), edge_end(to, frame_idx));
+          break;
+        }
+      }
+    }
+    return ends;
+  }
+}
+
+static void
+BM_BestRoSyVectorPair(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  const auto ends = edge_ends(graph);
+
+  for (auto _: state) {
+    for (const auto &e: ends) {
+      unsigned short k_ij, k_ji;
+      auto best = best_rosy_vector_pair(e.first.tangent, e.first.normal, k_ij,
+                                        e.second.tangent, e.second.normal, k_ji);
+      benchmark::DoNotOptimize(best);
+    }
+  }
+  set_throughput_counters(state, graph->num_nodes(), ends.size());
+}
+BENCHMARK(BM_BestRoSyVectorPair)->Apply(synthetic_graph_sizes);
+
+static void
+BM_ComputeClosestLatticePoints(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  const auto ends = edge_ends(graph);
+
+  for (auto _: state) {
+    for (const auto &e: ends) {
+      auto closest = compute_closest_lattice_points(
+          e.first.vertex, e.first.normal, e.first.tangent, e.first.orth_tangent, e.first.lattice_vertex,
+          e.second.vertex, e.second.normal, e.second.tangent, e.second.orth_tangent, e.second.lattice_vertex,
+          RHO);
+      benchmark::DoNotOptimize(closest);
+    }
+  }
+  set_throughput_counters(state, graph->num_nodes(), ends.size());
+}
+BENCHMARK(BM_ComputeClosestLatticePoints)->Apply(synthetic_graph_sizes);
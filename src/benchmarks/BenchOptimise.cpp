@@ -0,0 +1,119 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+// Whole-graph optimisation passes: one RoSy pass, one PoSy pass and the
+// smoothness computation which runs after every pass.
+
+#include "SyntheticGraph.h"
+#include <Properties/Properties.h>
+#include <RoSy/RoSyOptimiser.h>
+#include <Surfel/MultiResolutionSurfelGraph.h>
+#include <Tools/FieldOptimiser.h>
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace {
+  const float RHO = 0.05f;
+
+  /*
+   * Make an optimiser for the given graph which has already stepped past
+   * initialisation and level set up so that each call to optimise_once()
+   * performs exactly one smoothing pass.
+   */
+  std::unique_ptr<FieldOptimiser>
+  make_field_optimiser(const SurfelGraphPtr &graph,
+                       FieldOptimiser::SolveMode mode,
+                       std::default_random_engine &rng) {
+    using namespace std;
+
+    // The optimiser registers its own trace logger; replace any left by a previous run.
+    spdlog::drop("optimiser");
+    auto optimiser = unique_ptr<FieldOptimiser>(new FieldOptimiser(rng, numeric_limits<int>::max(), RHO));
+    spdlog::get("optimiser")->set_level(spdlog::level::warn);
+
+    optimiser->set_mode(mode);
+    optimiser->set_graph(make_shared<MultiResolutionSurfelGraph>(graph, rng));
+    optimiser->optimise_once(); // optimise_begin
+    optimiser->optimise_once(); // start_level
+    return optimiser;
+  }
+
+  void
+  bench_field_optimiser_pass(benchmark::State &state, FieldOptimiser::SolveMode mode) {
+    const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+    std::default_random_engine rng{123};
+    auto optimiser = make_field_optimiser(graph, mode, rng);
+
+    for (auto _: state) {
+      optimiser->optimise_once();
+    }
+    set_throughput_counters(state, graph->num_nodes(), graph->num_edges());
+  }
+
+  /*
+   * compute_smoothness is only reachable from within the optimiser hierarchy
+   * so expose it here.
+   */
+  class SmoothnessProbe : public RoSyOptimiser {
+   public:
+    SmoothnessProbe(const Properties &properties, std::default_random_engine &rng)
+        : RoSyOptimiser{properties, rng} //
+    {}
+
+    float smoothness() {
+      float mean_smoothness;
+      compute_smoothness(mean_smoothness, std::vector<float>(m_num_frames, 0.0f));
+      return mean_smoothness;
+    }
+  };
+
+  Properties
+  rosy_properties() {
+    using namespace std;
+    return Properties{
+        map<string, string>{
+            {"rosy-termination-criteria", "fixed"},
+            {"rosy-term-crit-max-iterations", "1"},
+            {"rosy-damping-factor", "0.0"},
+            {"rosy-weight-for-error", "false"},
+            {"rosy-weight-for-error-steps", "1000"},
+            {"rosy-vote-for-best-k", "false"},
+            {"rosy-surfel-selection-algorithm", "select-all-in-random-order"},
+            {"trace-smoothing", "false"},
+        }
+    };
+  }
+}
+
+static void
+BM_RoSyPass(benchmark::State &state) {
+  bench_field_optimiser_pass(state, FieldOptimiser::ROSY);
+}
+BENCHMARK(BM_RoSyPass)->Apply(synthetic_graph_sizes);
+
+static void
+BM_PoSyPass(benchmark::State &state) {
+  bench_field_optimiser_pass(state, FieldOptimiser::POSY);
+}
+BENCHMARK(BM_PoSyPass)->Apply(synthetic_graph_sizes);
+
+static void
+BM_ComputeSmoothness(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  std::default_random_engine rng{123};
+
+  spdlog::drop("rosy-optimiser");
+  SmoothnessProbe probe{rosy_properties(), rng};
+  spdlog::get("rosy-optimiser")->set_level(spdlog::level::warn);
+  probe.set_data(graph);
+
+  for (auto _: state) {
+    benchmark::DoNotOptimize(probe.smoothness());
+  }
+  set_throughput_counters(state, graph->num_nodes(), graph->num_edges());
+}
+BENCHMARK(BM_ComputeSmoothness)->Apply(synthetic_graph_sizes);
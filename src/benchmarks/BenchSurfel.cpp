@@ -0,0 +1,97 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+// Graph construction, hierarchy generation and surfel graph file IO.
+
+#include "SyntheticGraph.h"
+#include <Surfel/MultiResolutionSurfelGraph.h>
+#include <Surfel/Surfel_Compute.h>
+#include <Surfel/Surfel_IO.h>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace {
+  std::string
+  scratch_file_name(benchmark::State &state) {
+    return "bench_surfel_graph_" + std::to_string(state.range(0)) + "_" + std::to_string(state.range(1)) + ".bin";
+  }
+}
+
+/*
+ * generate_new_level_additive is private; generating a two level hierarchy
+ * runs it exactly once over the input graph.
+ */
+static void
+BM_GenerateNewLevelAdditive(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  std::default_random_engine rng{123};
+
+  for (auto _: state) {
+    MultiResolutionSurfelGraph mrg{graph, rng};
+    mrg.generate_levels(2);
+    benchmark::DoNotOptimize(mrg[1]);
+  }
+  set_throughput_counters(state, graph->num_nodes(), graph->num_edges());
+}
+BENCHMARK(BM_GenerateNewLevelAdditive)->Apply(synthetic_graph_sizes);
+
+/*
+ * graph_from_surfels tests every pair of surfels, so it is capped at 10,000
+ * surfels and 10 frames; the full matrix's largest cases would never finish.
+ */
+static void
+pairwise_graph_sizes(benchmark::internal::Benchmark *b) {
+  for (const auto num_surfels: {1000, 10000}) {
+    for (const auto num_frames: {1, 10}) {
+      b->Args({num_surfels, num_frames});
+    }
+  }
+  b->ArgNames({"surfels", "frames"});
+  b->Unit(benchmark::kMillisecond);
+}
+
+static void
+BM_GraphFromSurfels(benchmark::State &state) {
+  clear_synthetic_graph_cache();
+  auto surfels = make_synthetic_surfels(state.range(0), state.range(1));
+  size_t num_edges = 0;
+
+  for (auto _: state) {
+    auto graph = graph_from_surfels(surfels, true);
+    num_edges = graph->num_edges();
+    benchmark::DoNotOptimize(graph);
+  }
+  set_throughput_counters(state, surfels.size(), num_edges);
+}
+BENCHMARK(BM_GraphFromSurfels)->Apply(pairwise_graph_sizes);
+
+static void
+BM_SaveSurfelGraph(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  const auto file_name = scratch_file_name(state);
+
+  for (auto _: state) {
+    save_surfel_graph_to_file(file_name, graph, true, true);
+  }
+  std::remove(file_name.c_str());
+  set_throughput_counters(state, graph->num_nodes(), graph->num_edges());
+}
+BENCHMARK(BM_SaveSurfelGraph)->Apply(synthetic_graph_sizes);
+
+static void
+BM_LoadSurfelGraph(benchmark::State &state) {
+  const auto &graph = cached_synthetic_graph(state.range(0), state.range(1));
+  const auto file_name = scratch_file_name(state);
+  save_surfel_graph_to_file(file_name, graph, true, true);
+  std::default_random_engine rng{123};
+
+  for (auto _: state) {
+    auto loaded = load_surfel_graph_from_file(file_name, rng);
+    benchmark::DoNotOptimize(loaded);
+  }
+  std::remove(file_name.c_str());
+  set_throughput_counters(state, graph->num_nodes(), graph->num_edges());
+}
+BENCHMARK(BM_LoadSurfelGraph)->Apply(synthetic_graph_sizes);
@@ -0,0 +1,162 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "SyntheticGraph.h"
+#include <Surfel/SurfelBuilder.h>
+#include <Eigen/Geometry>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+
+namespace {
+  const float GRID_SPACING = 0.01f;
+  const float RIPPLE_AMPLITUDE = 0.02f;
+  const unsigned int FRAME_BAND_WIDTH = 32;
+
+  unsigned int
+  grid_width(unsigned int num_surfels) {
+    return (unsigned int) std::ceil(std::sqrt((double) num_surfels));
+  }
+
+  /*
+   * First frame in which the surfel at grid position x, y is visible.
+   * Bands of surfels move through the window together so that grid neighbours
+   * almost always share frames.
+   */
+  unsigned int
+  first_frame(unsigned int x, unsigned int y, unsigned int num_frames, unsigned int frames_per_surfel) {
+    const auto num_starts = num_frames - frames_per_surfel + 1;
+    return ((x / FRAME_BAND_WIDTH) + (y / FRAME_BAND_WIDTH)) % num_starts;
+  }
+
+  bool
+  share_a_frame(const std::shared_ptr<Surfel> &s1, const std::shared_ptr<Surfel> &s2) {
+    const auto &f1 = s1->frames();
+    const auto &f2 = s2->frames();
+    return !(f1.back() < f2.front() || f2.back() < f1.front());
+  }
+}
+
+std::vector<std::shared_ptr<Surfel>>
+make_synthetic_surfels(unsigned int num_surfels, unsigned int num_frames) {
+  using namespace std;
+  using namespace Eigen;
+
+  default_random_engine rng{123};
+  uniform_real_distribution<float> unit{0.0f, 1.0f};
+  SurfelBuilder sb{rng};
+
+  const auto width = grid_width(num_surfels);
+  const auto frames_per_surfel = min(num_frames, MAX_FRAMES_PER_SURFEL);
+
+  vector<shared_ptr<Surfel>> surfels;
+  surfels.reserve(num_surfels);
+  for (unsigned int i = 0; i < num_surfels; ++i) {
+    const auto x = i % width;
+    const auto y = i / width;
+    const auto theta = unit(rng) * 2.0f * (float) M_PI;
+
+    sb.reset()
+        ->with_id("s" + to_string(i))
+        ->with_tangent(cos(theta), 0.0f, sin(theta))
+        ->with_reference_lattice_offset(unit(rng), unit(rng));
+
+    const auto start = first_frame(x, y, num_frames, frames_per_surfel);
+    for (unsigned int f = start; f < start + frames_per_surfel; ++f) {
+      // Height field h = A sin(x + phase) with a phase that advances each frame.
+      const auto phase = (float) x * GRID_SPACING * 20.0f + (float) f * 0.3f;
+      const auto h = RIPPLE_AMPLITUDE * sin(phase);
+      const auto dh_dx = RIPPLE_AMPLITUDE * 20.0f * cos(phase);
+      Vector3f position{(float) x * GRID_SPACING, h, (float) y * GRID_SPACING};
+      Vector3f normal = Vector3f{-dh_dx, 1.0f, 0.0f}.normalized();
+      sb.with_frame({x, y, f}, 1.0f + h, normal, position);
+    }
+    surfels.emplace_back(make_shared<Surfel>(sb.build()));
+  }
+  return surfels;
+}
+
+SurfelGraphPtr
+make_synthetic_graph(const std::vector<std::shared_ptr<Surfel>> &surfels) {
+  using namespace std;
+
+  auto graph = make_shared<SurfelGraph>();
+  vector<SurfelGraphNodePtr> nodes;
+  nodes.reserve(surfels.size());
+  for (const auto &surfel: surfels) {
+    nodes.emplace_back(graph->add_node(surfel));
+  }
+
+  const auto num_surfels = (unsigned int) surfels.size();
+  const auto width = grid_width(num_surfels);
+  for (unsigned int i = 0; i < num_surfels; ++i) {
+    const auto x = i % width;
+    const auto y = i / width;
+
+    // Connect to the right, below and both lower diagonals; earlier rows already link to us.
+    const int offsets[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+    for (const auto &offset: offsets) {
+      const int nx = (int) x + offset[0];
+      const int ny = (int) y + offset[1];
+      if (nx < 0 || nx >= (int) width) {
+        continue;
+      }
+      const auto j = (unsigned int) (ny * (int) width + nx);
+      if (j >= num_surfels) {
+        continue;
+      }
+      if (!share_a_frame(surfels[i], surfels[j])) {
+        continue;
+      }
+      graph->add_edge(nodes[i], nodes[j], SurfelGraphEdge{1.0f});
+    }
+  }
+  return graph;
+}
+
+namespace {
+  std::map<std::pair<unsigned int, unsigned int>, SurfelGraphPtr> &
+  graph_cache() {
+    static std::map<std::pair<unsigned int, unsigned int>, SurfelGraphPtr> cache;
+    return cache;
+  }
+}
+
+const SurfelGraphPtr &
+cached_synthetic_graph(unsigned int num_surfels, unsigned int num_frames) {
+  auto &cache = graph_cache();
+  const auto key = std::make_pair(num_surfels, num_frames);
+  auto it = cache.find(key);
+  if (it == cache.end()) {
+    // Only keep one size alive at a time; the largest graphs run to gigabytes.
+    cache.clear();
+    it = cache.emplace(key, make_synthetic_graph(make_synthetic_surfels(num_surfels, num_frames))).first;
+  }
+  return it->second;
+}
+
+void
+clear_synthetic_graph_cache() {
+  graph_cache().clear();
+}
+
+void
+synthetic_graph_sizes(benchmark::internal::Benchmark *b) {
+  for (const auto num_surfels: {10000, 100000, 1000000}) {
+    for (const auto num_frames: {1, 10, 100}) {
+      b->Args({num_surfels, num_frames});
+    }
+  }
+  b->ArgNames({"surfels", "frames"});
+  b->Unit(benchmark::kMillisecond);
+}
+
+void
+set_throughput_counters(benchmark::State &state, size_t num_nodes, size_t num_edges) {
+  state.counters["nodes/s"] = benchmark::Counter(
+      (double) num_nodes * (double) state.iterations(), benchmark::Counter::kIsRate);
+  state.counters["edges/s"] = benchmark::Counter(
+      (double) num_edges * (double) state.iterations(), benchmark::Counter::kIsRate);
+}
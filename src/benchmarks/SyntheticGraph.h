@@ -0,0 +1,62 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include <Surfel/Surfel.h>
+#include <Surfel/SurfelGraph.h>
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+/**
+ * Maximum number of frames in which any one synthetic surfel is visible.
+ * Surfels are seen in a sliding window of frames, as they would be in a capture,
+ * so memory stays proportional to the surfel count rather than surfels x frames.
+ */
+const unsigned int MAX_FRAMES_PER_SURFEL = 3;
+
+/**
+ * Generate num_surfels surfels laid out on a square grid in the XZ plane.
+ * Each surfel is visible in up to MAX_FRAMES_PER_SURFEL of num_frames frames and
+ * the surface ripples from frame to frame so that normals vary.
+ * Tangents and lattice offsets are seeded so that runs are repeatable.
+ */
+std::vector<std::shared_ptr<Surfel>>
+make_synthetic_surfels(unsigned int num_surfels, unsigned int num_frames);
+
+/**
+ * Build an 8-connected grid graph over surfels made by make_synthetic_surfels.
+ * Neighbouring surfels are only connected if they share at least one frame.
+ */
+SurfelGraphPtr
+make_synthetic_graph(const std::vector<std::shared_ptr<Surfel>> &surfels);
+
+/**
+ * Return a synthetic graph for the given size, building it on first use.
+ * The graph is cached so that fixture construction is not timed and is shared
+ * by every benchmark that reads but does not modify it. Only the most recently
+ * requested size is kept; asking for another size frees it.
+ */
+const SurfelGraphPtr &
+cached_synthetic_graph(unsigned int num_surfels, unsigned int num_frames);
+
+/**
+ * Free the graph held by cached_synthetic_graph, if any. Called by benchmarks
+ * that build their own graphs so the cached one doesn't sit in memory alongside.
+ */
+void
+clear_synthetic_graph_cache();
+
+/**
+ * Register the standard matrix of surfel counts x frame counts as benchmark arguments.
+ */
+void
+synthetic_graph_sizes(benchmark::internal::Benchmark *b);
+
+/**
+ * Report nodes/s and edges/s for work over the given graph size per iteration.
+ */
+void
+set_throughput_counters(benchmark::State &state, size_t num_nodes, size_t num_edges);
@@ -1,9 +1,44 @@
 #include <ostream>
 #include <string>
+#include <memory>
+#include <vector>
 #include <Eigen/Core>
 
 #pragma once
 
+/**
+ * Unit ray directions from the camera origin through the centre of every pixel
+ * of a width x height image. Held as planes: all x components in row major
+ * order, then all y and then all z.
+ */
+class RayTable {
+public:
+    RayTable(unsigned int width, unsigned int height);
+
+    inline unsigned int width() const { return m_width; }
+
+    inline unsigned int height() const { return m_height; }
+
+    inline const float *x_plane() const { return m_directions.data(); }
+
+    inline const float *y_plane() const { return m_directions.data() + m_plane_size; }
+
+    inline const float *z_plane() const { return m_directions.data() + 2 * m_plane_size; }
+
+    inline Eigen::Vector3f direction(unsigned int x, unsigned int y) const {
+        const auto i = (size_t) y * m_width + x;
+        return {m_directions[i], m_directions[m_plane_size + i], m_directions[2 * m_plane_size + i]};
+    }
+
+private:
+    friend class Camera;
+
+    unsigned int m_width;
+    unsigned int m_height;
+    size_t m_plane_size;
+    std::vector<float> m_directions;
+};
+
 class Camera {
 public:
     Camera() = default;
@@ -25,6 +60,14 @@ public:
 
     Eigen::Vector3f to_world_coordinates(unsigned int pixel_x, unsigned int pixel_y, float depth) const;
 
+    /**
+     * Unit ray directions for every pixel of a width x height image, so that pixel (x, y)
+     * at depth d back-projects to origin() + d * direction(x, y), exactly as to_world_coordinates.
+     * The table is built on first use and kept until the camera is moved, re-aimed or resized
+     * or a table for a different size is requested. Safe to call from several threads.
+     */
+    std::shared_ptr<const RayTable> ray_table(unsigned int width, unsigned int height) const;
+
     /**
      * Get the camera matrix
      */
@@ -73,6 +116,13 @@ private:
     Eigen::Vector3f n;
     Eigen::Vector3f u;
     Eigen::Vector3f v;
+    // Cached by ray_table(); only accessed through std::atomic_load/atomic_store
+    mutable std::shared_ptr<const RayTable> m_ray_table;
+
+    /**
+     * Unit direction of the ray from the camera origin through the centre of the given pixel.
+     */
+    Eigen::Vector3f ray_direction(unsigned int pixel_x, unsigned int pixel_y) const;
 
     /**
      * Construct an eye coordinate system
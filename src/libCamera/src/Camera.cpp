@@ -2,6 +2,7 @@
 #include <string>
 #include <fstream>
 #include <cmath>
+#include <atomic>
 #include <Eigen/Geometry>
 #include <Camera/Camera.h>
 
@@ -77,6 +78,9 @@ Camera::compute_camera_parms() {
 
     image_plane_dimensions.x() = image_plane_width;
     image_plane_dimensions.y() = image_plane_height;
+
+    // Any cached rays were for the old geometry
+    std::atomic_store(&m_ray_table, std::shared_ptr<const RayTable>{});
 }
 
 
@@ -235,20 +239,59 @@ std::ostream
 }
 
 /*
- * Compute the backprojection of a point from X,Y and depth in world space
+ * Compute the direction of the ray from the camera origin through the centre of a pixel
  */
 Eigen::Vector3f
-Camera::to_world_coordinates(unsigned int pixel_x, unsigned int pixel_y, float depth) const {
+Camera::ray_direction(unsigned int pixel_x, unsigned int pixel_y) const {
     using namespace Eigen;
 
     // Get world coordinates of pixel through which the ray passes
-   Vector3f pixelCoordinate = image_plane_origin
+    Vector3f pixelCoordinate = image_plane_origin
                                + ((pixel_x + 0.5) * pixel_width * u)
                                + ((pixel_y + 0.5) * pixel_height * v);
+    return (pixelCoordinate - m_origin).normalized();
+}
+
+/*
+ * Compute the backprojection of a point from X,Y and depth in world space
+ */
+Eigen::Vector3f
+Camera::to_world_coordinates(unsigned int pixel_x, unsigned int pixel_y, float depth) const {
+    // Project the ray to the depth expected to give the final world coordinate of the projected point
+    return m_origin + (ray_direction(pixel_x, pixel_y) * depth);
+}
+
+RayTable::RayTable(unsigned int width, unsigned int height) //
+        : m_width{width} //
+        , m_height{height} //
+        , m_plane_size{(size_t) width * height} //
+        , m_directions(3 * m_plane_size) //
+{}
 
-   // Now project the ray to the depth expected to give the final world coordinate of the projected point
-    Vector3f rayDirection = (pixelCoordinate - m_origin).normalized();
-    return m_origin + (rayDirection * depth);
+/*
+ * Get the ray directions for every pixel of a width x height image, building them if needed
+ */
+std::shared_ptr<const RayTable>
+Camera::ray_table(unsigned int width, unsigned int height) const {
+    auto table = std::atomic_load(&m_ray_table);
+    if (table && table->width() == width && table->height() == height) {
+        return table;
+    }
+
+    auto rays = std::make_shared<RayTable>(width, height);
+    size_t i = 0;
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x, ++i) {
+            const auto d = ray_direction(x, y);
+            rays->m_directions[i] = d.x();
+            rays->m_directions[rays->m_plane_size + i] = d.y();
+            rays->m_directions[2 * rays->m_plane_size + i] = d.z();
+        }
+    }
+    // Concurrent callers may each build a table; they are identical so the last store wins harmlessly
+    table = rays;
+    std::atomic_store(&m_ray_table, table);
+    return table;
 }
 
 /*
@@ -162,4 +162,27 @@ TEST_F(TestCamera, multiple_resolutions_yield_same_depth) {
         std::cout << "320/" << (i*16) << ": (" << wc1[i*16].x() << ", " << wc1[i*16].y() << ", "<<wc1[i*16].z() << ") " <<
                 " ,   20/" << i << ": (" << wc2[i].x() << ", " << wc2[i].y() << ", " << wc2[i].z()  << std::endl;
     }
-}
\ No newline at end of file
+}
+/* ********************************************************************************
+ * ** Test ray table
+ * ********************************************************************************/
+TEST_F(TestCamera, RayTableShouldMatchBackprojection) {
+    using namespace Eigen;
+
+    Camera camera = makeCamera();
+    const auto rays = camera.ray_table(64, 48);
+    EXPECT_EQ(64, rays->width());
+    EXPECT_EQ(48, rays->height());
+    for (unsigned int y = 0; y < 48; y += 5) {
+        for (unsigned int x = 0; x < 64; x += 7) {
+            Vector3f expected = camera.to_world_coordinates(x, y, 10.0f);
+            expect_vector_equality(camera.origin() + rays->direction(x, y) * 10.0f, expected);
+            EXPECT_FLOAT_EQ(1.0f, rays->direction(x, y).norm());
+        }
+    }
+
+    // Cached until the camera changes
+    EXPECT_EQ(rays, camera.ray_table(64, 48));
+    camera.move_to(1.0f, 0.0f, 10.0f, true);
+    EXPECT_NE(rays, camera.ray_table(64, 48));
+}
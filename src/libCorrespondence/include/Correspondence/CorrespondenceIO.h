@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 #include <Surfel/PixelInFrame.h>
+#include "PathBuilder.h"
 
 void
 load_correspondences_from_file(const std::string &file_name,
@@ -15,3 +16,24 @@ load_correspondences_from_file(const std::string &file_name,
 void
 save_correspondences_to_file(const std::string &file_name,
                              const std::vector<std::vector<PixelInFrame>> &correspondences);
+
+/**
+ * Save paths in binary: a header, the path offsets and then the entries. Every field is
+ * little-endian whatever the host, so the files move between machines.
+ */
+void
+save_paths_to_file(const std::string &file_name, const Paths &paths);
+
+/**
+ * Load paths saved by save_paths_to_file. The offsets and entries are read in bulk.
+ * @throws std::runtime_error if the file can't be read, isn't a paths file, is shorter than its
+ * header says or has offsets that decrease or run past the entries.
+ */
+Paths
+load_paths_from_file(const std::string &file_name);
+
+/**
+ * @return true if the file starts like a binary paths file.
+ */
+bool
+is_binary_paths_file(const std::string &file_name);
@@ -0,0 +1,80 @@
+/**
+ * Chain correspondences between consecutive frames into paths of points.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * One point of a path: the index of a point within a frame.
+ */
+struct PathEntry {
+  uint32_t frame;
+  uint32_t index;
+};
+
+/**
+ * A set of paths stored contiguously. The entries of path p are
+ * entries[offsets[p]] to entries[offsets[p + 1] - 1], in frame order.
+ */
+struct Paths {
+  std::vector<uint32_t> offsets{0};
+  std::vector<PathEntry> entries;
+
+  inline size_t size() const { return offsets.size() - 1; }
+
+  inline size_t path_length(size_t path) const { return offsets[path + 1] - offsets[path]; }
+
+  inline const PathEntry *begin(size_t path) const { return entries.data() + offsets[path]; }
+
+  inline const PathEntry *end(size_t path) const { return entries.data() + offsets[path + 1]; }
+};
+
+/**
+ * Builds paths from the correspondences between each frame and the next, one frame at a time.
+ * Each point of a frame either extends the path of the point in the previous frame which
+ * matched it or starts a new path. A point matched by several points of the previous frame
+ * extends the path of the one with the lowest index.
+ *
+ * Every point is an element of a union-find forest held in dense per-frame arrays. A path is
+ * the set rooted at its first point, so joining a point to a path is a single write.
+ */
+class PathBuilder {
+public:
+  /**
+   * @param num_points The number of points in frame 0.
+   */
+  explicit PathBuilder(unsigned int num_points);
+
+  /**
+   * Add the next frame.
+   * @param num_points The number of points in the new frame.
+   * @param target_for_source For each point of the previous frame, the index of the point in
+   * the new frame that it matches or -1 if it matches none.
+   */
+  void add_frame(unsigned int num_points, const std::vector<int> &target_for_source);
+
+  /**
+   * Add the next frame.
+   * @param num_points The number of points in the new frame.
+   * @param target_for_source Map from points of the previous frame to the points of the new
+   * frame they match.
+   */
+  void add_frame(unsigned int num_points, const std::map<unsigned int, unsigned int> &target_for_source);
+
+  inline unsigned int num_frames() const { return (unsigned int) m_frame_offsets.size() - 1; }
+
+  /**
+   * @return Every path spanning at least two frames, ordered by their first point.
+   */
+  Paths paths() const;
+
+private:
+  /* First element of each frame in the forest and one past the last frame */
+  std::vector<uint32_t> m_frame_offsets;
+  /* Root of each point's path. Roots are always the first point of a path. */
+  std::vector<uint32_t> m_path_root;
+};
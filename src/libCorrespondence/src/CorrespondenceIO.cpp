@@ -2,6 +2,8 @@
 // Created by Dave Durbin on 2019-07-06.
 //
 
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <Surfel/PixelInFrame.h>
 #include <GeomFileUtils/io_utils.h>
@@ -9,6 +11,59 @@
 
 #include "CorrespondenceIO.h"
 
+namespace {
+    const char PATHS_MAGIC[4] = {'A', 'P', 'T', 'H'};
+    const uint16_t PATHS_VERSION = 1;
+
+    struct PathsHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t num_paths;
+        uint32_t num_entries;
+    };
+    static_assert(sizeof(PathsHeader) == 16, "Unexpected paths header size");
+    static_assert(sizeof(PathEntry) == 2 * sizeof(uint32_t), "Path entries must be packed to read them in bulk");
+
+    bool
+    host_is_little_endian() {
+        const uint16_t one = 1;
+        uint8_t first_byte;
+        memcpy(&first_byte, &one, 1);
+        return first_byte == 1;
+    }
+
+    uint16_t
+    byte_swap(uint16_t value) {
+        return (uint16_t) ((value >> 8) | (value << 8));
+    }
+
+    uint32_t
+    byte_swap(uint32_t value) {
+        return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+    }
+
+    /* Paths files are little-endian so big-endian hosts swap every field on the way in and out */
+    void
+    byte_swap_header(PathsHeader &header) {
+        header.version = byte_swap(header.version);
+        header.reserved = byte_swap(header.reserved);
+        header.num_paths = byte_swap(header.num_paths);
+        header.num_entries = byte_swap(header.num_entries);
+    }
+
+    void
+    byte_swap_paths(Paths &paths) {
+        for (auto &offset: paths.offsets) {
+            offset = byte_swap(offset);
+        }
+        for (auto &entry: paths.entries) {
+            entry.frame = byte_swap(entry.frame);
+            entry.index = byte_swap(entry.index);
+        }
+    }
+}
+
 void
 load_correspondences_from_file(const std::string &file_name,
                                std::vector<std::vector<PixelInFrame>> &correspondences) {
@@ -65,4 +120,99 @@ save_correspondences_to_file(const std::string &file_name,
         }
     }
     file.close();
-}
\ No newline at end of file
+}
+
+void
+save_paths_to_file(const std::string &file_name, const Paths &paths) {
+    using namespace std;
+
+    spdlog::info("Saving {} paths to {:s}", paths.size(), file_name);
+
+    PathsHeader header{};
+    memcpy(header.magic, PATHS_MAGIC, sizeof(PATHS_MAGIC));
+    header.version = PATHS_VERSION;
+    header.num_paths = (uint32_t) paths.size();
+    header.num_entries = (uint32_t) paths.entries.size();
+
+    const Paths *to_write = &paths;
+    Paths swapped_paths;
+    if (!host_is_little_endian()) {
+        byte_swap_header(header);
+        swapped_paths = paths;
+        byte_swap_paths(swapped_paths);
+        to_write = &swapped_paths;
+    }
+
+    ofstream file{file_name, ios::out | ios::binary};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(to_write->offsets.data()), to_write->offsets.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(to_write->entries.data()), to_write->entries.size() * sizeof(PathEntry));
+    if (!file) {
+        throw runtime_error("Failed to write paths to " + file_name);
+    }
+}
+
+Paths
+load_paths_from_file(const std::string &file_name) {
+    using namespace std;
+
+    spdlog::info("Loading paths from {:s}", file_name);
+
+    ifstream file{file_name, ios::in | ios::binary};
+    if (file.fail()) {
+        throw runtime_error("Failed to open file " + file_name);
+    }
+
+    PathsHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || memcmp(header.magic, PATHS_MAGIC, sizeof(PATHS_MAGIC)) != 0) {
+        throw runtime_error(file_name + " is not a paths file");
+    }
+    const bool swap = !host_is_little_endian();
+    if (swap) {
+        byte_swap_header(header);
+    }
+    if (header.version != PATHS_VERSION) {
+        throw runtime_error("Unsupported paths file version " + to_string(header.version) + " in " + file_name);
+    }
+
+    // Check the counts against what's left of the file before allocating for them
+    const auto body_start = file.tellg();
+    file.seekg(0, ios::end);
+    const auto remaining = (uint64_t) (file.tellg() - body_start);
+    file.seekg(body_start);
+    const uint64_t body_size = ((uint64_t) header.num_paths + 1) * sizeof(uint32_t)
+                               + (uint64_t) header.num_entries * sizeof(PathEntry);
+    if (body_size > remaining) {
+        throw runtime_error("Paths file " + file_name + " is truncated");
+    }
+
+    Paths paths;
+    paths.offsets.resize((size_t) header.num_paths + 1);
+    paths.entries.resize(header.num_entries);
+    file.read(reinterpret_cast<char *>(paths.offsets.data()), paths.offsets.size() * sizeof(uint32_t));
+    file.read(reinterpret_cast<char *>(paths.entries.data()), paths.entries.size() * sizeof(PathEntry));
+    if (swap) {
+        byte_swap_paths(paths);
+    }
+    if (!file || paths.offsets.front() != 0 || paths.offsets.back() != header.num_entries) {
+        throw runtime_error("Paths file " + file_name + " is truncated or corrupt");
+    }
+    // Every path is read as entries[offsets[p]] to entries[offsets[p + 1]]
+    for (uint32_t path = 0; path < header.num_paths; ++path) {
+        if (paths.offsets[path] > paths.offsets[path + 1]) {
+            throw runtime_error("Paths file " + file_name + " has a decreasing offset at path " + to_string(path));
+        }
+    }
+    return paths;
+}
+
+bool
+is_binary_paths_file(const std::string &file_name) {
+    std::ifstream file{file_name, std::ios::in | std::ios::binary};
+    char magic[sizeof(PATHS_MAGIC)];
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, PATHS_MAGIC, sizeof(PATHS_MAGIC)) == 0;
+}
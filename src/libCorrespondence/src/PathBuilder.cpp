@@ -0,0 +1,100 @@
+//
+// Chain correspondences between consecutive frames into paths of points.
+//
+
+#include "PathBuilder.h"
+
+#include <stdexcept>
+#include <string>
+
+PathBuilder::PathBuilder(unsigned int num_points) //
+    : m_frame_offsets{0, num_points} //
+{
+  m_path_root.resize(num_points);
+  for (uint32_t point = 0; point < num_points; ++point) {
+    m_path_root[point] = point;
+  }
+}
+
+void
+PathBuilder::add_frame(unsigned int num_points, const std::vector<int> &target_for_source) {
+  const auto source_offset = m_frame_offsets[m_frame_offsets.size() - 2];
+  const auto num_source_points = m_frame_offsets.back() - source_offset;
+  if (target_for_source.size() != num_source_points) {
+    throw std::invalid_argument("Expected a match for each of the " + std::to_string(num_source_points)
+                                    + " points in frame " + std::to_string(num_frames() - 1));
+  }
+
+  // Every point starts its own path until a point of the previous frame claims it
+  const auto target_offset = m_frame_offsets.back();
+  m_path_root.resize(target_offset + num_points);
+  for (uint32_t point = 0; point < num_points; ++point) {
+    m_path_root[target_offset + point] = target_offset + point;
+  }
+
+  for (uint32_t source = 0; source < num_source_points; ++source) {
+    const auto target = target_for_source[source];
+    if (target < 0) {
+      continue;
+    }
+    if ((unsigned int) target >= num_points) {
+      throw std::invalid_argument("Match to point " + std::to_string(target) + " is outside frame "
+                                      + std::to_string(num_frames()));
+    }
+    auto &target_root = m_path_root[target_offset + target];
+    // Already claimed by a lower indexed point
+    if (target_root != target_offset + (uint32_t) target) {
+      continue;
+    }
+    // Sources already point straight at their root so this keeps every tree one deep
+    target_root = m_path_root[source_offset + source];
+  }
+  m_frame_offsets.push_back(target_offset + num_points);
+}
+
+void
+PathBuilder::add_frame(unsigned int num_points, const std::map<unsigned int, unsigned int> &target_for_source) {
+  const auto num_source_points = m_frame_offsets.back() - m_frame_offsets[m_frame_offsets.size() - 2];
+  std::vector<int> targets(num_source_points, -1);
+  for (const auto &match : target_for_source) {
+    targets.at(match.first) = (int) match.second;
+  }
+  add_frame(num_points, targets);
+}
+
+Paths
+PathBuilder::paths() const {
+  const auto num_points = (uint32_t) m_path_root.size();
+
+  // Count the points in each path
+  std::vector<uint32_t> path_length(num_points, 0);
+  for (uint32_t point = 0; point < num_points; ++point) {
+    ++path_length[m_path_root[point]];
+  }
+
+  // Assign ranges to paths in order of their first point, dropping single points
+  Paths paths;
+  std::vector<uint32_t> next_entry(num_points, 0);
+  for (uint32_t root = 0; root < num_points; ++root) {
+    if (path_length[root] < 2) {
+      continue;
+    }
+    next_entry[root] = paths.offsets.back();
+    paths.offsets.push_back(paths.offsets.back() + path_length[root]);
+  }
+
+  // Points are numbered frame by frame so each path fills in frame order
+  paths.entries.resize(paths.offsets.back());
+  uint32_t frame = 0;
+  for (uint32_t point = 0; point < num_points; ++point) {
+    while (point >= m_frame_offsets[frame + 1]) {
+      ++frame;
+    }
+    const auto root = m_path_root[point];
+    if (path_length[root] < 2) {
+      continue;
+    }
+    paths.entries[next_entry[root]++] = PathEntry{frame, point - m_frame_offsets[frame]};
+  }
+  return paths;
+}
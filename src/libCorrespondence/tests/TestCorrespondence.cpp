@@ -1,6 +1,12 @@
 #include "TestCorrespondence.h"
 #include <gtest/gtest.h>
 #include <Correspondence/CorrespondenceIO.h>
+#include <Correspondence/PathBuilder.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
 
 void TestCorrespondence::SetUp( ) {}
 void TestCorrespondence::TearDown() {}
@@ -10,4 +16,110 @@ void TestCorrespondence::TearDown() {}
  * ********************************************************************************/
 TEST_F( TestCorrespondence, ShouldFail ) {
     EXPECT_TRUE(false);
-}
\ No newline at end of file
+}
+/* ********************************************************************************
+ * ** Test path building
+ * ********************************************************************************/
+TEST_F( TestCorrespondence, PathBuilderShouldChainMatchesInOrder ) {
+    using namespace std;
+
+    // Frame 0 has 3 points, 1 has 3, 2 has 2
+    PathBuilder builder{3};
+    // 0->1 and 2->1 both want point 1; the lower source wins. 1 matches nothing.
+    builder.add_frame(3, vector<int>{1, -1, 1});
+    // Frame 1 point 1 (path of 0:0) -> 0, point 0 (new path) -> 1, point 2 (new path) unmatched
+    builder.add_frame(2, map<unsigned int, unsigned int>{{0, 1}, {1, 0}});
+    EXPECT_EQ(3, builder.num_frames());
+
+    const auto paths = builder.paths();
+    ASSERT_EQ(2, paths.size());
+
+    ASSERT_EQ(3, paths.path_length(0));
+    EXPECT_EQ(0, paths.begin(0)[0].frame);
+    EXPECT_EQ(0, paths.begin(0)[0].index);
+    EXPECT_EQ(1, paths.begin(0)[1].frame);
+    EXPECT_EQ(1, paths.begin(0)[1].index);
+    EXPECT_EQ(2, paths.begin(0)[2].frame);
+    EXPECT_EQ(0, paths.begin(0)[2].index);
+
+    ASSERT_EQ(2, paths.path_length(1));
+    EXPECT_EQ(1, paths.begin(1)[0].frame);
+    EXPECT_EQ(0, paths.begin(1)[0].index);
+    EXPECT_EQ(2, paths.begin(1)[1].frame);
+    EXPECT_EQ(1, paths.begin(1)[1].index);
+
+    EXPECT_THROW(builder.add_frame(1, vector<int>{0}), invalid_argument);
+}
+
+TEST_F( TestCorrespondence, PathsShouldRoundTripThroughBinaryFile ) {
+    using namespace std;
+
+    PathBuilder builder{4};
+    builder.add_frame(4, vector<int>{3, 2, 1, 0});
+    builder.add_frame(4, vector<int>{0, -1, 2, 3});
+    const auto paths = builder.paths();
+
+    const string file_name = "paths_round_trip.bin";
+    save_paths_to_file(file_name, paths);
+    EXPECT_TRUE(is_binary_paths_file(file_name));
+    const auto loaded = load_paths_from_file(file_name);
+    remove(file_name.c_str());
+
+    ASSERT_EQ(paths.offsets, loaded.offsets);
+    ASSERT_EQ(paths.entries.size(), loaded.entries.size());
+    for (size_t i = 0; i < paths.entries.size(); ++i) {
+        EXPECT_EQ(paths.entries[i].frame, loaded.entries[i].frame);
+        EXPECT_EQ(paths.entries[i].index, loaded.entries[i].index);
+    }
+}
+
+TEST_F( TestCorrespondence, PathsFileShouldBeLittleEndian ) {
+    using namespace std;
+
+    PathBuilder builder{1};
+    builder.add_frame(1, vector<int>{0});
+    const auto paths = builder.paths();
+
+    const string file_name = "paths_endian.bin";
+    save_paths_to_file(file_name, paths);
+    ifstream file{file_name, ios::in | ios::binary};
+    const vector<unsigned char> bytes{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    file.close();
+    remove(file_name.c_str());
+
+    // Header, offsets 0 and 2, then entries (0, 0) and (1, 0)
+    const vector<unsigned char> expected{
+            'A', 'P', 'T', 'H', 1, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0,
+            0, 0, 0, 0, 2, 0, 0, 0,
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0
+    };
+    EXPECT_EQ(expected, bytes);
+}
+
+TEST_F( TestCorrespondence, CorruptPathsFilesShouldBeRejected ) {
+    using namespace std;
+
+    const string file_name = "paths_corrupt.bin";
+    const auto load = [&file_name](const vector<unsigned char> &bytes) {
+        {
+            ofstream file{file_name, ios::out | ios::binary};
+            file.write(reinterpret_cast<const char *>(bytes.data()), (streamsize) bytes.size());
+        }
+        load_paths_from_file(file_name);
+    };
+
+    // Counts far beyond the file are rejected before anything is allocated for them
+    EXPECT_THROW(load({'A', 'P', 'T', 'H', 1, 0, 0, 0, 0xff, 0xff, 0xff, 0x0f, 0xff, 0xff, 0xff, 0x0f,
+                       0, 0, 0, 0}), runtime_error);
+
+    // Two paths over two entries, but the middle offset runs past the entries
+    EXPECT_THROW(load({'A', 'P', 'T', 'H', 1, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0, 0,
+                       0, 0, 0, 0, 5, 0, 0, 0, 2, 0, 0, 0,
+                       0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0}), runtime_error);
+
+    // The same file with a valid middle offset loads
+    EXPECT_NO_THROW(load({'A', 'P', 'T', 'H', 1, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0, 0,
+                          0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0,
+                          0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0}));
+    remove(file_name.c_str());
+}
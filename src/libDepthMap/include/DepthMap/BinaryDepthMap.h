@@ -0,0 +1,57 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <DepthMap/DepthMap.h>
+
+/**
+ * Binary depth map files are a 32 byte header followed by width * height
+ * row major depths in the native (little endian) byte order.
+ *
+ *   offset  size  field
+ *        0     4  magic "ADMB"
+ *        4     2  version (1)
+ *        6     2  sample type (BinaryDepthType)
+ *        8     4  width
+ *       12     4  height
+ *       16     4  scale; depth = sample * scale
+ *       20    12  reserved, zero
+ *
+ * Zero samples mean no depth, as in text depth maps.
+ */
+typedef enum {
+  BDT_FLOAT32 = 0,
+  BDT_UINT16 = 1
+} BinaryDepthType;
+
+const uint32_t BINARY_DEPTH_MAP_HEADER_SIZE = 32;
+
+/**
+ * @return true if the file starts with the binary depth map magic number.
+ */
+bool
+is_binary_depth_map(const std::string &file_name);
+
+/**
+ * Map a binary depth map into memory. float32 samples with a scale of 1 are
+ * used in place without copying; the mapping is private so changes to the
+ * depth map are never written back.
+ * Throws if the file is missing, truncated or not a binary depth map.
+ */
+DepthMap
+load_binary_depth_map(const std::string &file_name);
+
+/**
+ * Save a depth map in the binary format.
+ * For BDT_UINT16 depths are divided by scale and rounded, e.g. a scale of 0.001 stores millimetres
+ * when depths are in metres. Throws if a depth does not fit.
+ */
+void
+save_binary_depth_map(const std::string &file_name,
+                      DepthMapView depth_map,
+                      BinaryDepthType type = BDT_FLOAT32,
+                      float scale = 1.0f);
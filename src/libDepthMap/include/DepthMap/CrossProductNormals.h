@@ -19,11 +19,11 @@
  *
  *
  */
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_natural_normals(const DepthMap * const depth_map, const Camera &camera);
 
 void
-compute_derived_normals(const DepthMap * const depth_map, std::vector<std::vector<NormalWithType>>& normals);
+compute_derived_normals(const DepthMap * const depth_map, NormalImage& normals);
 
 
 #endif //ANIMESH_CROSSPRODUCTNORMALS_H
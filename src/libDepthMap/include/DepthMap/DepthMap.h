@@ -4,9 +4,16 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <memory>
 #include <Camera/Camera.h>
 #include <DepthMap/Normals.h>
 
+/**
+ * A depth map owns its depths, or shares ownership of depths held by something else
+ * such as a memory mapped file or a DepthPyramid. Depth maps can be moved but not
+ * copied; use clone() for an independent copy and DepthMapView to read depths
+ * without owning them.
+ */
 class DepthMap {
 public:
 	typedef enum {
@@ -33,7 +40,30 @@ public:
 	 * @param cols The number of columns provided.
 	 * @param depth_data a rows*cols, row major set of depths.
 	 */
-	 DepthMap(unsigned int width, unsigned int height, float * depth_data);
+	 DepthMap(unsigned int width, unsigned int height, const float * depth_data);
+
+	/**
+	 * Construct from width * height row major depths, taking ownership of them.
+	 */
+	DepthMap(unsigned int width, unsigned int height, std::vector<float> &&depth_data);
+
+	/**
+	 * Construct over depth data owned by something else, without copying it.
+	 * storage is kept alive for as long as this depth map exists.
+	 */
+	DepthMap(unsigned int width, unsigned int height, float * depth_data, std::shared_ptr<void> storage);
+
+	DepthMap(const DepthMap &) = delete;
+	DepthMap &operator=(const DepthMap &) = delete;
+
+	/** Moved from depth maps are empty. */
+	DepthMap(DepthMap &&other) noexcept;
+	DepthMap &operator=(DepthMap &&other) noexcept;
+
+	/**
+	 * @return a copy of this depth map, and its normals if computed, that owns its own depths.
+	 */
+	DepthMap clone() const;
 
 	 /** @return the height of the depth map. */
 	inline unsigned int height() const { return this->m_height;}
@@ -52,21 +82,33 @@ public:
 		return m_depth_data[index(x, y)];
 	}
 
+	/** @return the row major depths, width() * height() of them. */
+	inline const float * depth_data() const { return m_depth_data; }
+
     /**
      * Subsample a depth map and return a map that is half the size (rounded down) in each dimension.
      * Entries in the resulting map are computed from the mean of entries in this map.
+     * To build several levels at once use DepthPyramid.
      */
     DepthMap resample() const;
 
 	void cull_unreliable_depths(float ts, float tl);
-    const std::vector<std::vector<NormalWithType>> & get_normals() const;
+    /**
+     * @return the normals. Throws if compute_normals() has not been called.
+     * The image's inline accessors are unchecked, for use in hot loops.
+     */
+    const NormalImage & get_normals() const;
 	static inline bool flag_is_set( unsigned int flags, DepthMap::tDirection flag ){
         return ((flags & flag) == flag);
     }
 	bool is_normal_defined(unsigned int x, unsigned int y) const;
 
     NormalWithType normal_at(unsigned int x, unsigned int y) const;
-    void compute_normals(const Camera& camera, tNormalMethod method);
+    /**
+     * Compute normals using the given method. window_radius sets the size of the
+     * (2 * window_radius + 1) square window used by INTEGRAL and is ignored by the others.
+     */
+    void compute_normals(const Camera& camera, tNormalMethod method, unsigned int window_radius = 1);
 
 //	inline bool is_edge(unsigned int row, unsigned int col) const {
 //		return (row == 0 || row == rows() - 1 || col == 0 || col == cols() - 1);
@@ -97,12 +139,15 @@ protected:
 
 
 private:
+	// Depths allocated by this object; empty when m_storage owns them
+	std::vector<float> m_owned_depths;
+	// Owner of m_depth_data when it was not allocated by this object, e.g. a memory mapped file
+	std::shared_ptr<void> m_storage;
 	float *m_depth_data;
 	unsigned int m_width;
 	unsigned int m_height;
 
-	// row, col
-	std::vector<std::vector<NormalWithType>> normals;
+	NormalImage m_normals;
 
 	/**
 	 * Compute the index into depth_map data for a given (x,y) coordinate.
@@ -115,3 +160,34 @@ private:
     }
 
 };
+
+/**
+ * Read only access to the depths of a DepthMap, or of any width * height row major
+ * buffer, without owning them. Views are cheap to copy and are valid while the
+ * depths they view exist.
+ */
+class DepthMapView {
+public:
+	DepthMapView(unsigned int width, unsigned int height, const float *depth_data) //
+			: m_depth_data{depth_data}, m_width{width}, m_height{height} {}
+
+	DepthMapView(const DepthMap &depth_map) // NOLINT(google-explicit-constructor)
+			: m_depth_data{depth_map.depth_data()}, m_width{depth_map.width()}, m_height{depth_map.height()} {}
+
+	inline unsigned int width() const { return m_width; }
+
+	inline unsigned int height() const { return m_height; }
+
+	inline const float *depth_data() const { return m_depth_data; }
+
+	inline float depth_at(unsigned int x, unsigned int y) const {
+		assert(x < m_width);
+		assert(y < m_height);
+		return m_depth_data[(size_t) y * m_width + x];
+	}
+
+private:
+	const float *m_depth_data;
+	unsigned int m_width;
+	unsigned int m_height;
+};
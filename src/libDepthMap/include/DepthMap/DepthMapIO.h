@@ -5,14 +5,26 @@
 #ifndef ANIMESH_DEPTHMAPIO_H
 #define ANIMESH_DEPTHMAPIO_H
 
+#include <cstddef>
+#include <functional>
 #include <vector>
 #include <DepthMap/DepthMap.h>
 
+/**
+ * Load and cull the depth maps in a directory on a pool of I/O threads and hand each to the
+ * consumer, in frame order, as soon as it is ready. At most memory_ceiling bytes of depth
+ * maps are held waiting for the consumer.
+ */
+void
+for_each_depth_map(const std::string &source_directory, const std::string &depth_map_regex, float ts, float tl,
+                   const std::function<void(unsigned int, DepthMap &&)> &consume,
+                   size_t memory_ceiling);
+
 std::vector<DepthMap>
 load_depth_maps(const std::string& source_directory, const std::string & depth_map_regex, float ts, float tl);
 
 void
-save_depth_map_as_pgm(const std::string& file_name, const DepthMap& depth_map);
+save_depth_map_as_pgm(const std::string& file_name, DepthMapView depth_map);
 
 void
 save_normals_as_ppm(const std::string& file_name, const DepthMap& depth_map);
@@ -0,0 +1,49 @@
+//
+// Multi-level depth map pyramids
+//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <Camera/Camera.h>
+#include <DepthMap/DepthMap.h>
+#include <DepthMap/Normals.h>
+
+/**
+ * A depth map and successively halved copies of it, as produced by repeated calls to
+ * DepthMap::resample(), built in a single pass. Every level lives in one allocation
+ * which the level depth maps share; it is freed once the pyramid and every level
+ * moved out of it are gone.
+ */
+class DepthPyramid {
+public:
+    DepthPyramid() = default;
+
+    /**
+     * Build num_levels levels from depth_map; level 0 is a copy of it.
+     * Throws std::invalid_argument if num_levels is 0.
+     */
+    DepthPyramid(DepthMapView depth_map, unsigned int num_levels);
+
+    inline unsigned int num_levels() const { return (unsigned int) m_levels.size(); }
+
+    inline const DepthMap &level(unsigned int level) const { return m_levels.at(level); }
+
+    inline DepthMap &level(unsigned int level) { return m_levels.at(level); }
+
+    /**
+     * Compute the normals of every level, each seen by camera resized to that level.
+     */
+    void compute_normals(const Camera &camera, tNormalMethod method, unsigned int window_radius = 1);
+
+private:
+    std::shared_ptr<float> m_data;
+    std::vector<DepthMap> m_levels;
+};
+
+/**
+ * Build a pyramid for each depth map, several frames at a time.
+ */
+std::vector<DepthPyramid>
+build_depth_pyramids(const std::vector<DepthMap> &depth_maps, unsigned int num_levels);
@@ -0,0 +1,22 @@
+//
+// Normals from windowed covariance computed with integral images
+//
+
+#ifndef ANIMESH_INTEGRALNORMALS_H
+#define ANIMESH_INTEGRALNORMALS_H
+
+#include <DepthMap/Normals.h>
+#include <DepthMap/DepthMap.h>
+#include <Camera/Camera.h>
+
+/**
+ * Compute normals as the direction of least variance of the back-projected points in a
+ * (2 * window_radius + 1) square window around each pixel with depth. Window sums come
+ * from integral images so the cost per pixel does not depend on the window size.
+ * Pixels with fewer than three points in their window have no normal.
+ * Normals face the camera.
+ */
+NormalImage
+compute_normals_from_integral_images(const DepthMap *depth_map, const Camera &camera, unsigned int window_radius);
+
+#endif //ANIMESH_INTEGRALNORMALS_H
@@ -5,6 +5,11 @@
 #ifndef ANIMESH_NORMALS_H
 #define ANIMESH_NORMALS_H
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 class DepthMap;
 
 typedef enum {
@@ -16,7 +21,8 @@ typedef enum {
 typedef enum {
     CROSS,
     PCL,
-    PLANAR
+    PLANAR,
+    INTEGRAL
 } tNormalMethod;
 
 // A normal to the depth map
@@ -28,6 +34,75 @@ struct NormalWithType {
     NormalWithType(tNormal t, float xx, float yy, float zz) : type{t}, x{xx}, y{yy}, z{zz} {};
 };
 
+/**
+ * Normals for every pixel of a depth map held as planes rather than structs:
+ * one row major buffer with all x components, then all y and then all z, plus
+ * a byte per pixel for the normal type. Pixels start with no normal.
+ * The inline accessors only assert their coordinates; use at() where the
+ * coordinates are not already known to be in range.
+ */
+class NormalImage {
+public:
+    NormalImage();
+
+    NormalImage(unsigned int width, unsigned int height);
+
+    inline unsigned int width() const { return m_width; }
+
+    inline unsigned int height() const { return m_height; }
+
+    inline bool empty() const { return m_types.empty(); }
+
+    inline tNormal type(unsigned int x, unsigned int y) const {
+        return (tNormal) m_types[index(x, y)];
+    }
+
+    inline bool is_defined(unsigned int x, unsigned int y) const {
+        return m_types[index(x, y)] != NONE;
+    }
+
+    inline float nx(unsigned int x, unsigned int y) const { return m_components[index(x, y)]; }
+
+    inline float ny(unsigned int x, unsigned int y) const { return m_components[m_plane_size + index(x, y)]; }
+
+    inline float nz(unsigned int x, unsigned int y) const { return m_components[2 * m_plane_size + index(x, y)]; }
+
+    inline NormalWithType operator()(unsigned int x, unsigned int y) const {
+        const auto i = index(x, y);
+        return {(tNormal) m_types[i], m_components[i], m_components[m_plane_size + i], m_components[2 * m_plane_size + i]};
+    }
+
+    /**
+     * @return the normal at (x, y). Throws std::out_of_range if (x, y) is outside the image.
+     */
+    NormalWithType at(unsigned int x, unsigned int y) const;
+
+    inline void set(unsigned int x, unsigned int y, tNormal type, float nx, float ny, float nz) {
+        const auto i = index(x, y);
+        m_types[i] = (uint8_t) type;
+        m_components[i] = nx;
+        m_components[m_plane_size + i] = ny;
+        m_components[2 * m_plane_size + i] = nz;
+    }
+
+    inline void set_type(unsigned int x, unsigned int y, tNormal type) {
+        m_types[index(x, y)] = (uint8_t) type;
+    }
+
+private:
+    unsigned int m_width;
+    unsigned int m_height;
+    size_t m_plane_size;
+    std::vector<float> m_components;
+    std::vector<uint8_t> m_types;
+
+    inline size_t index(unsigned int x, unsigned int y) const {
+        assert(x < m_width);
+        assert(y < m_height);
+        return (size_t) y * m_width + x;
+    }
+};
+
 void
 validate_normals(const DepthMap* depth_map);
 
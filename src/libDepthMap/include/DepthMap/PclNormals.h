@@ -14,7 +14,7 @@
  * Compute normal using estinate of normal to plane tangent to surface
  */
 
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_normals_with_pcl(DepthMap* depth_map, const Camera& camera);
 
 #endif //ANIMESH_PCLNORMALS_H
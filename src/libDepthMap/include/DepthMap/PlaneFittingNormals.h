@@ -14,7 +14,7 @@
  * Compute normal using estinate of normal to plane tangent to surface
  * using neighbours in depth map
  */
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_normals_from_neighbours(DepthMap* depth_map, const Camera& camera);
 
 #endif //ANIMESH_PLANEFITTINGNORMALS_H
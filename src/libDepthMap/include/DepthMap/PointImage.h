@@ -0,0 +1,70 @@
+//
+// Whole-frame back-projection of depth maps
+//
+
+#ifndef ANIMESH_POINTIMAGE_H
+#define ANIMESH_POINTIMAGE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include <Eigen/Core>
+#include <Camera/Camera.h>
+
+class DepthMapView;
+
+/**
+ * World coordinates of every pixel of a depth map held as planes, like NormalImage:
+ * one row major buffer with all x components, then all y and then all z.
+ * Pixels with zero depth back-project to the camera origin.
+ * The inline accessors only assert their coordinates.
+ */
+class PointImage {
+public:
+    PointImage();
+
+    PointImage(unsigned int width, unsigned int height);
+
+    inline unsigned int width() const { return m_width; }
+
+    inline unsigned int height() const { return m_height; }
+
+    inline Eigen::Vector3f operator()(unsigned int x, unsigned int y) const {
+        const auto i = index(x, y);
+        return {m_components[i], m_components[m_plane_size + i], m_components[2 * m_plane_size + i]};
+    }
+
+    inline float *x_plane() { return m_components.data(); }
+
+    inline float *y_plane() { return m_components.data() + m_plane_size; }
+
+    inline float *z_plane() { return m_components.data() + 2 * m_plane_size; }
+
+    inline const float *x_plane() const { return m_components.data(); }
+
+    inline const float *y_plane() const { return m_components.data() + m_plane_size; }
+
+    inline const float *z_plane() const { return m_components.data() + 2 * m_plane_size; }
+
+private:
+    unsigned int m_width;
+    unsigned int m_height;
+    size_t m_plane_size;
+    std::vector<float> m_components;
+
+    inline size_t index(unsigned int x, unsigned int y) const {
+        assert(x < m_width);
+        assert(y < m_height);
+        return (size_t) y * m_width + x;
+    }
+};
+
+/**
+ * Back-project every pixel of the depth map into world coordinates in a single pass
+ * over the camera's cached ray table. Each point is the same as
+ * camera.to_world_coordinates(x, y, depth_map.depth_at(x, y)).
+ */
+PointImage
+backproject(DepthMapView depth_map, const Camera &camera);
+
+#endif //ANIMESH_POINTIMAGE_H
@@ -0,0 +1,167 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "BinaryDepthMap.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char MAGIC[4] = {'A', 'D', 'M', 'B'};
+  const uint16_t VERSION = 1;
+
+  struct BinaryDepthMapHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t type;
+    uint32_t width;
+    uint32_t height;
+    float scale;
+    uint8_t reserved[12];
+  };
+  static_assert(sizeof(BinaryDepthMapHeader) == BINARY_DEPTH_MAP_HEADER_SIZE, "Unexpected binary depth map header size");
+
+  size_t
+  bytes_per_sample(uint16_t type) {
+    switch (type) {
+      case BDT_FLOAT32: return sizeof(float);
+      case BDT_UINT16: return sizeof(uint16_t);
+      default: throw std::runtime_error("Unknown binary depth map sample type " + std::to_string(type));
+    }
+  }
+
+  /*
+   * Map the whole file privately; pages are copied only if they are written to.
+   */
+  std::shared_ptr<void>
+  map_file(const std::string &file_name, size_t &file_size) {
+    const auto fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Couldn't open depth map " + file_name);
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("Couldn't stat depth map " + file_name);
+    }
+    file_size = (size_t) st.st_size;
+    if (file_size < BINARY_DEPTH_MAP_HEADER_SIZE) {
+      close(fd);
+      throw std::runtime_error("Binary depth map " + file_name + " is too short");
+    }
+    auto base = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      throw std::runtime_error("Couldn't map depth map " + file_name);
+    }
+    return {base, [file_size](void *p) { munmap(p, file_size); }};
+  }
+}
+
+bool
+is_binary_depth_map(const std::string &file_name) {
+  std::ifstream file{file_name, std::ios::in | std::ios::binary};
+  char magic[sizeof(MAGIC)];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+DepthMap
+load_binary_depth_map(const std::string &file_name) {
+  size_t file_size;
+  auto mapping = map_file(file_name, file_size);
+
+  BinaryDepthMapHeader header{};
+  memcpy(&header, mapping.get(), sizeof(header));
+  if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error(file_name + " is not a binary depth map");
+  }
+  if (header.version != VERSION) {
+    throw std::runtime_error("Unsupported binary depth map version " + std::to_string(header.version) + " in " + file_name);
+  }
+  const auto num_samples = (size_t) header.width * header.height;
+  if (file_size < BINARY_DEPTH_MAP_HEADER_SIZE + num_samples * bytes_per_sample(header.type)) {
+    throw std::runtime_error("Binary depth map " + file_name + " is truncated");
+  }
+
+  auto payload = static_cast<char *>(mapping.get()) + BINARY_DEPTH_MAP_HEADER_SIZE;
+  if (header.type == BDT_FLOAT32) {
+    auto depths = reinterpret_cast<float *>(payload);
+    if (header.scale != 1.0f) {
+      for (size_t i = 0; i < num_samples; ++i) {
+        depths[i] *= header.scale;
+      }
+    }
+    return {header.width, header.height, depths, mapping};
+  }
+
+  // Samples must be widened so the mapping is released once they're converted.
+  std::vector<float> depths(num_samples);
+  const auto samples = reinterpret_cast<const uint16_t *>(payload);
+  for (size_t i = 0; i < num_samples; ++i) {
+    depths[i] = (float) samples[i] * header.scale;
+  }
+  return {header.width, header.height, std::move(depths)};
+}
+
+void
+save_binary_depth_map(const std::string &file_name,
+                      DepthMapView depth_map,
+                      BinaryDepthType type,
+                      float scale) {
+  using namespace std;
+
+  if (scale <= 0.0f) {
+    throw runtime_error("Binary depth map scale must be positive");
+  }
+
+  BinaryDepthMapHeader header{};
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.type = type;
+  header.width = depth_map.width();
+  header.height = depth_map.height();
+  header.scale = scale;
+  const auto sample_size = bytes_per_sample(type);
+
+  // Build a row at a time so large maps don't need a second full copy
+  vector<char> row(depth_map.width() * sample_size);
+  ofstream file{file_name, ios::out | ios::binary | ios::trunc};
+  if (file.fail()) {
+    throw runtime_error("Error writing depth map " + file_name);
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (unsigned int y = 0; y < depth_map.height(); ++y) {
+    for (unsigned int x = 0; x < depth_map.width(); ++x) {
+      const auto depth = depth_map.depth_at(x, y);
+      if (type == BDT_FLOAT32) {
+        const float sample = depth / scale;
+        memcpy(&row[x * sample_size], &sample, sample_size);
+      } else {
+        const auto scaled = round(depth / scale);
+        if (scaled < 0 || scaled > numeric_limits<uint16_t>::max()) {
+          throw runtime_error("Depth " + to_string(depth) + " at (" + to_string(x) + ", " + to_string(y)
+                                  + ") doesn't fit in 16 bits with scale " + to_string(scale));
+        }
+        const auto sample = (uint16_t) scaled;
+        memcpy(&row[x * sample_size], &sample, sample_size);
+      }
+    }
+    file.write(row.data(), (streamsize) row.size());
+  }
+  if (file.fail()) {
+    throw runtime_error("Error writing depth map " + file_name);
+  }
+}
@@ -4,6 +4,7 @@
 
 #include "DepthMap.h"
 #include "Normals.h"
+#include "PointImage.h"
 #include <Camera/Camera.h>
 #include <vector>
 #include <Eigen/Geometry>
@@ -16,25 +17,24 @@
  *
  *
  */
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_natural_normals(const DepthMap * const depth_map, const Camera &camera) {
     using namespace std;
 
-    vector<vector<NormalWithType>> normals{depth_map->height() * depth_map->width()};
+    // Every pixel starts with no normal
+    NormalImage normals{depth_map->width(), depth_map->height()};
+
+    // Backproject every pixel once; each point is used by up to four neighbours
+    const auto points = backproject(*depth_map, camera);
 
     // For each row
     for (int y = 0; y < depth_map->height(); ++y) {
-
-        // Temp storage for the y's type and normals
-        vector<NormalWithType> current_row_normals;
-
         // For each column
         for (int x = 0; x < depth_map->width(); ++x) {
             float d = depth_map->depth_at(x, y);
 
             // If depth is 0 then there's no normal to be had here.
             if (d == 0.0f) {
-                current_row_normals.emplace_back(NONE, 0, 0, 0);
                 continue;
             }
 
@@ -43,39 +43,29 @@ compute_natural_normals(const DepthMap * const depth_map, const Camera &camera)
 
             // If there are not four neighbours then I have a derived normal
             if (neighbours_present != DepthMap::FOUR) {
-                current_row_normals.emplace_back(DERIVED, 0, 0, 0);
+                normals.set_type(x, y, DERIVED);
                 continue;
             }
 
-            // Backproject the depths
-            // TODO: This is super slow and we sill be calculating the same points over and over
-            // We should avoid this if possible by back projecting all points once
-
             // Otherwise I have a natural normal
-            Eigen::Vector3f a = camera.to_world_coordinates(x + 1, y, neighbour_depths[3]);
-            Eigen::Vector3f b = camera.to_world_coordinates(x - 1, y, neighbour_depths[2]);
-            Eigen::Vector3f c1 = a - b;
-            a = camera.to_world_coordinates(x, y + 1, neighbour_depths[1]);
-            b = camera.to_world_coordinates(x, y - 1, neighbour_depths[0]);
-            Eigen::Vector3f c2 = a - b;
+            Eigen::Vector3f c1 = points(x + 1, y) - points(x - 1, y);
+            Eigen::Vector3f c2 = points(x, y + 1) - points(x, y - 1);
             auto n = c1.cross(c2);
             n.normalize();
-            current_row_normals.emplace_back(NATURAL, n.x(), n.y(), n.z());
+            normals.set(x, y, NATURAL, n.x(), n.y(), n.z());
         }
-        normals.push_back(current_row_normals);
     }
     return normals;
 }
 
 void
-compute_derived_normals(const DepthMap * const depth_map, std::vector<std::vector<NormalWithType>>& normals) {
+compute_derived_normals(const DepthMap * const depth_map, NormalImage& normals) {
     using namespace std;
 
     for (size_t row = 0; row < depth_map->height(); ++row) {
         for (size_t col = 0; col < depth_map->width(); ++col) {
             // Skip existing normals
-            if (normals.at(row).at(col).type == NONE
-                || normals.at(row).at(col).type == NATURAL) {
+            if (normals.type(col, row) != DERIVED) {
                 continue;
             }
 
@@ -83,34 +73,26 @@ compute_derived_normals(const DepthMap * const depth_map, std::vector<std::vecto
             float count = 0;
             for (int ri = (int)(row - 1); ri <= row + 1; ri++) {
                 for (int ci = (int)(col - 1); ci <= col + 1; ci++) {
-                    if (ri < 0 || ri >= depth_map->width() || ci < 0 || ci >= depth_map->width()) {
-                        continue;
-                    }
-                    if (normals.at(ri).at(ci).type == NONE) {
+                    if (ri < 0 || ri >= depth_map->height() || ci < 0 || ci >= depth_map->width()) {
                         continue;
                     }
-                    if (normals.at(ri).at(ci).type == NATURAL) {
-                        float nx = normals.at(ri).at(ci).x;
-                        float ny = normals.at(ri).at(ci).y;
-                        float nz = normals.at(ri).at(ci).z;
-                        sum[0] += nx;
-                        sum[1] += ny;
-                        sum[2] += nz;
+                    if (normals.type(ci, ri) == NATURAL) {
+                        sum[0] += normals.nx(ci, ri);
+                        sum[1] += normals.ny(ci, ri);
+                        sum[2] += normals.nz(ci, ri);
                         count++;
                     }
                 }
             }
             // If count == 0; kill this one
             if (count == 0) {
-                normals.at(row).at(col).type = NONE;
+                normals.set_type(col, row, NONE);
             } else {
                 float mean_nx = sum[0] / count;
                 float mean_ny = sum[1] / count;
                 float mean_nz = sum[2] / count;
                 float l = sqrt(mean_nx * mean_nx + mean_ny * mean_ny + mean_nz * mean_nz);
-                normals.at(row).at(col).x = mean_nx / l;
-                normals.at(row).at(col).y = mean_ny / l;
-                normals.at(row).at(col).z = mean_nz / l;
+                normals.set(col, row, DERIVED, mean_nx / l, mean_ny / l, mean_nz / l);
             }
         }
     }
@@ -3,6 +3,9 @@
 #include "PclNormals.h"
 #include "CrossProductNormals.h"
 #include "PlaneFittingNormals.h"
+#include "IntegralNormals.h"
+#include "BinaryDepthMap.h"
+#include "RowBands.h"
 #include <FileUtils/FileUtils.h>
 #include <Camera/Camera.h>
 
@@ -10,11 +13,18 @@
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <spdlog/spdlog.h>
 
 DepthMap::DepthMap(const std::string &filename) {
   using namespace std;
 
+  if (is_binary_depth_map(filename)) {
+    *this = load_binary_depth_map(filename);
+    return;
+  }
+
   m_width = 0;
   m_height = 0;
 
@@ -40,7 +50,8 @@ DepthMap::DepthMap(const std::string &filename) {
                         });
   m_height = rows.size();
 
-  m_depth_data = new float[m_width * m_height];
+  m_owned_depths.resize((size_t) m_width * m_height);
+  m_depth_data = m_owned_depths.data();
   for (unsigned int y = 0; y < m_height; ++y) {
     for (unsigned int x = 0; x < m_width; ++x) {
       m_depth_data[index(x, y)] = rows.at(y).at(x);
@@ -52,20 +63,73 @@ DepthMap::DepthMap(const std::string &filename) {
  * Construct from an array of floats and dimensions
  * @param width The number of columns provided.
  * @param height The number of rows provided.
- * @param depth_data a rows*cols, row major set of depths.
+ * @param depth_data a rows*cols, row major set of depths, or nullptr for all zeroes.
  */
-DepthMap::DepthMap(unsigned int width, unsigned int height, float *depth_data) {
-  m_width = width;
-  m_height = height;
-  unsigned int num_entries = width * height;
-  m_depth_data = new float[num_entries];
+DepthMap::DepthMap(unsigned int width, unsigned int height, const float *depth_data) //
+    : m_owned_depths((size_t) width * height, 0.0f) //
+    , m_depth_data{m_owned_depths.data()} //
+    , m_width{width} //
+    , m_height{height} //
+{
   if (depth_data != nullptr) {
-    memcpy(m_depth_data, depth_data, num_entries * sizeof(float));
-  } else {
-    for (int i = 0; i < num_entries; ++i) {
-      m_depth_data[i] = 0.0f;
-    }
+    memcpy(m_depth_data, depth_data, m_owned_depths.size() * sizeof(float));
+  }
+}
+
+DepthMap::DepthMap(unsigned int width, unsigned int height, std::vector<float> &&depth_data) //
+    : m_owned_depths{std::move(depth_data)} //
+    , m_depth_data{m_owned_depths.data()} //
+    , m_width{width} //
+    , m_height{height} //
+{
+  if (m_owned_depths.size() != (size_t) width * height) {
+    throw std::invalid_argument("Expected " + std::to_string(width) + " x " + std::to_string(height)
+                                    + " depths but got " + std::to_string(m_owned_depths.size()));
+  }
+}
+
+DepthMap::DepthMap(unsigned int width, unsigned int height, float *depth_data, std::shared_ptr<void> storage) //
+    : m_storage{std::move(storage)} //
+    , m_depth_data{depth_data} //
+    , m_width{width} //
+    , m_height{height} //
+{}
+
+// Moving a vector keeps its buffer so m_depth_data stays valid
+DepthMap::DepthMap(DepthMap &&other) noexcept //
+    : m_owned_depths{std::move(other.m_owned_depths)} //
+    , m_storage{std::move(other.m_storage)} //
+    , m_depth_data{other.m_depth_data} //
+    , m_width{other.m_width} //
+    , m_height{other.m_height} //
+    , m_normals{std::move(other.m_normals)} //
+{
+  other.m_depth_data = nullptr;
+  other.m_width = 0;
+  other.m_height = 0;
+}
+
+DepthMap &
+DepthMap::operator=(DepthMap &&other) noexcept {
+  if (this != &other) {
+    m_owned_depths = std::move(other.m_owned_depths);
+    m_storage = std::move(other.m_storage);
+    m_depth_data = other.m_depth_data;
+    m_width = other.m_width;
+    m_height = other.m_height;
+    m_normals = std::move(other.m_normals);
+    other.m_depth_data = nullptr;
+    other.m_width = 0;
+    other.m_height = 0;
   }
+  return *this;
+}
+
+DepthMap
+DepthMap::clone() const {
+  DepthMap copy{m_width, m_height, m_depth_data};
+  copy.m_normals = m_normals;
+  return copy;
 }
 
 float median_value(const std::vector<float> &v) {
@@ -180,108 +244,122 @@ DepthMap::get_neighbour_depths(unsigned int x, unsigned int y, float neighbour_d
   return flags;
 }
 
-/*
- * Based on
- * A Nonlocal Filter-Based Hybrid Strategy for Depth Map Enhancement
- */
-void
-DepthMap::cull_unreliable_depths(float ts, float tl) {
-  using namespace std;
-  bool reliable[m_height][m_width];
-  for (int r = 0; r < m_height; ++r) {
-    for (int c = 0; c < m_width; ++c) {
-      reliable[r][c] = false;
-    }
-  }
-
-  unsigned int unreliable_count = 0;
-  unsigned int zero_count = (2 * m_width) + (2 * m_height) - 4; // Assume borders are 0
-
-  for (unsigned int y = 1; y < m_height - 1; ++y) {
-    for (unsigned int x = 1; x < m_width - 1; ++x) {
-      float p = m_depth_data[index(x, y)];
-
-      // Handle existing non-depth values
-      if (p == 0.0f) {
-        reliable[y][x] = false;
-        ++zero_count;
-        continue;
-      }
-
+namespace {
+  /* Rows below which splitting the cull across threads isn't worth it */
+  const unsigned int MIN_CULL_ROWS_PER_THREAD = 64;
+
+  /*
+   * Reliability of each interior pixel of one row, written as 0 or 1 to reliable[1..width-2].
+   * Branch free so that the compiler can vectorise it; the selection between the cases below
+   * is made with masks in the same order as the tests they replace, so results are identical.
+   */
+  void
+  compute_row_reliability(const float *above, const float *row, const float *below,
+                          unsigned int width, float ts, float tl,
+                          uint8_t *reliable) {
+    for (unsigned int x = 1; x < width - 1; ++x) {
+      const float p = row[x];
+      const float right = row[x + 1];
+      const float left = row[x - 1];
+      const float down = below[x];
+      const float up = above[x];
 
       /* Compute
            Hp = |D(r,c-1) - D(r,c+1)|
            Vp = |D(r-1,c) - D(r+1,c)|
        */
-      float neighbour_depths[] = {
-          m_depth_data[index(x + 1, y)],  // Right
-          m_depth_data[index(x - 1, y)],  // Left
-          m_depth_data[index(x, y + 1)],  // Down
-          m_depth_data[index(x, y - 1)]   // Up
-      };
+      const float hp = fabsf(left - right);
+      const float vp = fabsf(up - down);
 
-      float hp = fabsf(neighbour_depths[1] - neighbour_depths[0]);
-      float vp = fabsf(neighbour_depths[3] - neighbour_depths[2]);
-
-      bool rel = false;
+      const bool right_supports = fabsf(right - p) <= tl;
+      const bool left_supports = fabsf(left - p) <= tl;
+      const bool down_supports = fabsf(down - p) <= tl;
+      const bool up_supports = fabsf(up - p) <= tl;
+      const bool any_supports = right_supports | left_supports | down_supports | up_supports;
 
       // First case: hp > ts && vp > ts so p is near a discontinuity
       // p is reliable if |Dpi - Dp| <= Tl for *any* i
       // i.e. we can find one supporting neighbour
-      if (hp > ts && vp > ts) {
-        for (float pi: neighbour_depths) {
-          if (fabsf(pi - p) <= tl) {
-            rel = true;
-            break;
-          }
-        }
-      }
-
-        // Second case: p near HORIZONTAL discontinutiy. Check VERTICAL neighbours for reliability
-        // i.e. we want this pixel to be part of either the upper or lower region, not straddling.
-      else if (vp > ts && hp <= tl) {
-        if (fabsf(neighbour_depths[2] - p) <= tl || fabsf(neighbour_depths[3] - p) <= tl) {
-          rel = true;
-        }
-      }
+      const bool near_discontinuity = (hp > ts) & (vp > ts);
+      // Second case: p near HORIZONTAL discontinuity. Check VERTICAL neighbours for reliability
+      // i.e. we want this pixel to be part of either the upper or lower region, not straddling.
+      const bool near_horizontal = (vp > ts) & (hp <= tl);
+      // Third case: p near VERTICAL discontinuity. Check HORIZONTAL neighbours for reliability
+      const bool near_vertical = (hp > ts) & (vp <= tl);
+      // Fourth case: Generally all points in homogeneous region but p may be an outlier check for this.
+      const bool use_vertical = !near_discontinuity & near_horizontal;
+      const bool use_horizontal = !near_discontinuity & !near_horizontal & near_vertical;
+      const bool use_any = !use_vertical & !use_horizontal;
+      const bool rel = (use_any & any_supports)
+          | (use_vertical & (down_supports | up_supports))
+          | (use_horizontal & (right_supports | left_supports));
+      // Existing non-depth values are never reliable
+      reliable[x] = (uint8_t) (rel & (p != 0.0f));
+    }
+  }
+}
 
-        // Third case: p near VERTICAL discontinutiy. Check HORIZONTAL neighbours for reliability
-        // i.e. we want this pixel to be part of either the left or right region, not straddling.
-      else if (hp > ts && vp <= tl) {
-        if (fabsf(neighbour_depths[0] - p) <= tl || fabsf(neighbour_depths[1] - p) <= tl) {
-          rel = true;
-        }
-      }
+/*
+ * Based on
+ * A Nonlocal Filter-Based Hybrid Strategy for Depth Map Enhancement
+ *
+ * Reliability is decided for every pixel from the original depths before any are culled.
+ * Rows are split into bands across threads; each row's mask occupies whole words of the
+ * bitset so bands never share a word.
+ */
+void
+DepthMap::cull_unreliable_depths(float ts, float tl) {
+  using namespace std;
 
-        // Fourth case: Generally all points in homogeneous region but p may be an outlier check for this.
-      else {
-        for (float pi: neighbour_depths) {
-          if (fabsf(pi - p) <= tl) {
-            rel = true;
-            break;
+  const size_t words_per_row = (m_width + 63) / 64;
+  // Borders are always unreliable so their bits stay clear
+  vector<uint64_t> reliable(words_per_row * m_height, 0);
+  atomic<unsigned int> interior_zero_count{0};
+  atomic<unsigned int> unreliable_count{0};
+
+  if (m_width > 2 && m_height > 2) {
+    for_each_row_band(1, m_height - 1, MIN_CULL_ROWS_PER_THREAD, [&](unsigned int first_row, unsigned int end_row) {
+      vector<uint8_t> row_reliable(m_width, 0);
+      unsigned int zeros = 0;
+      unsigned int unreliable = 0;
+      for (unsigned int y = first_row; y < end_row; ++y) {
+        const auto row = m_depth_data + index(0, y);
+        compute_row_reliability(row - m_width, row, row + m_width, m_width, ts, tl, row_reliable.data());
+
+        auto mask = &reliable[y * words_per_row];
+        for (unsigned int x = 1; x < m_width - 1; ++x) {
+          mask[x >> 6] |= (uint64_t) row_reliable[x] << (x & 63);
+          if (row[x] == 0.0f) {
+            ++zeros;
+          } else if (!row_reliable[x]) {
+            ++unreliable;
           }
         }
       }
-      if (!rel) {
-        ++unreliable_count;
-      }
-      reliable[y][x] = rel;
-    }
+      interior_zero_count += zeros;
+      unreliable_count += unreliable;
+    });
   }
 
-// Remove unreliable pixels
-  for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      if (!reliable[y][x]) {
-        m_depth_data[index(x, y)] = 0.0f;
+  // Remove unreliable pixels
+  for_each_row_band(0, m_height, MIN_CULL_ROWS_PER_THREAD, [&](unsigned int first_row, unsigned int end_row) {
+    for (unsigned int y = first_row; y < end_row; ++y) {
+      const auto mask = &reliable[y * words_per_row];
+      auto row = m_depth_data + index(0, y);
+      for (unsigned int x = 0; x < m_width; ++x) {
+        if (((mask[x >> 6] >> (x & 63)) & 1) == 0) {
+          row[x] = 0.0f;
+        }
       }
     }
-  }
+  });
+
+  unsigned int zero_count = (2 * m_width) + (2 * m_height) - 4 + interior_zero_count; // Assume borders are 0
   float size = m_width * m_height;
   spdlog::info("Cull:\n Size  {} x {}  ({})\n Zero  {} ({:2.1f})\n Unre  {} ({:2.1f})\n Relx  {} ({:2.1f})",
                m_width, m_height, size,
                zero_count, (zero_count * 100.0f / size),
-               unreliable_count, (unreliable_count * 100.0f/ size),
+               unreliable_count.load(), (unreliable_count * 100.0f/ size),
                (size - zero_count - unreliable_count), (size - zero_count - unreliable_count)  * 100.0f/ size
   );
 }
@@ -289,13 +367,13 @@ DepthMap::cull_unreliable_depths(float ts, float tl) {
 /**
  * Return the normals. Compute them if needed.
  */
-const std::vector<std::vector<NormalWithType>> &
+const NormalImage &
 DepthMap::get_normals() const {
   using namespace std;
-  if (normals.empty()) {
-    throw runtime_error("Normals not calculated. Call compute_normalsd() first");
+  if (m_normals.empty()) {
+    throw runtime_error("Normals not calculated. Call compute_normals() first");
   }
-  return normals;
+  return m_normals;
 }
 
 /**
@@ -306,7 +384,7 @@ DepthMap::get_normals() const {
  */
 bool
 DepthMap::is_normal_defined(unsigned int x, unsigned int y) const {
-  return (get_normals().at(y).at(x).type != NONE);
+  return get_normals().at(x, y).type != NONE;
 }
 
 /**
@@ -336,7 +414,7 @@ DepthMap::resample() const {
 
   unsigned int new_height = height() / 2;
   unsigned int new_width = width() / 2;
-  auto new_data = new float[new_height * new_width];
+  DepthMap resampled{new_width, new_height, nullptr};
 
   for (unsigned int y = 0; y < new_height; ++y) {
     for (unsigned int x = 0; x < new_width; ++x) {
@@ -348,14 +426,14 @@ DepthMap::resample() const {
           depth_at(source_x, min(source_y + 1, height() - 1)),
           depth_at(min(source_x + 1, width() - 1), min(source_y + 1, height() - 1))
       };
-      new_data[y * new_width + x] = merge(values);
+      resampled.m_depth_data[y * new_width + x] = merge(values);
     }
   }
-  return DepthMap{new_width, new_height, new_data};
+  return resampled;
 }
 
 NormalWithType DepthMap::normal_at(unsigned int x, unsigned int y) const {
-  return normals.at(y).at(x);
+  return get_normals().at(x, y);
 }
 
 /**
@@ -363,15 +441,17 @@ NormalWithType DepthMap::normal_at(unsigned int x, unsigned int y) const {
  * depth map.
  */
 void
-DepthMap::compute_normals(const Camera &camera, tNormalMethod method) {
+DepthMap::compute_normals(const Camera &camera, tNormalMethod method, unsigned int window_radius) {
 
   switch (method) {
-    case CROSS:normals = compute_natural_normals(this, camera);
-      compute_derived_normals(this, normals);
+    case CROSS:m_normals = compute_natural_normals(this, camera);
+      compute_derived_normals(this, m_normals);
+      break;
+    case PCL:m_normals = compute_normals_with_pcl(this, camera);
       break;
-    case PCL:normals = compute_normals_with_pcl(this, camera);
+    case PLANAR:m_normals = compute_normals_from_neighbours(this, camera);
       break;
-    case PLANAR:normals = compute_normals_from_neighbours(this, camera);
+    case INTEGRAL:m_normals = compute_normals_from_integral_images(this, camera, window_radius);
       break;
     default:throw std::runtime_error("Unrecognised normal method");
   }
@@ -6,8 +6,10 @@
 #include <regex>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <GeomFileUtils/PgmFileParser.h>
 #include <FileUtils/FileUtils.h>
+#include <FileUtils/FrameLoader.h>
 #include <DepthMap/DepthMap.h>
 #include <DepthMap/Normals.h>
 
@@ -35,32 +37,67 @@ get_depth_files_in_directory(const std::string &directory_name, const std::strin
     return full_path_names;
 }
 
+static void
+for_each_depth_map_file(const std::vector<std::string> &depth_file_names, float ts, float tl,
+                        const std::function<void(unsigned int, DepthMap &&)> &consume,
+                        size_t memory_ceiling) {
+    using namespace std;
+
+    FrameLoader<DepthMap> loader{
+            (unsigned int) depth_file_names.size(),
+            [&](unsigned int frame) {
+                DepthMap depth_map{depth_file_names[frame]};
+                depth_map.cull_unreliable_depths(ts, tl);
+                return depth_map;
+            },
+            [](const DepthMap &depth_map) {
+                return (size_t) depth_map.width() * depth_map.height() * sizeof(float);
+            },
+            memory_ceiling};
+    loader.for_each(consume);
+}
+
+void
+for_each_depth_map(const std::string &source_directory, const std::string &depth_map_regex, float ts, float tl,
+                   const std::function<void(unsigned int, DepthMap &&)> &consume,
+                   size_t memory_ceiling) {
+    using namespace std;
+
+    vector<string> depth_file_names = get_depth_files_in_directory(source_directory, depth_map_regex);
+    if (depth_file_names.empty()) {
+        throw runtime_error("No depth images found in " + source_directory);
+    }
+    for_each_depth_map_file(depth_file_names, ts, tl, consume, memory_ceiling);
+}
+
 std::vector<DepthMap>
 load_depth_maps(const std::string& source_directory, const std::string & depth_map_regex, float ts, float tl) {
     using namespace std;
 
     cout << "Loading depth maps from " << source_directory << endl;
 
-    vector<DepthMap> depth_maps;
     vector<string> depth_file_names = get_depth_files_in_directory(source_directory, depth_map_regex);
     if (depth_file_names.empty()) {
         throw runtime_error("No depth images found in " + source_directory);
     }
 
-    auto count = 0;
-    auto target = depth_file_names.size();
-    for (const auto &file_name : depth_file_names) {
-        cout << " \r  " << ++count << " of " << target << flush;
-        depth_maps.emplace_back(file_name);
-        depth_maps.back().cull_unreliable_depths(ts, tl);
-    }
+    // Every map is kept so there's no point holding the loaders back
+    const size_t target = depth_file_names.size();
+    vector<DepthMap> depth_maps;
+    depth_maps.reserve(target);
+    for_each_depth_map_file(depth_file_names, ts, tl,
+                            [&depth_maps, target](unsigned int frame, DepthMap &&depth_map) {
+                                cout << " \r  " << (frame + 1) << " of " << target << flush;
+                                depth_maps.push_back(move(depth_map));
+                            },
+                            numeric_limits<size_t>::max());
     cout << endl << "  done. " << endl;
 
     return depth_maps;
 }
 
 void
-save_depth_map_as_pgm(const std::string& file_name, const DepthMap& depth_map) {
+save_depth_map_as_pgm(const std::string& file_name, DepthMapView depth_map) {
     using namespace std;
 
     ofstream file{file_name};
@@ -108,11 +145,12 @@ void
 save_normals_as_ppm(const std::string& file_name, const DepthMap& depth_map) {
     using namespace std;
 
+    const auto &normals = depth_map.get_normals();
     ofstream file{file_name};
     file <<  "P3" << endl << depth_map.width() << " " << depth_map.height() << endl << "255" << endl;
     for( unsigned int y = 0; y < depth_map.height(); ++y) {
         for(unsigned int x = 0; x < depth_map.width(); ++x ) {
-            auto n = depth_map.normal_at(x, y);
+            auto n = normals(x, y);
             auto nc = normal_to_colour(n);
             file << (int) (round(nc.at(0))) << " " << (int) (round(nc.at(1))) << " " << (int) (round(nc.at(2)))
                  << "     ";
@@ -0,0 +1,109 @@
+//
+// Multi-level depth map pyramids
+//
+
+#include "DepthPyramid.h"
+#include "RowBands.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+  /*
+   * Merge the 2x2 blocks of two source rows into one row of width destination values,
+   * each the mean of the positive values in its block, or 0 if there are none.
+   * Branch free so that the compiler can vectorise it. Adding a skipped value as 0 is
+   * exact, so results match DepthMap::resample() bit for bit.
+   */
+  void
+  merge_rows(const float *__restrict upper, const float *__restrict lower, unsigned int width,
+             float *__restrict merged) {
+    for (unsigned int x = 0; x < width; ++x) {
+      const float a = upper[2 * x];
+      const float b = upper[2 * x + 1];
+      const float c = lower[2 * x];
+      const float d = lower[2 * x + 1];
+      float sum = 0.0f;
+      sum += (a > 0.0f) ? a : 0.0f;
+      sum += (b > 0.0f) ? b : 0.0f;
+      sum += (c > 0.0f) ? c : 0.0f;
+      sum += (d > 0.0f) ? d : 0.0f;
+      const float count = (float) ((a > 0.0f) + (b > 0.0f) + (c > 0.0f) + (d > 0.0f));
+      // When count is 0 so is sum
+      merged[x] = sum / std::max(count, 1.0f);
+    }
+  }
+}
+
+DepthPyramid::DepthPyramid(DepthMapView depth_map, unsigned int num_levels) {
+  using namespace std;
+
+  if (num_levels == 0) {
+    throw invalid_argument("A depth pyramid needs at least one level");
+  }
+
+  vector<unsigned int> widths{depth_map.width()};
+  vector<unsigned int> heights{depth_map.height()};
+  vector<size_t> offsets{0};
+  size_t total = (size_t) depth_map.width() * depth_map.height();
+  for (unsigned int level = 1; level < num_levels; ++level) {
+    widths.push_back(widths.back() / 2);
+    heights.push_back(heights.back() / 2);
+    offsets.push_back(total);
+    total += (size_t) widths.back() * heights.back();
+  }
+  m_data = shared_ptr<float>(new float[max(total, (size_t) 1)], default_delete<float[]>());
+  const auto data = m_data.get();
+  memcpy(data, depth_map.depth_data(), (size_t) widths[0] * heights[0] * sizeof(float));
+
+  // Work down the source in bands that each yield one row of the top level, making
+  // every row of the levels between as soon as the two rows beneath it exist so that
+  // they are still in cache when they are merged.
+  vector<unsigned int> rows_done(num_levels, 0);
+  const size_t band = (size_t) 1 << min(num_levels - 1, 31u);
+  for (size_t band_end = band;; band_end += band) {
+    size_t available = min(band_end, (size_t) heights[0]);
+    for (unsigned int level = 1; level < num_levels; ++level) {
+      available = min(available / 2, (size_t) heights[level]);
+      const auto source = data + offsets[level - 1];
+      for (; rows_done[level] < available; ++rows_done[level]) {
+        const auto y = rows_done[level];
+        merge_rows(source + (size_t) (2 * y) * widths[level - 1],
+                   source + (size_t) (2 * y + 1) * widths[level - 1],
+                   widths[level],
+                   data + offsets[level] + (size_t) y * widths[level]);
+      }
+    }
+    if (band_end >= heights[0]) {
+      break;
+    }
+  }
+
+  m_levels.reserve(num_levels);
+  for (unsigned int level = 0; level < num_levels; ++level) {
+    m_levels.emplace_back(widths[level], heights[level], data + offsets[level], m_data);
+  }
+}
+
+void
+DepthPyramid::compute_normals(const Camera &camera, tNormalMethod method, unsigned int window_radius) {
+  for (auto &level: m_levels) {
+    Camera level_camera = camera;
+    level_camera.set_image_size(level.width(), level.height());
+    level.compute_normals(level_camera, method, window_radius);
+  }
+}
+
+std::vector<DepthPyramid>
+build_depth_pyramids(const std::vector<DepthMap> &depth_maps, unsigned int num_levels) {
+  using namespace std;
+
+  vector<DepthPyramid> pyramids(depth_maps.size());
+  for_each_row_band(0, (unsigned int) depth_maps.size(), 1, [&](unsigned int first_frame, unsigned int end_frame) {
+    for (unsigned int frame = first_frame; frame < end_frame; ++frame) {
+      pyramids[frame] = DepthPyramid{depth_maps[frame], num_levels};
+    }
+  });
+  return pyramids;
+}
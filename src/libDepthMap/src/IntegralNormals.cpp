@@ -0,0 +1,218 @@
+//
+// Normals from windowed covariance computed with integral images
+//
+
+#include "IntegralNormals.h"
+#include "PointImage.h"
+#include "RowBands.h"
+
+#include <algorithm>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+
+namespace {
+  /* Rows, or columns, below which splitting the work across threads isn't worth it */
+  const unsigned int MIN_NORMAL_ROWS_PER_THREAD = 32;
+  const unsigned int MIN_NORMAL_COLUMNS_PER_THREAD = 256;
+
+  /* Fewest points that can define a plane */
+  const double MIN_WINDOW_POINTS = 3.0;
+
+  /* Windows whose second eigenvalue is this small relative to the largest are a line, not a plane */
+  const double MIN_PLANARITY = 1e-9;
+
+  typedef enum {
+    COUNT, SX, SY, SZ, SXX, SXY, SXZ, SYY, SYZ, SZZ, NUM_SUMS
+  } tSum;
+
+  /*
+   * One (width + 1) x (height + 1) integral image per sum, held as planes. Entry (x, y)
+   * of a plane is the sum over all pixels above and to the left of pixel (x, y), so
+   * row and column 0 are zero. Doubles because the second moments are differenced.
+   */
+  class IntegralImages {
+  public:
+    IntegralImages(unsigned int width, unsigned int height) //
+        : m_stride{width + 1} //
+        , m_plane_size{(size_t) (width + 1) * (height + 1)} //
+        , m_sums(NUM_SUMS * m_plane_size, 0.0) //
+    {}
+
+    inline unsigned int stride() const { return m_stride; }
+
+    inline double *row(tSum sum, unsigned int y) {
+      return m_sums.data() + sum * m_plane_size + (size_t) y * m_stride;
+    }
+
+    /* Sum over pixels [x0, x1) x [y0, y1) */
+    inline double window_sum(tSum sum, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+      const auto plane = m_sums.data() + sum * m_plane_size;
+      const auto top = (size_t) y0 * m_stride;
+      const auto bottom = (size_t) y1 * m_stride;
+      return plane[bottom + x1] - plane[bottom + x0] - plane[top + x1] + plane[top + x0];
+    }
+
+  private:
+    unsigned int m_stride;
+    size_t m_plane_size;
+    std::vector<double> m_sums;
+  };
+
+  /*
+   * Write the per pixel terms of every sum for one row of the image into row y + 1 of
+   * the integral images and then accumulate them along the row.
+   * Points are taken relative to the camera origin, which keeps the differenced moments
+   * small. Pixels without depth back-project onto the origin so they add only to COUNT.
+   */
+  void
+  accumulate_row(const PointImage &points, const float *depths, const Eigen::Vector3f &origin,
+                 unsigned int y, IntegralImages &sums) {
+    const auto width = points.width();
+    const size_t first = (size_t) y * width;
+    const auto xs = points.x_plane() + first;
+    const auto ys = points.y_plane() + first;
+    const auto zs = points.z_plane() + first;
+    const auto ds = depths + first;
+
+    double *out[NUM_SUMS];
+    for (unsigned int s = 0; s < NUM_SUMS; ++s) {
+      out[s] = sums.row((tSum) s, y + 1) + 1;
+    }
+    for (unsigned int x = 0; x < width; ++x) {
+      const double px = xs[x] - origin.x();
+      const double py = ys[x] - origin.y();
+      const double pz = zs[x] - origin.z();
+      out[COUNT][x] = (ds[x] != 0.0f) ? 1.0 : 0.0;
+      out[SX][x] = px;
+      out[SY][x] = py;
+      out[SZ][x] = pz;
+      out[SXX][x] = px * px;
+      out[SXY][x] = px * py;
+      out[SXZ][x] = px * pz;
+      out[SYY][x] = py * py;
+      out[SYZ][x] = py * pz;
+      out[SZZ][x] = pz * pz;
+    }
+    for (unsigned int s = 0; s < NUM_SUMS; ++s) {
+      const auto row = out[s];
+      for (unsigned int x = 1; x < width; ++x) {
+        row[x] += row[x - 1];
+      }
+    }
+  }
+
+  /*
+   * Accumulate columns [first, end) of every integral image down the rows.
+   */
+  void
+  accumulate_columns(unsigned int first, unsigned int end, unsigned int height, IntegralImages &sums) {
+    for (unsigned int s = 0; s < NUM_SUMS; ++s) {
+      for (unsigned int y = 2; y <= height; ++y) {
+        const auto above = sums.row((tSum) s, y - 1);
+        const auto row = sums.row((tSum) s, y);
+        for (unsigned int x = first; x < end; ++x) {
+          row[x] += above[x];
+        }
+      }
+    }
+  }
+
+  /*
+   * Fit a plane to the points in the window and return its normal, or false if the
+   * window does not hold enough points or they do not span a plane.
+   */
+  bool
+  window_normal(const IntegralImages &sums,
+                unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+                Eigen::Vector3d &normal) {
+    using namespace Eigen;
+
+    const auto n = sums.window_sum(COUNT, x0, y0, x1, y1);
+    if (n < MIN_WINDOW_POINTS) {
+      return false;
+    }
+
+    const Vector3d mean = Vector3d{sums.window_sum(SX, x0, y0, x1, y1),
+                                   sums.window_sum(SY, x0, y0, x1, y1),
+                                   sums.window_sum(SZ, x0, y0, x1, y1)} / n;
+    Matrix3d covariance;
+    covariance << sums.window_sum(SXX, x0, y0, x1, y1), sums.window_sum(SXY, x0, y0, x1, y1), sums.window_sum(SXZ, x0, y0, x1, y1),
+        0.0, sums.window_sum(SYY, x0, y0, x1, y1), sums.window_sum(SYZ, x0, y0, x1, y1),
+        0.0, 0.0, sums.window_sum(SZZ, x0, y0, x1, y1);
+    covariance /= n;
+    covariance -= mean * mean.transpose();
+
+    // Closed form solution; reads only the upper triangle. Eigenvalues are in increasing order.
+    SelfAdjointEigenSolver<Matrix3d> solver;
+    solver.computeDirect(covariance.selfadjointView<Upper>());
+    const auto &eigenvalues = solver.eigenvalues();
+    if (eigenvalues(1) <= MIN_PLANARITY * eigenvalues(2)) {
+      return false;
+    }
+    normal = solver.eigenvectors().col(0);
+    return true;
+  }
+}
+
+/**
+ * Compute normals as the direction of least variance of the back-projected points in a
+ * square window around each pixel with depth, using integral images of the point
+ * coordinates and their products.
+ */
+NormalImage
+compute_normals_from_integral_images(const DepthMap *depth_map, const Camera &camera, unsigned int window_radius) {
+  using namespace Eigen;
+
+  const auto width = depth_map->width();
+  const auto height = depth_map->height();
+  const auto depths = depth_map->depth_data();
+  const Vector3f origin = camera.origin();
+
+  // Every pixel starts with no normal
+  NormalImage normals{width, height};
+  if (width == 0 || height == 0) {
+    return normals;
+  }
+
+  const auto points = backproject(*depth_map, camera);
+
+  IntegralImages sums{width, height};
+  for_each_row_band(0, height, MIN_NORMAL_ROWS_PER_THREAD, [&](unsigned int first_row, unsigned int end_row) {
+    for (unsigned int y = first_row; y < end_row; ++y) {
+      accumulate_row(points, depths, origin, y, sums);
+    }
+  });
+  for_each_row_band(1, sums.stride(), MIN_NORMAL_COLUMNS_PER_THREAD, [&](unsigned int first, unsigned int end) {
+    accumulate_columns(first, end, height, sums);
+  });
+
+  // Each band writes only its own rows of the normal image
+  for_each_row_band(0, height, MIN_NORMAL_ROWS_PER_THREAD, [&](unsigned int first_row, unsigned int end_row) {
+    for (unsigned int y = first_row; y < end_row; ++y) {
+      const auto y0 = (y > window_radius) ? y - window_radius : 0;
+      const auto y1 = std::min(height, y + window_radius + 1);
+      for (unsigned int x = 0; x < width; ++x) {
+        if (depths[(size_t) y * width + x] == 0.0f) {
+          continue;
+        }
+        const auto x0 = (x > window_radius) ? x - window_radius : 0;
+        const auto x1 = std::min(width, x + window_radius + 1);
+
+        Vector3d normal;
+        if (!window_normal(sums, x0, y0, x1, y1, normal)) {
+          continue;
+        }
+
+        // Force correct orientation
+        const Vector3f cam_to_pixel = points(x, y) - origin;
+        if (cam_to_pixel.cast<double>().dot(normal) > 0) {
+          normal = -normal;
+        }
+        normals.set(x, y, NATURAL, (float) normal.x(), (float) normal.y(), (float) normal.z());
+      }
+    }
+  });
+
+  return normals;
+}
@@ -4,18 +4,46 @@
 
 #include "DepthMap.h"
 #include "Normals.h"
+#include <stdexcept>
+#include <string>
+
+NormalImage::NormalImage() //
+        : m_width{0} //
+        , m_height{0} //
+        , m_plane_size{0} //
+{}
+
+NormalImage::NormalImage(unsigned int width, unsigned int height) //
+        : m_width{width} //
+        , m_height{height} //
+        , m_plane_size{(size_t) width * height} //
+        , m_components(3 * m_plane_size, 0.0f) //
+        , m_types(m_plane_size, NONE) //
+{}
+
+NormalWithType
+NormalImage::at(unsigned int x, unsigned int y) const {
+    if (x >= m_width || y >= m_height) {
+        throw std::out_of_range("Normal (" + std::to_string(x) + ", " + std::to_string(y) + ") is outside "
+                                + std::to_string(m_width) + "x" + std::to_string(m_height) + " normal image");
+    }
+    return (*this)(x, y);
+}
 
 void
 validate_normals(const DepthMap* depth_map) {
     using namespace std;
 
+    const auto &normals = depth_map->get_normals();
+
     // Validation
     int natural_norm_count = 0;
     int derived_norm_count = 0;
     int zero_norms = 0;
     for (int y = 0; y < depth_map->height(); ++y) {
         for (int x = 0; x < depth_map->width(); ++x) {
-            auto norm_type = depth_map->normal_at(x, y).type;
+            const auto normal = normals(x, y);
+            auto norm_type = normal.type;
             if (norm_type == NONE) {
                 zero_norms++;
                 continue;
@@ -26,7 +54,6 @@ validate_normals(const DepthMap* depth_map) {
                 natural_norm_count++;
             }
             // Check that norm is legal
-            const auto &normal = depth_map->normal_at(x, y);
             float norm_length = sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
             if (isnan(norm_length)) {
                 cout << "Nan " << ((norm_type == DERIVED) ? "derived" : "natural") << " normal at y:" << y << ", x:"
@@ -46,7 +73,7 @@ validate_normals(const DepthMap* depth_map) {
              << endl;
     }
 
-    size_t num_norms = depth_map->get_normals().size() * depth_map->get_normals().at(0).size();
+    size_t num_norms = (size_t) normals.width() * normals.height();
     if (((zero_norms * 100) / num_norms) > 95) {
         cout << "Suspiciously high zero norms : " << zero_norms << " out of  " << num_norms << endl;
     }
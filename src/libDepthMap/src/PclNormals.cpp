@@ -4,6 +4,7 @@
 
 #include "DepthMap.h"
 #include "Normals.h"
+#include "PointImage.h"
 #include <Camera/Camera.h>
 
 #include <pcl/point_types.h>
@@ -13,7 +14,7 @@
 /**
  * Compute normal using estinate of normal to plane tangent to surface
  */
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_normals_with_pcl(DepthMap* depth_map, const Camera& camera) {
     using namespace pcl;
     using namespace std;
@@ -47,13 +48,11 @@ compute_normals_with_pcl(DepthMap* depth_map, const Camera& camera) {
     PointCloud<PointXYZ>::Ptr cloud(new pcl::PointCloud <pcl::PointXYZ>);
     cloud->points.resize( num_points );
 
-    // Populate the point cloud
+    // Populate the point cloud from the backprojected depths
+    const auto points = backproject(*depth_map, camera);
     int i = 0;
     for (const auto& pixel : valid_pixels) {
-        float d = depth_map->depth_at(pixel.x, pixel.y);
-        // Backproject the depths to get world coord
-        Eigen::Vector3f a = camera.to_world_coordinates(pixel.x, pixel.y, d);
-        cloud->points[i].getVector3fMap() = a;
+        cloud->points[i].getVector3fMap() = points(pixel.x, pixel.y);
         ++i;
     }
 
@@ -83,23 +82,14 @@ compute_normals_with_pcl(DepthMap* depth_map, const Camera& camera) {
     // cloud_normals->points.size () should have the same size as the input cloud->points.size ()*
 
 
-    // Now populate the normal_types and normals
-    vector<vector<NormalWithType>> normals{depth_map->height() * depth_map->width()};
-
-    for( int y=0; y<depth_map->height(); ++y ) {
-        vector<NormalWithType> normal_row;
-        for( int x=0; x<depth_map->width(); ++x ) {
-            normal_row.emplace_back(NONE, 0, 0, 0);
-        }
-        normals.push_back(normal_row);
-    }
-
-    // Go back and put in the actual details
-    for( const auto& pixel : valid_pixels ) {
-        normals.at(pixel.y).at(pixel.x).type = NATURAL;
-        normals.at(pixel.y).at(pixel.x).x = cloud_normals->points[i].normal_x;
-        normals.at(pixel.y).at(pixel.x).y = cloud_normals->points[i].normal_y;
-        normals.at(pixel.y).at(pixel.x).z = cloud_normals->points[i].normal_z;
+    // Now populate the normal_types and normals. Pixels without depth have no normal.
+    NormalImage normals{depth_map->width(), depth_map->height()};
+    for( size_t p = 0; p < valid_pixels.size(); ++p ) {
+        const auto& pixel = valid_pixels[p];
+        normals.set(pixel.x, pixel.y, NATURAL,
+                    cloud_normals->points[p].normal_x,
+                    cloud_normals->points[p].normal_y,
+                    cloud_normals->points[p].normal_z);
     }
 
     return normals;
@@ -4,6 +4,7 @@
 
 #include "Normals.h"
 #include "DepthMap.h"
+#include "PointImage.h"
 #include <vector>
 #include <Camera/Camera.h>
 #include <Eigen/SVD>
@@ -93,20 +94,22 @@ fit_plane_to_points(const std::vector<Eigen::Vector3f>& points, Eigen::Vector3f&
  * Compute normal using estimate of normal to plane tangent to surface
  * using neighbours in depth map
  */
-std::vector<std::vector<NormalWithType>>
+NormalImage
 compute_normals_from_neighbours(DepthMap *depth_map, const Camera &camera) {
     using namespace std;
     using namespace Eigen;
 
-    vector<vector<NormalWithType>> normals;
+    // Every pixel starts with no normal
+    NormalImage normals{depth_map->width(), depth_map->height()};
+
+    // Backproject every pixel once; each point is used by up to nine planes
+    const auto points = backproject(*depth_map, camera);
 
     // For each pixel
     for (auto y = 0; y < depth_map->height(); ++y) {
-        vector<NormalWithType> normals_for_row;
         for (auto x = 0; x < depth_map->width(); ++x) {
             float depth = depth_map->depth_at(x, y);
             if (depth == 0.0f) {
-                normals_for_row.emplace_back(NONE, 0.0, 0.0, 0.0);
                 continue;
             }
 
@@ -117,27 +120,25 @@ compute_normals_from_neighbours(DepthMap *depth_map, const Camera &camera) {
             vector<Vector3f> neighbours_in_world_coords;
             neighbours_in_world_coords.reserve(neighbours.size());
             for (const auto &n : neighbours) {
-                neighbours_in_world_coords.emplace_back(camera.to_world_coordinates(n.x, n.y, n.depth));
+                neighbours_in_world_coords.emplace_back(points(n.x, n.y));
             }
 
             // Fit Plane
             Vector3f planar_normal;
             if (!fit_plane_to_points(neighbours_in_world_coords, planar_normal)) {
-                normals_for_row.emplace_back(NONE, 0.0, 0.0, 0.0);
                 continue;
             }
 
             // Force correct orientation
-            Vector3f cam_to_pixel = camera.to_world_coordinates(x, y, depth) - camera.origin();
+            Vector3f cam_to_pixel = points(x, y) - camera.origin();
             float dp = cam_to_pixel.dot(planar_normal);
             if( dp > 0 ) {
                 planar_normal = - planar_normal;
             }
 
             // Store normal to plane
-            normals_for_row.emplace_back(NATURAL, planar_normal.x(), planar_normal.y(), planar_normal.z());
+            normals.set(x, y, NATURAL, planar_normal.x(), planar_normal.y(), planar_normal.z());
         }
-        normals.emplace_back(normals_for_row);
     }
 
     return normals;
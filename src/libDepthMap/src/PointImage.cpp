@@ -0,0 +1,44 @@
+//
+// Whole-frame back-projection of depth maps
+//
+
+#include "PointImage.h"
+#include "DepthMap.h"
+
+PointImage::PointImage() //
+        : m_width{0} //
+        , m_height{0} //
+        , m_plane_size{0} //
+{}
+
+PointImage::PointImage(unsigned int width, unsigned int height) //
+        : m_width{width} //
+        , m_height{height} //
+        , m_plane_size{(size_t) width * height} //
+        , m_components(3 * m_plane_size) //
+{}
+
+/*
+ * One component plane of origin + ray * depth. Kept free of aliasing and branches
+ * so that the compiler can vectorise it.
+ */
+static void
+backproject_plane(float origin, const float *__restrict rays, const float *__restrict depths,
+                  float *__restrict points, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        points[i] = origin + rays[i] * depths[i];
+    }
+}
+
+PointImage
+backproject(DepthMapView depth_map, const Camera &camera) {
+    const auto rays = camera.ray_table(depth_map.width(), depth_map.height());
+    const auto origin = camera.origin();
+    const size_t count = (size_t) depth_map.width() * depth_map.height();
+
+    PointImage points{depth_map.width(), depth_map.height()};
+    backproject_plane(origin.x(), rays->x_plane(), depth_map.depth_data(), points.x_plane(), count);
+    backproject_plane(origin.y(), rays->y_plane(), depth_map.depth_data(), points.y_plane(), count);
+    backproject_plane(origin.z(), rays->z_plane(), depth_map.depth_data(), points.z_plane(), count);
+    return points;
+}
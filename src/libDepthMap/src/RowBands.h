@@ -0,0 +1,36 @@
+//
+// Splitting per-row work across threads
+//
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/*
+ * Run band_function(first, end) over bands of [begin, end) on several threads,
+ * giving each thread at least min_per_thread entries.
+ */
+inline void
+for_each_row_band(unsigned int begin, unsigned int end, unsigned int min_per_thread,
+                  const std::function<void(unsigned int, unsigned int)> &band_function) {
+  using namespace std;
+
+  const auto num_rows = end - begin;
+  const auto max_threads = max(1u, thread::hardware_concurrency());
+  const auto num_threads = max(1u, min(max_threads, num_rows / max(1u, min_per_thread)));
+  if (num_threads == 1) {
+    band_function(begin, end);
+    return;
+  }
+  const auto rows_per_thread = (num_rows + num_threads - 1) / num_threads;
+  vector<thread> threads;
+  for (unsigned int first = begin; first < end; first += rows_per_thread) {
+    threads.emplace_back(band_function, first, min(end, first + rows_per_thread));
+  }
+  for (auto &t: threads) {
+    t.join();
+  }
+}
@@ -1,7 +1,17 @@
 #include "TestDepthMap.h"
+#include <DepthMap/BinaryDepthMap.h>
+#include <DepthMap/PointImage.h>
+#include <DepthMap/IntegralNormals.h>
+#include <DepthMap/DepthPyramid.h>
 
 #include <iostream>
 #include <cmath>
+#include <vector>
+#include <unistd.h>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
 const float INV_SQRT_2 = 1.0f / std::sqrt(2.0f);
 
 void TestCorrespondence::SetUp( ) {}
@@ -298,8 +308,8 @@ TEST_F(TestCorrespondence, CentralNormalIsZ ) {
 	// 7x7 map with 5x5 set in centre.
     DepthMap d{7, 7, data};
     d.compute_normals(get_camera(), PLANAR);
-	std::vector<std::vector<NormalWithType>> normals = d.get_normals();
-	NormalWithType norm = normals.at(3).at(3);
+	const NormalImage &normals = d.get_normals();
+	NormalWithType norm = normals.at(3, 3);
 
 	EXPECT_EQ( norm.x, 0.0f);
 	EXPECT_EQ( norm.y, 0.0f);
@@ -309,30 +319,345 @@ TEST_F(TestCorrespondence, CentralNormalIsZ ) {
 TEST_F(TestCorrespondence, TopLeftNormalIsNotThere ) {
 	// 7x7 map with 5x5 set in centre.
 	DepthMap d{"depthmap_test_data/solid_block_test.dat"};
-	std::vector<std::vector<NormalWithType>> normals = d.get_normals();
+	const NormalImage &normals = d.get_normals();
 
 	//-0, 0.948683, 0.316228
-	EXPECT_EQ( normals[0][0].x, 0.0f);
-	EXPECT_EQ( normals[0][0].y, 0.0f);
-	EXPECT_EQ( normals[0][0].z, 0.0f);
+	EXPECT_EQ( normals.at(0, 0).x, 0.0f);
+	EXPECT_EQ( normals.at(0, 0).y, 0.0f);
+	EXPECT_EQ( normals.at(0, 0).z, 0.0f);
 }
 
 TEST_F(TestCorrespondence, TopCentralNormalIsZ ) {
 	// 7x7 map with 5x5 set in centre.
 	DepthMap d{"depthmap_test_data/solid_block_test.dat"};
-	std::vector<std::vector<NormalWithType>> normals = d.get_normals();
+	const NormalImage &normals = d.get_normals();
 
-    EXPECT_EQ( normals[1][3].x, 0.0f);
-	EXPECT_EQ( normals[1][3].y, 0.0f);
-	EXPECT_EQ( normals[1][3].z, 1.0f);
+    EXPECT_EQ( normals.at(3, 1).x, 0.0f);
+	EXPECT_EQ( normals.at(3, 1).y, 0.0f);
+	EXPECT_EQ( normals.at(3, 1).z, 1.0f);
 }
 
 TEST_F(TestCorrespondence, LeftCentralNormalIsZ ) {
 	// 7x7 map with 5x5 set in centre.
 	DepthMap d{"depthmap_test_data/solid_block_test.dat"};
-	std::vector<std::vector<NormalWithType>> normals = d.get_normals();
+	const NormalImage &normals = d.get_normals();
 
-	EXPECT_EQ( normals[1][3].x, 0.0f);
-	EXPECT_EQ( normals[1][3].y, 0.0f);
-	EXPECT_EQ( normals[1][3].z, 1.0f);
-}
\ No newline at end of file
+	EXPECT_EQ( normals.at(3, 1).x, 0.0f);
+	EXPECT_EQ( normals.at(3, 1).y, 0.0f);
+	EXPECT_EQ( normals.at(3, 1).z, 1.0f);
+}
+/* ********************************************************************************
+ * ** Test binary depth maps
+ * ********************************************************************************/
+DepthMap make_ramp_depth_map(unsigned int width, unsigned int height) {
+    std::vector<float> depths(width * height);
+    for (unsigned int i = 0; i < depths.size(); ++i) {
+        depths[i] = (i % 7 == 0) ? 0.0f : 1.0f + (float) i * 0.001f;
+    }
+    return DepthMap{width, height, depths.data()};
+}
+
+TEST_F(TestCorrespondence, BinaryFloatDepthMapShouldRoundTrip ) {
+    const auto original = make_ramp_depth_map(13, 7);
+    save_binary_depth_map("ramp_f32.dmb", original);
+
+    EXPECT_TRUE(is_binary_depth_map("ramp_f32.dmb"));
+    const auto loaded = load_binary_depth_map("ramp_f32.dmb");
+    remove("ramp_f32.dmb");
+    ASSERT_EQ(loaded.width(), 13);
+    ASSERT_EQ(loaded.height(), 7);
+    for (unsigned int y = 0; y < 7; ++y) {
+        for (unsigned int x = 0; x < 13; ++x) {
+            EXPECT_EQ(loaded.depth_at(x, y), original.depth_at(x, y));
+        }
+    }
+}
+
+TEST_F(TestCorrespondence, BinaryUint16DepthMapShouldQuantise ) {
+    const auto original = make_ramp_depth_map(13, 7);
+    save_binary_depth_map("ramp_u16.dmb", original, BDT_UINT16, 0.001f);
+
+    // The file constructor should recognise binary files too
+    const DepthMap loaded{"ramp_u16.dmb"};
+    remove("ramp_u16.dmb");
+    for (unsigned int y = 0; y < 7; ++y) {
+        for (unsigned int x = 0; x < 13; ++x) {
+            EXPECT_NEAR(loaded.depth_at(x, y), original.depth_at(x, y), 0.0006f);
+        }
+    }
+}
+
+TEST_F(TestCorrespondence, TruncatedBinaryDepthMapShouldThrow ) {
+    save_binary_depth_map("ramp_truncated.dmb", make_ramp_depth_map(13, 7));
+    truncate("ramp_truncated.dmb", BINARY_DEPTH_MAP_HEADER_SIZE + 10);
+    EXPECT_THROW(load_binary_depth_map("ramp_truncated.dmb"), std::runtime_error);
+    remove("ramp_truncated.dmb");
+}
+
+TEST_F(TestCorrespondence, TextDepthMapShouldNotBeBinary ) {
+    EXPECT_FALSE(is_binary_depth_map("depthmap_test_data/dm.dat"));
+    EXPECT_FALSE(is_binary_depth_map("no_such_file.dmb"));
+}
+
+/* ********************************************************************************
+ * ** Test culling against the original per pixel implementation
+ * ********************************************************************************/
+void reference_cull(std::vector<float> &depths, unsigned int width, unsigned int height, float ts, float tl) {
+    std::vector<bool> reliable(width * height, false);
+    for (unsigned int y = 1; y < height - 1; ++y) {
+        for (unsigned int x = 1; x < width - 1; ++x) {
+            float p = depths[y * width + x];
+            if (p == 0.0f) {
+                continue;
+            }
+            float neighbour_depths[] = {
+                depths[y * width + x + 1],
+                depths[y * width + x - 1],
+                depths[(y + 1) * width + x],
+                depths[(y - 1) * width + x]
+            };
+            float hp = fabsf(neighbour_depths[1] - neighbour_depths[0]);
+            float vp = fabsf(neighbour_depths[3] - neighbour_depths[2]);
+            bool rel = false;
+            if (hp > ts && vp > ts) {
+                for (float pi: neighbour_depths) {
+                    if (fabsf(pi - p) <= tl) { rel = true; break; }
+                }
+            } else if (vp > ts && hp <= tl) {
+                rel = fabsf(neighbour_depths[2] - p) <= tl || fabsf(neighbour_depths[3] - p) <= tl;
+            } else if (hp > ts && vp <= tl) {
+                rel = fabsf(neighbour_depths[0] - p) <= tl || fabsf(neighbour_depths[1] - p) <= tl;
+            } else {
+                for (float pi: neighbour_depths) {
+                    if (fabsf(pi - p) <= tl) { rel = true; break; }
+                }
+            }
+            reliable[y * width + x] = rel;
+        }
+    }
+    for (unsigned int i = 0; i < depths.size(); ++i) {
+        if (!reliable[i]) depths[i] = 0.0f;
+    }
+}
+
+TEST_F(TestCorrespondence, CullShouldMatchReferenceImplementation ) {
+    std::default_random_engine rng{123};
+    std::uniform_real_distribution<float> noise{-0.3f, 0.3f};
+    std::uniform_int_distribution<int> step{0, 9};
+
+    // Sizes straddle the 64 bit mask words and are tall enough to use several threads
+    const unsigned int sizes[][2] = {{3, 3}, {5, 4}, {64, 10}, {65, 11}, {127, 300}, {640, 480}};
+    for (const auto &size: sizes) {
+        const auto width = size[0];
+        const auto height = size[1];
+        std::vector<float> depths(width * height);
+        for (unsigned int i = 0; i < depths.size(); ++i) {
+            // Blocky steps with noise and holes
+            const auto s = step(rng);
+            depths[i] = (s == 0) ? 0.0f : 5.0f + (float) ((i % width) / 16) + (s == 1 ? 3.0f : 0.0f) + noise(rng);
+        }
+        auto expected = depths;
+        reference_cull(expected, width, height, 1.0f, 0.5f);
+
+        DepthMap d{width, height, depths.data()};
+        d.cull_unreliable_depths(1.0f, 0.5f);
+        for (unsigned int y = 0; y < height; ++y) {
+            for (unsigned int x = 0; x < width; ++x) {
+                const auto actual = d.depth_at(x, y);
+                ASSERT_EQ(0, memcmp(&actual, &expected[y * width + x], sizeof(float)))
+                    << "at (" << x << ", " << y << ") in " << width << " x " << height;
+            }
+        }
+    }
+}
+
+/* ********************************************************************************
+ * ** Test normal storage
+ * ********************************************************************************/
+
+TEST_F(TestCorrespondence, CrossNormalsShouldCoverWideMap ) {
+    // 9x5 map with a 7x3 block in the centre; wider than it is tall
+    const unsigned int width = 9;
+    const unsigned int height = 5;
+    std::vector<float> depths(width * height, 0.0f);
+    for (unsigned int y = 1; y < height - 1; ++y) {
+        for (unsigned int x = 1; x < width - 1; ++x) {
+            depths[y * width + x] = 3.0f;
+        }
+    }
+    DepthMap d{width, height, depths.data()};
+    d.compute_normals(get_camera(), CROSS);
+
+    const NormalImage &normals = d.get_normals();
+    EXPECT_EQ(width, normals.width());
+    EXPECT_EQ(height, normals.height());
+    EXPECT_EQ(NONE, normals.type(0, 0));
+    EXPECT_EQ(NATURAL, normals.type(4, 2));
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            EXPECT_EQ(depths[y * width + x] != 0.0f, d.is_normal_defined(x, y)) << "at (" << x << ", " << y << ")";
+            if (normals.is_defined(x, y)) {
+                const auto n = normals(x, y);
+                EXPECT_NEAR(1.0f, std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z), 1e-5f);
+            }
+        }
+    }
+    EXPECT_THROW(d.normal_at(width, 0), std::out_of_range);
+}
+
+/* ********************************************************************************
+ * ** Test back-projection
+ * ********************************************************************************/
+
+TEST_F(TestCorrespondence, BackprojectShouldMatchPerPixelProjection ) {
+    const unsigned int width = 13;
+    const unsigned int height = 7;
+    std::vector<float> depths(width * height);
+    for (unsigned int i = 0; i < depths.size(); ++i) {
+        depths[i] = (i % 5 == 0) ? 0.0f : 2.0f + 0.1f * (float) i;
+    }
+    DepthMap d{width, height, depths.data()};
+    const auto camera = get_camera();
+
+    const auto points = backproject(d, camera);
+    EXPECT_EQ(width, points.width());
+    EXPECT_EQ(height, points.height());
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            const auto expected = camera.to_world_coordinates(x, y, d.depth_at(x, y));
+            const auto actual = points(x, y);
+            EXPECT_NEAR(expected.x(), actual.x(), 1e-5f) << "at (" << x << ", " << y << ")";
+            EXPECT_NEAR(expected.y(), actual.y(), 1e-5f) << "at (" << x << ", " << y << ")";
+            EXPECT_NEAR(expected.z(), actual.z(), 1e-5f) << "at (" << x << ", " << y << ")";
+        }
+    }
+}
+
+/* ********************************************************************************
+ * ** Test integral image normals
+ * ********************************************************************************/
+
+TEST_F(TestCorrespondence, IntegralNormalsShouldRecoverTiltedPlane ) {
+    using namespace Eigen;
+
+    // Depths of the plane n.p = 0 through the world origin, which faces the camera
+    const unsigned int width = 40;
+    const unsigned int height = 30;
+    auto camera = get_camera();
+    camera.set_image_size(width, height);
+    const Vector3f plane_normal = Vector3f{0.2f, 1.0f, 0.8f}.normalized();
+    const auto rays = camera.ray_table(width, height);
+    std::vector<float> depths(width * height);
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            const auto ray = rays->direction(x, y);
+            depths[y * width + x] = -plane_normal.dot(camera.origin()) / plane_normal.dot(ray);
+        }
+    }
+    // A hole, which has no normal
+    depths[15 * width + 20] = 0.0f;
+    DepthMap d{width, height, depths.data()};
+
+    // Normals should face the camera
+    const Vector3f expected = (plane_normal.dot(camera.origin()) > 0) ? plane_normal : Vector3f{-plane_normal};
+    for (unsigned int radius = 1; radius <= 3; ++radius) {
+        const auto normals = compute_normals_from_integral_images(&d, camera, radius);
+        for (unsigned int y = 0; y < height; ++y) {
+            for (unsigned int x = 0; x < width; ++x) {
+                if (d.depth_at(x, y) == 0.0f) {
+                    EXPECT_FALSE(normals.is_defined(x, y));
+                    continue;
+                }
+                ASSERT_TRUE(normals.is_defined(x, y)) << "at (" << x << ", " << y << ") radius " << radius;
+                EXPECT_NEAR(expected.x(), normals.nx(x, y), 1e-3f) << "at (" << x << ", " << y << ")";
+                EXPECT_NEAR(expected.y(), normals.ny(x, y), 1e-3f) << "at (" << x << ", " << y << ")";
+                EXPECT_NEAR(expected.z(), normals.nz(x, y), 1e-3f) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+/* ********************************************************************************
+ * ** Test depth pyramids
+ * ********************************************************************************/
+
+TEST_F(TestCorrespondence, PyramidShouldMatchRepeatedResampling ) {
+    std::default_random_engine rng{11};
+    std::uniform_real_distribution<float> depth{1.0f, 9.0f};
+    std::uniform_int_distribution<int> hole{0, 4};
+
+    // Odd sizes drop a row or column at some levels
+    const unsigned int sizes[][2] = {{1, 1}, {7, 5}, {64, 48}, {101, 77}};
+    std::vector<DepthMap> depth_maps;
+    for (const auto &size: sizes) {
+        std::vector<float> depths(size[0] * size[1]);
+        for (auto &d: depths) {
+            d = (hole(rng) == 0) ? 0.0f : depth(rng);
+        }
+        depth_maps.emplace_back(size[0], size[1], depths.data());
+    }
+
+    const unsigned int num_levels = 5;
+    const auto pyramids = build_depth_pyramids(depth_maps, num_levels);
+    ASSERT_EQ(depth_maps.size(), pyramids.size());
+    for (unsigned int frame = 0; frame < depth_maps.size(); ++frame) {
+        const auto &pyramid = pyramids[frame];
+        ASSERT_EQ(num_levels, pyramid.num_levels());
+        DepthMap expected = depth_maps[frame].clone();
+        for (unsigned int level = 0; level < num_levels; ++level) {
+            const auto &actual = pyramid.level(level);
+            ASSERT_EQ(expected.width(), actual.width());
+            ASSERT_EQ(expected.height(), actual.height());
+            for (unsigned int y = 0; y < actual.height(); ++y) {
+                for (unsigned int x = 0; x < actual.width(); ++x) {
+                    const auto a = actual.depth_at(x, y);
+                    const auto e = expected.depth_at(x, y);
+                    ASSERT_EQ(0, memcmp(&a, &e, sizeof(float)))
+                        << "frame " << frame << " level " << level << " at (" << x << ", " << y << ")";
+                }
+            }
+            if (level + 1 < num_levels) {
+                // Levels are laid out back to back
+                EXPECT_EQ(actual.depth_data() + actual.width() * actual.height(),
+                          pyramid.level(level + 1).depth_data());
+                expected = expected.resample();
+            }
+        }
+    }
+    EXPECT_THROW((DepthPyramid{depth_maps[0], 0}), std::invalid_argument);
+}
+
+/* ********************************************************************************
+ * ** Test depth map ownership
+ * ********************************************************************************/
+
+TEST_F(TestCorrespondence, DepthMapsShouldMoveWithoutCopyingAndCloneDeeply ) {
+    static_assert(!std::is_copy_constructible<DepthMap>::value, "DepthMaps should not be copied implicitly");
+    static_assert(std::is_nothrow_move_constructible<DepthMap>::value, "DepthMaps should move cheaply");
+
+    float depths[]{1.0f, 2.0f, 0.0f, 4.0f, 5.0f, 6.0f};
+    DepthMap original{3, 2, depths};
+    const auto data = original.depth_data();
+
+    // Growing a vector moves its depth maps, keeping their buffers
+    std::vector<DepthMap> depth_maps;
+    depth_maps.push_back(std::move(original));
+    for (unsigned int i = 0; i < 10; ++i) {
+        depth_maps.emplace_back(3, 2, depths);
+    }
+    EXPECT_EQ(data, depth_maps[0].depth_data());
+    EXPECT_EQ(0, original.width());
+    EXPECT_EQ(nullptr, original.depth_data());
+
+    const auto copy = depth_maps[0].clone();
+    EXPECT_NE(data, copy.depth_data());
+    EXPECT_EQ(3, copy.width());
+    EXPECT_EQ(2, copy.height());
+    EXPECT_FLOAT_EQ(4.0f, copy.depth_at(0, 1));
+
+    const DepthMapView view = copy;
+    EXPECT_EQ(copy.depth_data(), view.depth_data());
+    EXPECT_FLOAT_EQ(6.0f, view.depth_at(2, 1));
+
+    EXPECT_THROW((DepthMap{3, 2, std::vector<float>(5)}), std::invalid_argument);
+}
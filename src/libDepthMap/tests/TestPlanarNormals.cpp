@@ -39,8 +39,9 @@ TEST_F( TestPlanarNormals,  NormalsShouldBeCorrect ) {
     };
     // 7x7 map with 5x5 set in centre.
     DepthMap d{7, 7, data};
-    vector<vector<NormalWithType>> normals = compute_normals_from_neighbours(&d, get_camera_z());
+    NormalImage normals = compute_normals_from_neighbours(&d, get_camera_z());
 
-    EXPECT_EQ(normals.size(), 7);
+    EXPECT_EQ(normals.width(), 7);
+    EXPECT_EQ(normals.height(), 7);
 }
 
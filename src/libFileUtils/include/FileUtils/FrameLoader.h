@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Loads a sequence of frames on a pool of I/O threads and hands them back strictly in frame order.
+ * Frames that have been loaded but not yet taken by the consumer are buffered; once the buffered
+ * frames reach the memory ceiling the loaders wait for the consumer to catch up before starting
+ * another frame. The consumer may start work on frame 0 while later frames are still loading.
+ *
+ * If loading a frame throws, the frames before it are still delivered and the exception is then
+ * rethrown from next().
+ */
+template<typename Frame>
+class FrameLoader {
+public:
+  /* Load frame n. Called concurrently on the I/O threads. */
+  using LoadFunction = std::function<Frame(unsigned int)>;
+  /* Bytes a loaded frame holds, used to enforce the memory ceiling */
+  using SizeFunction = std::function<size_t(const Frame &)>;
+
+  static const size_t DEFAULT_MEMORY_CEILING = (size_t) 1 << 30;
+
+  /**
+   * Start loading frames.
+   * @param num_frames The number of frames to load, indexed from 0.
+   * @param load Function which loads a frame given its index.
+   * @param size_of Function which returns the bytes held by a loaded frame.
+   * @param memory_ceiling Most bytes of loaded frames to buffer ahead of the consumer.
+   * @param num_threads The number of I/O threads, or 0 for one per hardware thread.
+   */
+  FrameLoader(unsigned int num_frames, //
+              LoadFunction load, //
+              SizeFunction size_of, //
+              size_t memory_ceiling = DEFAULT_MEMORY_CEILING, //
+              unsigned int num_threads = 0) //
+      : m_num_frames{num_frames} //
+      , m_load{std::move(load)} //
+      , m_size_of{std::move(size_of)} //
+      , m_memory_ceiling{memory_ceiling} //
+      , m_next_claim{0} //
+      , m_next_delivery{0} //
+      , m_buffered_bytes{0} //
+      , m_failed_frame{num_frames} //
+      , m_stopping{false} //
+  {
+    if (num_threads == 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, num_frames);
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      m_threads.emplace_back(&FrameLoader::load_frames, this);
+    }
+  }
+
+  FrameLoader(const FrameLoader &) = delete;
+
+  FrameLoader &operator=(const FrameLoader &) = delete;
+
+  /**
+   * Stop loading. Frames being loaded are finished and discarded.
+   */
+  ~FrameLoader() {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stopping = true;
+    }
+    m_space_available.notify_all();
+    for (auto &thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  inline unsigned int num_frames() const { return m_num_frames; }
+
+  /**
+   * Wait for the next frame in order.
+   * @param frame Set to the next frame.
+   * @param frame_index Set to the index of that frame.
+   * @return false once every frame has been delivered.
+   */
+  bool next(Frame &frame, unsigned int &frame_index) {
+    return take_next([&frame, &frame_index](unsigned int index, Frame &&loaded) {
+      frame = std::move(loaded);
+      frame_index = index;
+    });
+  }
+
+  /**
+   * Hand every remaining frame, in order, to the consumer as soon as it has loaded.
+   * @param consume Function taking the frame index and the frame.
+   */
+  void for_each(const std::function<void(unsigned int, Frame &&)> &consume) {
+    while (take_next(consume)) {
+    }
+  }
+
+private:
+  template<typename Consumer>
+  bool take_next(const Consumer &consume) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_frame_ready.wait(lock, [this]() {
+      return m_next_delivery >= m_num_frames
+          || m_next_delivery == m_failed_frame
+          || m_loaded.count(m_next_delivery) != 0;
+    });
+    if (m_next_delivery >= m_num_frames) {
+      return false;
+    }
+    if (m_next_delivery == m_failed_frame) {
+      std::rethrow_exception(m_failure);
+    }
+
+    auto loaded = m_loaded.find(m_next_delivery);
+    Frame frame{std::move(loaded->second.first)};
+    const auto frame_index = m_next_delivery;
+    m_buffered_bytes -= loaded->second.second;
+    m_loaded.erase(loaded);
+    ++m_next_delivery;
+    lock.unlock();
+
+    m_space_available.notify_all();
+    consume(frame_index, std::move(frame));
+    return true;
+  }
+
+  /*
+   * Frames are claimed in index order so every frame before the one the consumer is waiting
+   * for is already claimed; a full buffer can therefore always drain.
+   */
+  void load_frames() {
+    for (;;) {
+      unsigned int frame_index;
+      {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_space_available.wait(lock, [this]() {
+          return m_stopping
+              || m_next_claim >= m_failed_frame
+              || m_buffered_bytes < m_memory_ceiling
+              || m_loaded.empty();
+        });
+        if (m_stopping || m_next_claim >= m_failed_frame) {
+          return;
+        }
+        frame_index = m_next_claim++;
+      }
+
+      try {
+        auto frame = m_load(frame_index);
+        const auto bytes = m_size_of(frame);
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_buffered_bytes += bytes;
+        m_loaded.emplace(frame_index, std::make_pair(std::move(frame), bytes));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (frame_index < m_failed_frame) {
+          m_failed_frame = frame_index;
+          m_failure = std::current_exception();
+        }
+      }
+      m_frame_ready.notify_all();
+      m_space_available.notify_all();
+    }
+  }
+
+  const unsigned int m_num_frames;
+  const LoadFunction m_load;
+  const SizeFunction m_size_of;
+  const size_t m_memory_ceiling;
+
+  std::mutex m_mutex;
+  std::condition_variable m_frame_ready;
+  std::condition_variable m_space_available;
+
+  unsigned int m_next_claim;
+  unsigned int m_next_delivery;
+  size_t m_buffered_bytes;
+  /* Loaded frames by index, with their size */
+  std::map<unsigned int, std::pair<Frame, size_t>> m_loaded;
+  /* Lowest frame that failed to load, or num_frames */
+  unsigned int m_failed_frame;
+  std::exception_ptr m_failure;
+  bool m_stopping;
+
+  std::vector<std::thread> m_threads;
+};
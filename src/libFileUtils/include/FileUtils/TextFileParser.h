@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+
+/**
+ * Read a text file holding one comma separated x, y, z triple per line, such as the point
+ * clouds and normals written by dm_to_data. The file is mapped and parsed in place.
+ * Blank lines are skipped.
+ * @param file_name The name of the file to read.
+ * @return The triples in file order.
+ * @throws std::runtime_error naming the file and line if the file can't be read or a line can't be parsed.
+ */
+std::vector<Eigen::Vector3f> read_vec3f_text_file(const std::string &file_name);
+
+/**
+ * Read a text file holding one bracketed pair of unsigned integers "(x, y)" per line, such as
+ * the pixel (PIF) files written by dm_to_data. Blank lines are skipped.
+ * @param file_name The name of the file to read.
+ * @return The pairs in file order.
+ * @throws std::runtime_error naming the file and line if the file can't be read or a line can't be parsed.
+ */
+std::vector<std::pair<unsigned int, unsigned int>> read_uint_pair_text_file(const std::string &file_name);
+
+/**
+ * Map a whole file read only for parsing in place.
+ * @param file_name The name of the file to map.
+ * @param file_size Set to the size of the file.
+ * @return The start of the mapping, which is unmapped when the last copy is released, or null
+ * if the file is empty. The mapping is not null terminated.
+ * @throws std::runtime_error if the file can't be opened or mapped.
+ */
+std::shared_ptr<const char> map_text_file(const std::string &file_name, size_t &file_size);
+
+/**
+ * Scan a decimal floating point number such as "-1.25e-3". Numbers with at most 7 significant
+ * digits and small exponents are converted directly, others fall back to strtof so every
+ * result is correctly rounded.
+ * @param pos The first character of the number, advanced past it on success.
+ * @param end The end of the text, which need not be null terminated.
+ * @param value Set to the number.
+ * @return false, leaving pos unchanged, if there is no number at pos.
+ */
+bool scan_float(const char *&pos, const char *end, float &value);
+
+/**
+ * Scan an unsigned decimal integer.
+ * @param pos The first digit, advanced past the last on success.
+ * @param end The end of the text, which need not be null terminated.
+ * @param value Set to the integer.
+ * @return false, leaving pos unchanged, if there is no digit at pos or the integer doesn't fit in 32 bits.
+ */
+bool scan_uint(const char *&pos, const char *end, uint32_t &value);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+/**
+ * Binary caches of vectors parsed from text files. A cache holds the raw float32 triples
+ * along with the size and modification time of the text file they came from, so it can be
+ * used in place of the text only while that file is unchanged.
+ */
+
+/**
+ * Read vectors from a cache.
+ * @param cache_file_name The cache to read.
+ * @param source_file_name The text file the cache was built from.
+ * @param vectors Filled with the cached vectors.
+ * @return false if there is no cache, it can't be read or the source has changed since it was written.
+ */
+bool load_vec3f_cache(const std::string &cache_file_name,
+                      const std::string &source_file_name,
+                      std::vector<Eigen::Vector3f> &vectors);
+
+/**
+ * Write vectors to a cache, replacing any existing cache atomically.
+ * @param cache_file_name The cache to write.
+ * @param source_file_name The text file the vectors were parsed from.
+ * @param vectors The vectors.
+ * @return false if the cache couldn't be written.
+ */
+bool save_vec3f_cache(const std::string &cache_file_name,
+                      const std::string &source_file_name,
+                      const std::vector<Eigen::Vector3f> &vectors);
+
+/**
+ * Read a text file of x, y, z triples as read_vec3f_text_file does, but from a binary cache
+ * in a .vec3_cache subdirectory alongside it whenever that cache is current. The cache is
+ * written (or refreshed) whenever the text has to be parsed. If it can't be written the text
+ * is still returned; only the first such failure in a process is reported.
+ * @param file_name The text file to read.
+ * @return The triples in file order.
+ */
+std::vector<Eigen::Vector3f> read_vec3f_text_file_cached(const std::string &file_name);
@@ -0,0 +1,313 @@
+//
+// Bulk parsing of line oriented numeric text files
+//
+
+#include <FileUtils/TextFileParser.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  /* Powers of ten which are exact as floats */
+  const float EXACT_POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  const int MAX_EXACT_EXPONENT = 10;
+
+  /* Mantissas up to 2^24 are exact as floats */
+  const uint64_t MAX_EXACT_MANTISSA = (uint64_t) 1 << 24;
+
+  /* Stop accumulating digits well before a uint64_t could overflow */
+  const int MAX_MANTISSA_DIGITS = 18;
+
+  /* Longest number handed to strtof */
+  const size_t MAX_NUMBER_LENGTH = 64;
+
+  inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+  }
+
+  /*
+   * Add a digit to a mantissa of at most MAX_MANTISSA_DIGITS significant digits, adjusting
+   * the decimal exponent for digits after the point or beyond those kept.
+   */
+  void
+  accumulate_digit(char c, uint64_t &mantissa, int &digits, int &exponent, bool after_point) {
+    // Leading zeros are not significant
+    if (mantissa == 0 && c == '0') {
+      if (after_point) {
+        --exponent;
+      }
+      return;
+    }
+    if (digits < MAX_MANTISSA_DIGITS) {
+      mantissa = mantissa * 10 + (c - '0');
+      if (after_point) {
+        --exponent;
+      }
+    } else if (!after_point) {
+      ++exponent;
+    }
+    ++digits;
+  }
+
+  /* Numbers the fast path can't round exactly, along with nan and inf, go to strtof */
+  bool
+  scan_float_slowly(const char *&pos, const char *end, float &value) {
+    char buffer[MAX_NUMBER_LENGTH + 1];
+    const auto length = std::min((size_t) (end - pos), MAX_NUMBER_LENGTH);
+    memcpy(buffer, pos, length);
+    buffer[length] = '\0';
+    char *parsed_end;
+    value = strtof(buffer, &parsed_end);
+    if (parsed_end == buffer) {
+      return false;
+    }
+    pos += parsed_end - buffer;
+    return true;
+  }
+
+  /*
+   * Walks the lines of a mapped text file. The mapping is not null terminated so every read
+   * is bounded by the end of the current line.
+   */
+  class LineParser {
+  public:
+    LineParser(const std::string &file_name, const char *begin, const char *end) //
+        : m_file_name{file_name} //
+        , m_next_line{begin} //
+        , m_end{end} //
+        , m_line_start{begin} //
+        , m_pos{begin} //
+        , m_line_end{begin} //
+        , m_line_number{0} //
+    {}
+
+    /* Move to the next line which isn't blank. Returns false at the end of the file. */
+    bool next_line() {
+      while (m_next_line < m_end) {
+        m_line_start = m_next_line;
+        m_pos = m_next_line;
+        auto newline = static_cast<const char *>(memchr(m_pos, '\n', m_end - m_pos));
+        m_line_end = newline ? newline : m_end;
+        m_next_line = newline ? newline + 1 : m_end;
+        ++m_line_number;
+        skip_spaces();
+        if (m_pos != m_line_end) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void expect(char c) {
+      skip_spaces();
+      if (m_pos == m_line_end || *m_pos != c) {
+        fail(std::string{"expected '"} + c + "'");
+      }
+      ++m_pos;
+    }
+
+    void expect_end_of_line() {
+      skip_spaces();
+      if (m_pos != m_line_end) {
+        fail("unexpected trailing characters");
+      }
+    }
+
+    float parse_float() {
+      skip_spaces();
+      float value;
+      if (!scan_float(m_pos, m_line_end, value)) {
+        fail("expected a number");
+      }
+      return value;
+    }
+
+    unsigned int parse_uint() {
+      skip_spaces();
+      if (m_pos == m_line_end || !is_digit(*m_pos)) {
+        fail("expected an unsigned integer");
+      }
+      uint32_t value;
+      if (!scan_uint(m_pos, m_line_end, value)) {
+        fail("integer out of range");
+      }
+      return value;
+    }
+
+    /* An upper bound on the number of lines left, for reserving space */
+    size_t max_lines() const {
+      return std::count(m_next_line, m_end, '\n') + 1;
+    }
+
+  private:
+    /* Spaces, tabs and the carriage return of CRLF line endings */
+    void skip_spaces() {
+      while (m_pos != m_line_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r')) {
+        ++m_pos;
+      }
+    }
+
+    [[noreturn]] void fail(const std::string &message) const {
+      throw std::runtime_error(m_file_name + ":" + std::to_string(m_line_number) + ": " + message
+                                   + " in '" + std::string{m_line_start, m_line_end} + "'");
+    }
+
+    const std::string &m_file_name;
+    const char *m_next_line;
+    const char *const m_end;
+    const char *m_line_start;
+    const char *m_pos;
+    const char *m_line_end;
+    size_t m_line_number;
+  };
+}
+
+/*
+ * Map the whole file read only. Empty files have no mapping.
+ */
+std::shared_ptr<const char>
+map_text_file(const std::string &file_name, size_t &file_size) {
+  const auto fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Couldn't open " + file_name);
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Couldn't stat " + file_name);
+  }
+  file_size = (size_t) st.st_size;
+  if (file_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  auto base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    throw std::runtime_error("Couldn't map " + file_name);
+  }
+  madvise(base, file_size, MADV_SEQUENTIAL);
+  return {static_cast<const char *>(base), [file_size](const char *p) { munmap((void *) p, file_size); }};
+}
+
+bool
+scan_float(const char *&pos, const char *end, float &value) {
+  auto p = pos;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool seen_digit = false;
+  for (; p != end && is_digit(*p); ++p) {
+    seen_digit = true;
+    accumulate_digit(*p, mantissa, digits, exponent, false);
+  }
+  if (p != end && *p == '.') {
+    for (++p; p != end && is_digit(*p); ++p) {
+      seen_digit = true;
+      accumulate_digit(*p, mantissa, digits, exponent, true);
+    }
+  }
+  if (seen_digit && p != end && (*p == 'e' || *p == 'E')) {
+    auto q = p + 1;
+    bool negative_exponent = false;
+    if (q != end && (*q == '-' || *q == '+')) {
+      negative_exponent = (*q == '-');
+      ++q;
+    }
+    if (q != end && is_digit(*q)) {
+      int e = 0;
+      for (; q != end && is_digit(*q); ++q) {
+        e = std::min(e * 10 + (*q - '0'), 100000);
+      }
+      exponent += negative_exponent ? -e : e;
+      p = q;
+    }
+  }
+
+  // Exact integer mantissa and power of ten give a correctly rounded product or quotient
+  if (seen_digit && (mantissa == 0 || (digits <= MAX_MANTISSA_DIGITS && mantissa <= MAX_EXACT_MANTISSA
+      && exponent >= -MAX_EXACT_EXPONENT && exponent <= MAX_EXACT_EXPONENT))) {
+    value = (float) mantissa;
+    value = (mantissa == 0) ? 0.0f : (exponent < 0)
+            ? value / EXACT_POWERS_OF_TEN[-exponent]
+            : value * EXACT_POWERS_OF_TEN[exponent];
+    if (negative) {
+      value = -value;
+    }
+    pos = p;
+    return true;
+  }
+  return scan_float_slowly(pos, end, value);
+}
+
+bool
+scan_uint(const char *&pos, const char *end, uint32_t &value) {
+  auto p = pos;
+  uint64_t result = 0;
+  for (; p != end && is_digit(*p); ++p) {
+    result = result * 10 + (*p - '0');
+    if (result > UINT32_MAX) {
+      return false;
+    }
+  }
+  if (p == pos) {
+    return false;
+  }
+  value = (uint32_t) result;
+  pos = p;
+  return true;
+}
+
+std::vector<Eigen::Vector3f>
+read_vec3f_text_file(const std::string &file_name) {
+  size_t file_size;
+  const auto mapping = map_text_file(file_name, file_size);
+  LineParser parser{file_name, mapping.get(), mapping.get() + file_size};
+
+  std::vector<Eigen::Vector3f> vectors;
+  vectors.reserve(parser.max_lines());
+  while (parser.next_line()) {
+    const auto x = parser.parse_float();
+    parser.expect(',');
+    const auto y = parser.parse_float();
+    parser.expect(',');
+    const auto z = parser.parse_float();
+    parser.expect_end_of_line();
+    vectors.emplace_back(x, y, z);
+  }
+  return vectors;
+}
+
+std::vector<std::pair<unsigned int, unsigned int>>
+read_uint_pair_text_file(const std::string &file_name) {
+  size_t file_size;
+  const auto mapping = map_text_file(file_name, file_size);
+  LineParser parser{file_name, mapping.get(), mapping.get() + file_size};
+
+  std::vector<std::pair<unsigned int, unsigned int>> pairs;
+  pairs.reserve(parser.max_lines());
+  while (parser.next_line()) {
+    parser.expect('(');
+    const auto first = parser.parse_uint();
+    parser.expect(',');
+    const auto second = parser.parse_uint();
+    parser.expect(')');
+    parser.expect_end_of_line();
+    pairs.emplace_back(first, second);
+  }
+  return pairs;
+}
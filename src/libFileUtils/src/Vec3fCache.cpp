@@ -0,0 +1,158 @@
+//
+// Binary caches of vectors parsed from text files
+//
+
+#include <FileUtils/Vec3fCache.h>
+#include <FileUtils/TextFileParser.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char MAGIC[4] = {'A', 'V', '3', 'C'};
+  const uint16_t VERSION = 1;
+
+  /* Subdirectory of a text file's directory holding binary copies of its contents */
+  const char *CACHE_DIRECTORY = ".vec3_cache";
+  const char *CACHE_EXTENSION = ".v3c";
+
+  /* Set once a failed cache write has been reported; later failures are silent */
+  std::atomic<bool> reported_unwritable_cache{false};
+
+  struct Vec3fCacheHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t num_vectors;
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+  };
+  static_assert(sizeof(Vec3fCacheHeader) == 32, "Unexpected vec3f cache header size");
+  static_assert(sizeof(Eigen::Vector3f) == 3 * sizeof(float), "Vector3f must be packed to copy it in bulk");
+
+  /*
+   * Size and modification time in nanoseconds of a file.
+   */
+  bool
+  source_signature(const std::string &file_name, uint64_t &size, int64_t &mtime_ns) {
+    struct stat st{};
+    if (stat(file_name.c_str(), &st) != 0) {
+      return false;
+    }
+    size = (uint64_t) st.st_size;
+#ifdef __APPLE__
+    mtime_ns = (int64_t) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    mtime_ns = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    return true;
+  }
+}
+
+bool
+load_vec3f_cache(const std::string &cache_file_name,
+                 const std::string &source_file_name,
+                 std::vector<Eigen::Vector3f> &vectors) {
+  uint64_t source_size;
+  int64_t source_mtime_ns;
+  if (!source_signature(source_file_name, source_size, source_mtime_ns)) {
+    return false;
+  }
+
+  const auto fd = open(cache_file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Vec3fCacheHeader)) {
+    close(fd);
+    return false;
+  }
+  const auto file_size = (size_t) st.st_size;
+  const auto base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+
+  Vec3fCacheHeader header{};
+  memcpy(&header, base, sizeof(header));
+  const bool valid = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+      && header.version == VERSION
+      && header.source_size == source_size
+      && header.source_mtime_ns == source_mtime_ns
+      && header.num_vectors == (file_size - sizeof(header)) / sizeof(Eigen::Vector3f)
+      && (file_size - sizeof(header)) % sizeof(Eigen::Vector3f) == 0;
+  if (valid) {
+    vectors.resize(header.num_vectors);
+    if (!vectors.empty()) {
+      memcpy(static_cast<void *>(vectors.data()), static_cast<const char *>(base) + sizeof(header), file_size - sizeof(header));
+    }
+  }
+  munmap(base, file_size);
+  return valid;
+}
+
+bool
+save_vec3f_cache(const std::string &cache_file_name,
+                 const std::string &source_file_name,
+                 const std::vector<Eigen::Vector3f> &vectors) {
+  Vec3fCacheHeader header{};
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.num_vectors = vectors.size();
+  if (!source_signature(source_file_name, header.source_size, header.source_mtime_ns)) {
+    return false;
+  }
+
+  // Write alongside and rename so readers never see a partial cache
+  const auto temp_file_name = cache_file_name + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream file{temp_file_name, std::ios::out | std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(vectors.data()), (std::streamsize) (vectors.size() * sizeof(Eigen::Vector3f)));
+    if (!file) {
+      file.close();
+      std::remove(temp_file_name.c_str());
+      return false;
+    }
+  }
+  if (std::rename(temp_file_name.c_str(), cache_file_name.c_str()) != 0) {
+    std::remove(temp_file_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::vector<Eigen::Vector3f>
+read_vec3f_text_file_cached(const std::string &file_name) {
+  const auto separator = file_name.find_last_of('/');
+  const auto directory = (separator == std::string::npos) ? std::string{"."} : file_name.substr(0, separator);
+  const auto name = (separator == std::string::npos) ? file_name : file_name.substr(separator + 1);
+  const auto cache_directory = directory + "/" + CACHE_DIRECTORY;
+  const auto cache_file_name = cache_directory + "/" + name + CACHE_EXTENSION;
+
+  std::vector<Eigen::Vector3f> vectors;
+  if (load_vec3f_cache(cache_file_name, file_name, vectors)) {
+    return vectors;
+  }
+  vectors = read_vec3f_text_file(file_name);
+
+  // Failing to write the cache only costs the next run, and a read-only directory
+  // fails for every file in it, so say so once
+  mkdir(cache_directory.c_str(), 0755);
+  if (!save_vec3f_cache(cache_file_name, file_name, vectors)
+      && !reported_unwritable_cache.exchange(true)) {
+    std::cerr << "Couldn't write vector cache " << cache_file_name
+              << "; further cache write failures won't be reported" << std::endl;
+  }
+  return vectors;
+}
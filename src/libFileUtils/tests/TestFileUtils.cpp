@@ -82,3 +82,169 @@ TEST_F(TestFileUtils, FileNameExtensionWithNeither) {
   EXPECT_EQ( "", actual.first);
   EXPECT_EQ( "", actual.second);
 }
+
+TEST_F(TestFileUtils, FrameLoaderDeliversFramesInOrder) {
+  using namespace std;
+  const unsigned int num_frames = 50;
+  // Later frames load faster so they complete out of order
+  FrameLoader<vector<unsigned int>> loader{
+      num_frames,
+      [](unsigned int frame) {
+        this_thread::sleep_for(chrono::microseconds((num_frames - frame) * 20));
+        return vector<unsigned int>(frame + 1, frame);
+      },
+      [](const vector<unsigned int> &frame) { return frame.size() * sizeof(unsigned int); },
+      FrameLoader<vector<unsigned int>>::DEFAULT_MEMORY_CEILING,
+      4};
+
+  unsigned int expected = 0;
+  loader.for_each([&expected](unsigned int frame_index, vector<unsigned int> &&frame) {
+    EXPECT_EQ(expected, frame_index);
+    EXPECT_EQ(frame_index + 1, frame.size());
+    EXPECT_EQ(frame_index, frame.front());
+    ++expected;
+  });
+  EXPECT_EQ(num_frames, expected);
+}
+
+TEST_F(TestFileUtils, FrameLoaderStaysUnderMemoryCeiling) {
+  using namespace std;
+  atomic<unsigned int> frames_loaded{0};
+  FrameLoader<unsigned int> loader{
+      100,
+      [&frames_loaded](unsigned int frame) {
+        ++frames_loaded;
+        return frame;
+      },
+      [](const unsigned int &) { return (size_t) 1; },
+      3,
+      4};
+
+  unsigned int frame;
+  unsigned int frame_index;
+  for (unsigned int expected = 0; expected < 100; ++expected) {
+    ASSERT_TRUE(loader.next(frame, frame_index));
+    EXPECT_EQ(expected, frame);
+    // Give the loaders time to run ahead as far as they are allowed
+    this_thread::sleep_for(chrono::microseconds(200));
+    // At most three frames buffered plus one in flight per loader
+    EXPECT_LE(frames_loaded.load(), expected + 1 + 3 + 4);
+  }
+  EXPECT_FALSE(loader.next(frame, frame_index));
+}
+
+TEST_F(TestFileUtils, FrameLoaderRethrowsAfterEarlierFrames) {
+  using namespace std;
+  FrameLoader<unsigned int> loader{
+      20,
+      [](unsigned int frame) {
+        if (frame == 7) {
+          throw runtime_error("Bad frame");
+        }
+        return frame;
+      },
+      [](const unsigned int &) { return sizeof(unsigned int); }};
+
+  unsigned int frames_delivered = 0;
+  EXPECT_THROW(loader.for_each([&frames_delivered](unsigned int, unsigned int &&) { ++frames_delivered; }),
+               runtime_error);
+  EXPECT_EQ(7, frames_delivered);
+}
+
+TEST_F(TestFileUtils, Vec3fTextFileShouldMatchStof) {
+  using namespace std;
+  const vector<string> values{"0", "-0.5", "1.23457", "-12.3457", "1.23457e-05", "-4.2e+07", "3.4e-20", "0.000123457",
+                              "16777217", "123456789.123", "1e3", "nan", "-inf", "+2.5"};
+  const string file_name = "vec3f_text_file_test.txt";
+  vector<string> lines;
+  {
+    ofstream file{file_name};
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto line = values[i] + ", " + values[(i + 1) % values.size()] + "," + values[(i + 2) % values.size()];
+      file << line << (i % 2 ? "\r\n" : "\n");
+      if (i == 3) {
+        file << "\n";
+      }
+      lines.push_back(line);
+    }
+  }
+
+  const auto vectors = read_vec3f_text_file(file_name);
+  remove(file_name.c_str());
+
+  ASSERT_EQ(lines.size(), vectors.size());
+  for (size_t i = 0; i < lines.size(); ++i) {
+    for (unsigned int c = 0; c < 3; ++c) {
+      const auto expected = stof(values[(i + c) % values.size()]);
+      if (isnan(expected)) {
+        EXPECT_TRUE(isnan(vectors[i][c]));
+      } else {
+        EXPECT_EQ(expected, vectors[i][c]) << lines[i];
+      }
+    }
+  }
+}
+
+TEST_F(TestFileUtils, TextFileErrorsShouldGiveLineNumber) {
+  using namespace std;
+  const string file_name = "pair_text_file_test.txt";
+  {
+    ofstream file{file_name};
+    file << "(1, 2)\n( 30 ,40 )\n\n(5, x)\n";
+  }
+
+  try {
+    read_uint_pair_text_file(file_name);
+    FAIL() << "Expected a parse error";
+  } catch (const runtime_error &e) {
+    EXPECT_NE(string::npos, string{e.what()}.find(file_name + ":4:"));
+  }
+
+  {
+    ofstream file{file_name};
+    file << "(1, 2)\n( 30 ,40 )\n\n";
+  }
+  const auto pairs = read_uint_pair_text_file(file_name);
+  remove(file_name.c_str());
+  ASSERT_EQ(2, pairs.size());
+  EXPECT_EQ(make_pair(1u, 2u), pairs[0]);
+  EXPECT_EQ(make_pair(30u, 40u), pairs[1]);
+}
+
+TEST_F(TestFileUtils, Vec3fCacheShouldOnlyBeUsedWhileSourceIsUnchanged) {
+  using namespace std;
+  const string file_name = "vec3f_cache_test.txt";
+  const string cache_file_name = ".vec3_cache/" + file_name + ".v3c";
+  {
+    ofstream file{file_name};
+    file << "1, 2, 3\n4, 5, 6\n";
+  }
+
+  // First read parses and writes the cache
+  auto vectors = read_vec3f_text_file_cached(file_name);
+  ASSERT_EQ(2, vectors.size());
+  EXPECT_EQ(Eigen::Vector3f(4, 5, 6), vectors[1]);
+  vector<Eigen::Vector3f> cached;
+  ASSERT_TRUE(load_vec3f_cache(cache_file_name, file_name, cached));
+  EXPECT_EQ(vectors, cached);
+
+  // A cache for other contents is used while the source looks unchanged...
+  ASSERT_TRUE(save_vec3f_cache(cache_file_name, file_name, {Eigen::Vector3f{7, 8, 9}}));
+  vectors = read_vec3f_text_file_cached(file_name);
+  ASSERT_EQ(1, vectors.size());
+  EXPECT_EQ(Eigen::Vector3f(7, 8, 9), vectors[0]);
+
+  // ...and ignored once it changes
+  {
+    ofstream file{file_name, ios::app};
+    file << "10, 11, 12\n";
+  }
+  EXPECT_FALSE(load_vec3f_cache(cache_file_name, file_name, cached));
+  vectors = read_vec3f_text_file_cached(file_name);
+  ASSERT_EQ(3, vectors.size());
+  EXPECT_EQ(Eigen::Vector3f(10, 11, 12), vectors[2]);
+
+  remove(cache_file_name.c_str());
+  remove(".vec3_cache");
+  remove(file_name.c_str());
+}
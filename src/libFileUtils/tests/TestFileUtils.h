@@ -2,6 +2,14 @@
 
 #include "gtest/gtest.h"
 #include <FileUtils/FileUtils.h>
+#include <FileUtils/FrameLoader.h>
+#include <FileUtils/TextFileParser.h>
+#include <FileUtils/Vec3fCache.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 
 class TestFileUtils : public ::testing::Test {
 public:
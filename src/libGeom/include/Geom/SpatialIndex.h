@@ -0,0 +1,487 @@
+/**
+ * Nearest neighbour search over 3D points.
+ *
+ * KdTree answers k nearest and radius queries. VoxelHash answers radius queries for one
+ * radius fixed when it is built, which is cheaper when every query uses the same radius.
+ * Both index points given as the columns of a 3xN matrix; a vector of Vector3f can be
+ * indexed in place through as_point_matrix. Indices returned are columns of that matrix.
+ */
+#pragma once
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace animesh {
+
+/**
+ * View a vector of points as the columns of a 3xN matrix without copying them.
+ */
+inline Eigen::Map<const Eigen::Matrix3Xf>
+as_point_matrix(const std::vector<Eigen::Vector3f> &points) {
+  static_assert(sizeof(Eigen::Vector3f) == 3 * sizeof(float), "Vector3f must be packed to map it as a matrix");
+  return {points.empty() ? nullptr : points.data()->data(), 3, (Eigen::Index) points.size()};
+}
+
+namespace spatial_index {
+/* Largest number of points held in a k-d tree leaf */
+const unsigned int LEAF_SIZE = 8;
+
+/* Offsets to the neighbours of a voxel which follow it, one of each pair of opposites */
+const int64_t FORWARD_NEIGHBOURS[13][3] = {
+    {0, 0, 1},
+    {0, 1, -1}, {0, 1, 0}, {0, 1, 1},
+    {1, -1, -1}, {1, -1, 0}, {1, -1, 1},
+    {1, 0, -1}, {1, 0, 0}, {1, 0, 1},
+    {1, 1, -1}, {1, 1, 0}, {1, 1, 1}
+};
+
+/* Fewest queries worth giving a thread of their own */
+const size_t MIN_QUERIES_PER_THREAD = 256;
+
+inline unsigned int
+thread_count(unsigned int num_threads) {
+  return (num_threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : num_threads;
+}
+
+/*
+ * Run band_function(first, end) over bands of [0, count) on up to num_threads threads,
+ * giving each thread at least MIN_QUERIES_PER_THREAD entries.
+ */
+inline void
+for_each_band(size_t count, unsigned int num_threads, const std::function<void(size_t, size_t)> &band_function) {
+  const auto bands = std::max<size_t>(1, std::min<size_t>(thread_count(num_threads), count / MIN_QUERIES_PER_THREAD));
+  if (bands == 1) {
+    band_function(0, count);
+    return;
+  }
+  const auto per_band = (count + bands - 1) / bands;
+  std::vector<std::thread> threads;
+  for (size_t first = per_band; first < count; first += per_band) {
+    threads.emplace_back(band_function, first, std::min(count, first + per_band));
+  }
+  band_function(0, per_band);
+  for (auto &t: threads) {
+    t.join();
+  }
+}
+
+/*
+ * Run item_function(i) for each i in [0, count) on up to num_threads threads. Items are
+ * handed out one at a time, so this suits a few items of uneven cost, such as whole frames.
+ */
+inline void
+for_each_index(size_t count, unsigned int num_threads, const std::function<void(size_t)> &item_function) {
+  std::atomic<size_t> next{0};
+  const auto worker = [&]() {
+    for (auto i = next++; i < count; i = next++) {
+      item_function(i);
+    }
+  };
+  const auto workers = std::max<size_t>(1, std::min<size_t>(thread_count(num_threads), count));
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < workers; ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t: threads) {
+    t.join();
+  }
+}
+}
+
+/**
+ * An implicit k-d tree. Node n covers a range of points and, unless the range fits in a
+ * leaf, splits it at its midpoint into children 2n and 2n+1, so only the split of each node
+ * is stored. The tree keeps its own copy of the points ordered so that each leaf is
+ * contiguous.
+ */
+class KdTree {
+public:
+  /**
+   * @param points The points to index, one per column.
+   * @param num_threads Threads to build with, 0 for one per hardware thread.
+   */
+  explicit KdTree(const Eigen::Ref<const Eigen::Matrix3Xf> &points, unsigned int num_threads = 0) //
+      : m_points(3, points.cols()) //
+      , m_indices((size_t) points.cols()) //
+  {
+    using namespace spatial_index;
+
+    const auto num_points = (unsigned int) points.cols();
+    std::iota(m_indices.begin(), m_indices.end(), 0);
+
+    unsigned int depth = 0;
+    for (auto range = num_points; range > LEAF_SIZE; range = (range + 1) / 2) {
+      ++depth;
+    }
+    m_split_dimension.resize((size_t) 2 << depth);
+    m_split_value.resize((size_t) 2 << depth);
+
+    // Give each thread its own subtree once there are enough of them to go round
+    unsigned int spawn_depth = 0;
+    while ((1u << spawn_depth) < thread_count(num_threads) && spawn_depth < depth) {
+      ++spawn_depth;
+    }
+    build(points, 1, 0, num_points, spawn_depth);
+
+    for_each_band(num_points, num_threads, [&](size_t first, size_t end) {
+      for (auto i = first; i < end; ++i) {
+        m_points.col((Eigen::Index) i) = points.col(m_indices[i]);
+      }
+    });
+  }
+
+  inline size_t size() const { return m_indices.size(); }
+
+  /**
+   * Find the k points nearest to a query point.
+   * @param indices Filled with the indices of the nearest points, closest first. Must hold k entries.
+   * @param squared_distances Filled with the squared distance to each of them. Must hold k entries.
+   * @return The number of points found, which is k unless the tree holds fewer points.
+   */
+  unsigned int
+  nearest(const Eigen::Vector3f &query, unsigned int k, int *indices, float *squared_distances) const {
+    Neighbours neighbours{indices, squared_distances, k, 0};
+    if (k > 0 && !m_indices.empty()) {
+      search_nearest(1, 0, (unsigned int) size(), query, neighbours);
+    }
+    return neighbours.count;
+  }
+
+  /**
+   * Find the k points nearest to each of several query points in parallel.
+   * @param queries The query points, one per column.
+   * @param indices Resized to k x queries; column q holds the nearest points to query q,
+   * closest first, padded with -1 if the tree holds fewer than k points.
+   * @param squared_distances Resized to k x queries; the squared distance to each point found
+   * or infinity for padding.
+   */
+  void
+  nearest_batch(const Eigen::Ref<const Eigen::Matrix3Xf> &queries, unsigned int k,
+                Eigen::MatrixXi &indices, Eigen::MatrixXf &squared_distances,
+                unsigned int num_threads = 0) const {
+    indices.setConstant(k, queries.cols(), -1);
+    squared_distances.setConstant(k, queries.cols(), std::numeric_limits<float>::infinity());
+    spatial_index::for_each_band((size_t) queries.cols(), num_threads, [&](size_t first, size_t end) {
+      for (auto q = (Eigen::Index) first; q < (Eigen::Index) end; ++q) {
+        nearest(queries.col(q), k, indices.col(q).data(), squared_distances.col(q).data());
+      }
+    });
+  }
+
+  /**
+   * Find the k points nearest to each indexed point in parallel, as nearest_batch would with
+   * the indexed points as queries. Each point is among its own nearest. Points are queried in
+   * tree order, so successive queries visit much the same nodes.
+   */
+  void
+  nearest_to_each_point(unsigned int k, Eigen::MatrixXi &indices, Eigen::MatrixXf &squared_distances,
+                        unsigned int num_threads = 0) const {
+    indices.setConstant(k, (Eigen::Index) size(), -1);
+    squared_distances.setConstant(k, (Eigen::Index) size(), std::numeric_limits<float>::infinity());
+    spatial_index::for_each_band(size(), num_threads, [&](size_t first, size_t end) {
+      for (auto i = first; i < end; ++i) {
+        const auto q = m_indices[i];
+        nearest(m_points.col((Eigen::Index) i), k, indices.col(q).data(), squared_distances.col(q).data());
+      }
+    });
+  }
+
+  /**
+   * Find the points no further than radius from a query point.
+   * @param indices The indices of the points found are appended here, in no particular order.
+   */
+  void
+  within_radius(const Eigen::Vector3f &query, float radius, std::vector<int> &indices) const {
+    if (!m_indices.empty()) {
+      search_radius(1, 0, (unsigned int) size(), query, radius * radius, indices);
+    }
+  }
+
+  /**
+   * Find the points no further than radius from each of several query points in parallel.
+   * @return For each query, the indices of the points found in no particular order.
+   */
+  std::vector<std::vector<int>>
+  within_radius_batch(const Eigen::Ref<const Eigen::Matrix3Xf> &queries, float radius,
+                      unsigned int num_threads = 0) const {
+    std::vector<std::vector<int>> neighbours((size_t) queries.cols());
+    spatial_index::for_each_band((size_t) queries.cols(), num_threads, [&](size_t first, size_t end) {
+      for (auto q = first; q < end; ++q) {
+        within_radius(queries.col((Eigen::Index) q), radius, neighbours[q]);
+      }
+    });
+    return neighbours;
+  }
+
+private:
+  /* Bounded list of the closest points found so far, closest first */
+  struct Neighbours {
+    int *indices;
+    float *squared_distances;
+    unsigned int k;
+    unsigned int count;
+  };
+
+  void
+  build(const Eigen::Ref<const Eigen::Matrix3Xf> &points, size_t node,
+        unsigned int begin, unsigned int end, unsigned int spawn_depth) {
+    if (end - begin <= spatial_index::LEAF_SIZE) {
+      return;
+    }
+
+    // Split across the widest extent of the range
+    Eigen::Vector3f lower = Eigen::Vector3f::Constant(std::numeric_limits<float>::infinity());
+    Eigen::Vector3f upper = -lower;
+    for (auto i = begin; i < end; ++i) {
+      lower = lower.cwiseMin(points.col(m_indices[i]));
+      upper = upper.cwiseMax(points.col(m_indices[i]));
+    }
+    Eigen::Index dimension;
+    (upper - lower).maxCoeff(&dimension);
+
+    const auto mid = begin + (end - begin) / 2;
+    std::nth_element(m_indices.begin() + begin, m_indices.begin() + mid, m_indices.begin() + end,
+                     [&](int a, int b) { return points(dimension, a) < points(dimension, b); });
+    m_split_dimension[node] = (uint8_t) dimension;
+    m_split_value[node] = points(dimension, m_indices[mid]);
+
+    if (spawn_depth > 0) {
+      std::thread left{[&]() { build(points, 2 * node, begin, mid, spawn_depth - 1); }};
+      build(points, 2 * node + 1, mid, end, spawn_depth - 1);
+      left.join();
+    } else {
+      build(points, 2 * node, begin, mid, 0);
+      build(points, 2 * node + 1, mid, end, 0);
+    }
+  }
+
+  void
+  search_nearest(size_t node, unsigned int begin, unsigned int end,
+                 const Eigen::Vector3f &query, Neighbours &neighbours) const {
+    if (end - begin <= spatial_index::LEAF_SIZE) {
+      for (auto i = begin; i < end; ++i) {
+        const auto squared_distance = (m_points.col(i) - query).squaredNorm();
+        if (neighbours.count == neighbours.k && squared_distance >= neighbours.squared_distances[neighbours.k - 1]) {
+          continue;
+        }
+        auto slot = (neighbours.count < neighbours.k) ? neighbours.count++ : neighbours.k - 1;
+        for (; slot > 0 && neighbours.squared_distances[slot - 1] > squared_distance; --slot) {
+          neighbours.squared_distances[slot] = neighbours.squared_distances[slot - 1];
+          neighbours.indices[slot] = neighbours.indices[slot - 1];
+        }
+        neighbours.squared_distances[slot] = squared_distance;
+        neighbours.indices[slot] = m_indices[i];
+      }
+      return;
+    }
+
+    const auto mid = begin + (end - begin) / 2;
+    const auto offset = query[m_split_dimension[node]] - m_split_value[node];
+    if (offset < 0) {
+      search_nearest(2 * node, begin, mid, query, neighbours);
+    } else {
+      search_nearest(2 * node + 1, mid, end, query, neighbours);
+    }
+    // Every point across the split is at least offset away
+    if (neighbours.count < neighbours.k || offset * offset < neighbours.squared_distances[neighbours.k - 1]) {
+      if (offset < 0) {
+        search_nearest(2 * node + 1, mid, end, query, neighbours);
+      } else {
+        search_nearest(2 * node, begin, mid, query, neighbours);
+      }
+    }
+  }
+
+  void
+  search_radius(size_t node, unsigned int begin, unsigned int end,
+                const Eigen::Vector3f &query, float squared_radius, std::vector<int> &indices) const {
+    if (end - begin <= spatial_index::LEAF_SIZE) {
+      for (auto i = begin; i < end; ++i) {
+        if ((m_points.col(i) - query).squaredNorm() <= squared_radius) {
+          indices.push_back(m_indices[i]);
+        }
+      }
+      return;
+    }
+
+    const auto mid = begin + (end - begin) / 2;
+    const auto offset = query[m_split_dimension[node]] - m_split_value[node];
+    if (offset <= 0 || offset * offset <= squared_radius) {
+      search_radius(2 * node, begin, mid, query, squared_radius, indices);
+    }
+    if (offset >= 0 || offset * offset <= squared_radius) {
+      search_radius(2 * node + 1, mid, end, query, squared_radius, indices);
+    }
+  }
+
+  /* The points in tree order */
+  Eigen::Matrix3Xf m_points;
+  /* Index in the caller's points of each point in tree order */
+  std::vector<int> m_indices;
+  /* Split of each interior node, indexed by node number */
+  std::vector<uint8_t> m_split_dimension;
+  std::vector<float> m_split_value;
+};
+
+/**
+ * Points bucketed into cubic voxels with sides as long as the search radius, so the points
+ * within that radius of any query lie in the 27 voxels around it. Voxels are found through a
+ * hash of their coordinates and the points of each voxel are stored contiguously.
+ */
+class VoxelHash {
+public:
+  /**
+   * @param points The points to index, one per column.
+   * @param radius The radius of every search.
+   */
+  VoxelHash(const Eigen::Ref<const Eigen::Matrix3Xf> &points, float radius) //
+      : m_radius{radius} //
+      , m_voxels_per_unit{1.0f / radius} //
+      , m_points(3, points.cols()) //
+      , m_indices((size_t) points.cols()) //
+  {
+    std::vector<std::pair<Voxel, int>> keyed((size_t) points.cols());
+    for (Eigen::Index i = 0; i < points.cols(); ++i) {
+      keyed[i] = {voxel_of(points.col(i)), (int) i};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    for (size_t i = 0; i < keyed.size(); ++i) {
+      m_points.col((Eigen::Index) i) = points.col(keyed[i].second);
+      m_indices[i] = keyed[i].second;
+      if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+        m_voxels.emplace(keyed[i].first, (uint32_t) m_voxel_starts.size());
+        m_voxel_starts.push_back((uint32_t) i);
+        m_voxel_coordinates.push_back(keyed[i].first);
+      }
+    }
+    m_voxel_starts.push_back((uint32_t) keyed.size());
+  }
+
+  inline size_t size() const { return m_indices.size(); }
+
+  inline float radius() const { return m_radius; }
+
+  /**
+   * Find the points no further than radius() from a query point.
+   * @param indices The indices of the points found are appended here, in no particular order.
+   */
+  void
+  within_radius(const Eigen::Vector3f &query, std::vector<int> &indices) const {
+    const auto squared_radius = m_radius * m_radius;
+    const auto centre = voxel_of(query);
+    for (int64_t dx = -1; dx <= 1; ++dx) {
+      for (int64_t dy = -1; dy <= 1; ++dy) {
+        for (int64_t dz = -1; dz <= 1; ++dz) {
+          const auto voxel = m_voxels.find(Voxel{centre[0] + dx, centre[1] + dy, centre[2] + dz});
+          if (voxel == m_voxels.end()) {
+            continue;
+          }
+          for (auto i = m_voxel_starts[voxel->second]; i < m_voxel_starts[voxel->second + 1]; ++i) {
+            if ((m_points.col(i) - query).squaredNorm() <= squared_radius) {
+              indices.push_back(m_indices[i]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Find the points no further than radius() from each of several query points in parallel.
+   * @return For each query, the indices of the points found in no particular order.
+   */
+  std::vector<std::vector<int>>
+  within_radius_batch(const Eigen::Ref<const Eigen::Matrix3Xf> &queries, unsigned int num_threads = 0) const {
+    std::vector<std::vector<int>> neighbours((size_t) queries.cols());
+    spatial_index::for_each_band((size_t) queries.cols(), num_threads, [&](size_t first, size_t end) {
+      for (auto q = first; q < end; ++q) {
+        within_radius(queries.col((Eigen::Index) q), neighbours[q]);
+      }
+    });
+    return neighbours;
+  }
+
+  /**
+   * Call pair_function(i, j) once for each pair of distinct indexed points no further than
+   * radius() apart. This is much cheaper than querying every point in turn: points are
+   * visited voxel by voxel and each voxel is only compared with its 13 neighbours that come
+   * after it, so every neighbouring voxel is fetched once per pair of voxels.
+   */
+  template<typename PairFunction>
+  void
+  for_each_pair_within_radius(PairFunction pair_function) const {
+    const auto squared_radius = m_radius * m_radius;
+    for (uint32_t voxel = 0; voxel + 1 < m_voxel_starts.size(); ++voxel) {
+      const auto begin = m_voxel_starts[voxel];
+      const auto end = m_voxel_starts[voxel + 1];
+      for (auto i = begin; i < end; ++i) {
+        for (auto j = i + 1; j < end; ++j) {
+          if ((m_points.col(i) - m_points.col(j)).squaredNorm() <= squared_radius) {
+            pair_function(m_indices[i], m_indices[j]);
+          }
+        }
+      }
+
+      const auto &centre = m_voxel_coordinates[voxel];
+      for (const auto &offset : spatial_index::FORWARD_NEIGHBOURS) {
+        const auto neighbour = m_voxels.find(Voxel{centre[0] + offset[0], centre[1] + offset[1], centre[2] + offset[2]});
+        if (neighbour == m_voxels.end()) {
+          continue;
+        }
+        const auto neighbour_begin = m_voxel_starts[neighbour->second];
+        const auto neighbour_end = m_voxel_starts[neighbour->second + 1];
+        for (auto i = begin; i < end; ++i) {
+          for (auto j = neighbour_begin; j < neighbour_end; ++j) {
+            if ((m_points.col(i) - m_points.col(j)).squaredNorm() <= squared_radius) {
+              pair_function(m_indices[i], m_indices[j]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+private:
+  /* Integer coordinates of a voxel. Voxels are keyed on all three in full so no two share a key. */
+  using Voxel = std::array<int64_t, 3>;
+
+  struct VoxelHasher {
+    inline size_t operator()(const Voxel &voxel) const {
+      return (size_t) (((uint64_t) voxel[0] * 73856093u) ^ ((uint64_t) voxel[1] * 19349663u) ^ ((uint64_t) voxel[2] * 83492791u));
+    }
+  };
+
+  inline Voxel
+  voxel_of(const Eigen::Vector3f &point) const {
+    return {(int64_t) std::floor(point.x() * m_voxels_per_unit),
+            (int64_t) std::floor(point.y() * m_voxels_per_unit),
+            (int64_t) std::floor(point.z() * m_voxels_per_unit)};
+  }
+
+  float m_radius;
+  float m_voxels_per_unit;
+  /* The points ordered by voxel */
+  Eigen::Matrix3Xf m_points;
+  /* Index in the caller's points of each point in voxel order */
+  std::vector<int> m_indices;
+  /* First point of each occupied voxel in m_points, and one past the last point */
+  std::vector<uint32_t> m_voxel_starts;
+  /* Coordinates of each occupied voxel */
+  std::vector<Voxel> m_voxel_coordinates;
+  /* Number of each occupied voxel */
+  std::unordered_map<Voxel, uint32_t, VoxelHasher> m_voxels;
+};
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * The quartiles of a set of values. The first and third quartiles are the medians of the
+ * lower and upper halves of the values; with an odd number of values the median itself
+ * belongs to neither half.
+ */
+struct Quartiles {
+  float first;
+  float median;
+  float third;
+
+  inline float interquartile_range() const { return third - first; }
+};
+
+/**
+ * Compute the quartiles of values in linear time by partial sorting.
+ * @param begin The first value. The values are reordered.
+ * @param end One past the last value.
+ * @throws std::invalid_argument if there are no values.
+ */
+Quartiles compute_quartiles(float *begin, float *end);
+
+inline Quartiles compute_quartiles(std::vector<float> &values) {
+  return compute_quartiles(values.data(), values.data() + values.size());
+}
@@ -0,0 +1,42 @@
+#include <Geom/Statistics.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+  /*
+   * Median of a non-empty range, leaving it partitioned about its middle.
+   */
+  float
+  median(float *begin, float *end) {
+    const auto count = end - begin;
+    const auto middle = begin + count / 2;
+    std::nth_element(begin, middle, end);
+    if (count % 2 == 1) {
+      return *middle;
+    }
+    // The other middle value is the largest of the lower half
+    return (*std::max_element(begin, middle) + *middle) / 2.0f;
+  }
+}
+
+Quartiles
+compute_quartiles(float *begin, float *end) {
+  const auto count = end - begin;
+  if (count <= 0) {
+    throw std::invalid_argument("Can't compute quartiles of no values");
+  }
+
+  Quartiles quartiles{};
+  quartiles.median = median(begin, end);
+  if (count == 1) {
+    quartiles.first = quartiles.third = quartiles.median;
+    return quartiles;
+  }
+
+  // Partitioning about the middle leaves the smallest half first and the largest half last
+  const auto half = count / 2;
+  quartiles.first = median(begin, begin + half);
+  quartiles.third = median(end - half, end);
+  return quartiles;
+}
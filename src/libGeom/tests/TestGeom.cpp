@@ -1,7 +1,11 @@
 #include "TestGeom.h"
 #include <Geom/Geom.h>
+#include <Geom/SpatialIndex.h>
+#include <Geom/Statistics.h>
 #include <Eigen/Geometry>
+#include <algorithm>
 #include <iostream>
+#include <random>
 
 #define EXPECT_THROW_WITH_MESSAGE(stmt, etype, whatstring) EXPECT_THROW( \
         try { \
@@ -951,3 +955,194 @@ TEST_F(TestGeom, CentroidOfThreePointsIsCorrect) {
 }
 
 
+
+/* ********************************************************************************
+ * ** Test nearest neighbour search
+ * ********************************************************************************/
+/* Random points in a unit cube with some exact duplicates */
+Eigen::Matrix3Xf random_points(unsigned int count, unsigned int seed) {
+  std::mt19937 rng{seed};
+  std::uniform_real_distribution<float> coordinate{0.0f, 1.0f};
+  Eigen::Matrix3Xf points(3, count);
+  for (unsigned int i = 0; i < count; ++i) {
+    if (i > 0 && i % 10 == 0) {
+      points.col(i) = points.col(i / 2);
+      continue;
+    }
+    points.col(i) = Eigen::Vector3f{coordinate(rng), coordinate(rng), coordinate(rng)};
+  }
+  return points;
+}
+
+std::vector<int> brute_force_within_radius(const Eigen::Matrix3Xf &points, const Eigen::Vector3f &query, float radius) {
+  std::vector<int> indices;
+  for (int i = 0; i < points.cols(); ++i) {
+    if ((points.col(i) - query).squaredNorm() <= radius * radius) {
+      indices.push_back(i);
+    }
+  }
+  return indices;
+}
+
+TEST_F(TestGeom, KdTreeNearestShouldMatchBruteForce) {
+  using namespace animesh;
+
+  const auto points = random_points(5000, 1);
+  const auto queries = random_points(1000, 2);
+  const unsigned int k = 6;
+  KdTree tree{points};
+  Eigen::MatrixXi indices;
+  Eigen::MatrixXf squared_distances;
+  tree.nearest_batch(queries, k, indices, squared_distances);
+
+  for (int q = 0; q < queries.cols(); ++q) {
+    std::vector<float> expected;
+    for (int i = 0; i < points.cols(); ++i) {
+      expected.push_back((points.col(i) - queries.col(q)).squaredNorm());
+    }
+    std::sort(expected.begin(), expected.end());
+    for (unsigned int j = 0; j < k; ++j) {
+      EXPECT_EQ(expected[j], squared_distances(j, q));
+      EXPECT_EQ(squared_distances(j, q), (points.col(indices(j, q)) - queries.col(q)).squaredNorm());
+    }
+  }
+
+  // Querying the indexed points themselves gives the same distances
+  Eigen::MatrixXi self_indices;
+  Eigen::MatrixXf self_squared_distances;
+  tree.nearest_to_each_point(k, self_indices, self_squared_distances);
+  Eigen::MatrixXi expected_indices;
+  Eigen::MatrixXf expected_squared_distances;
+  tree.nearest_batch(points, k, expected_indices, expected_squared_distances);
+  EXPECT_EQ(expected_squared_distances, self_squared_distances);
+  EXPECT_EQ(0.0f, self_squared_distances.row(0).maxCoeff());
+
+  // Fewer points than asked for are padded
+  KdTree small_tree{points.leftCols(3)};
+  small_tree.nearest_batch(queries.leftCols(1), 4, indices, squared_distances);
+  EXPECT_EQ(-1, indices(3, 0));
+  EXPECT_NE(-1, indices(2, 0));
+}
+
+TEST_F(TestGeom, KdTreeWithinRadiusShouldMatchBruteForce) {
+  using namespace animesh;
+
+  const auto points = random_points(5000, 3);
+  const auto queries = random_points(1000, 4);
+  const auto radius = 0.08f;
+  KdTree tree{points, 3};
+  auto found = tree.within_radius_batch(queries, radius);
+
+  ASSERT_EQ(queries.cols(), found.size());
+  for (int q = 0; q < queries.cols(); ++q) {
+    std::sort(found[q].begin(), found[q].end());
+    EXPECT_EQ(brute_force_within_radius(points, queries.col(q), radius), found[q]);
+  }
+}
+
+TEST_F(TestGeom, VoxelHashWithinRadiusShouldMatchBruteForce) {
+  using namespace animesh;
+
+  // Offset to straddle negative voxel coordinates
+  Eigen::Matrix3Xf points = random_points(5000, 5).array() - 0.5f;
+  Eigen::Matrix3Xf queries = random_points(1000, 6).array() - 0.5f;
+  const auto radius = 0.08f;
+  VoxelHash voxels{points, radius};
+  auto found = voxels.within_radius_batch(queries);
+
+  ASSERT_EQ(queries.cols(), found.size());
+  for (int q = 0; q < queries.cols(); ++q) {
+    std::sort(found[q].begin(), found[q].end());
+    EXPECT_EQ(brute_force_within_radius(points, queries.col(q), radius), found[q]);
+  }
+}
+
+TEST_F(TestGeom, VoxelHashPairsWithinRadiusShouldMatchBruteForce) {
+  using namespace animesh;
+
+  const auto points = random_points(3000, 7);
+  const auto radius = 0.06f;
+  VoxelHash voxels{points, radius};
+  std::vector<std::pair<int, int>> found;
+  voxels.for_each_pair_within_radius([&](int i, int j) {
+    found.emplace_back(std::min(i, j), std::max(i, j));
+  });
+  std::sort(found.begin(), found.end());
+
+  std::vector<std::pair<int, int>> expected;
+  for (int i = 0; i < points.cols(); ++i) {
+    for (const auto j: brute_force_within_radius(points, points.col(i), radius)) {
+      if (j > i) {
+        expected.emplace_back(i, j);
+      }
+    }
+  }
+  EXPECT_EQ(expected, found);
+}
+
+TEST_F(TestGeom, VoxelHashPairsShouldBeFoundInVoxelsFarApart) {
+  using namespace animesh;
+
+  // Voxel x coordinates differ by 2^21, so a key that wrapped each axis would confuse them
+  Eigen::Matrix3Xf points(3, 4);
+  points.col(0) = Eigen::Vector3f{0.5f, 0.5f, 0.5f};
+  points.col(1) = Eigen::Vector3f{1.2f, 0.5f, 0.5f};
+  points.col(2) = Eigen::Vector3f{2097152.5f, 0.5f, 0.5f};
+  points.col(3) = Eigen::Vector3f{2097152.5f, 0.5f, -0.2f};
+  VoxelHash voxels{points, 1.0f};
+  std::vector<std::pair<int, int>> found;
+  voxels.for_each_pair_within_radius([&](int i, int j) {
+    found.emplace_back(std::min(i, j), std::max(i, j));
+  });
+  std::sort(found.begin(), found.end());
+
+  EXPECT_EQ((std::vector<std::pair<int, int>>{{0, 1}, {2, 3}}), found);
+}
+
+TEST_F(TestGeom, PointMatrixShouldShareVectorStorage) {
+  using namespace animesh;
+
+  std::vector<Eigen::Vector3f> points{{1, 2, 3}, {4, 5, 6}};
+  const auto matrix = as_point_matrix(points);
+  EXPECT_EQ(points.data()->data(), matrix.data());
+  EXPECT_EQ(2, matrix.cols());
+  EXPECT_EQ(6.0f, matrix(2, 1));
+}
+
+/* ********************************************************************************
+ * ** Test quartiles
+ * ********************************************************************************/
+TEST_F(TestGeom, QuartilesShouldMatchSortedHalves) {
+  std::mt19937 rng{8};
+  std::uniform_real_distribution<float> value{-10.0f, 10.0f};
+  for (unsigned int count = 1; count < 40; ++count) {
+    std::vector<float> values;
+    for (unsigned int i = 0; i < count; ++i) {
+      values.push_back(value(rng));
+    }
+    auto sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    const auto median_of = [](const std::vector<float> &v, size_t begin, size_t end) {
+      const auto n = end - begin;
+      return (n % 2 == 1) ? v[begin + n / 2] : (v[begin + n / 2 - 1] + v[begin + n / 2]) / 2.0f;
+    };
+
+    const auto quartiles = compute_quartiles(values);
+    const auto half = count / 2;
+    EXPECT_EQ(median_of(sorted, 0, count), quartiles.median);
+    EXPECT_EQ((count == 1) ? sorted[0] : median_of(sorted, 0, half), quartiles.first);
+    EXPECT_EQ((count == 1) ? sorted[0] : median_of(sorted, count - half, count), quartiles.third);
+  }
+
+  std::vector<float> values{1, 2, 3, 4, 5, 6, 7, 8};
+  const auto quartiles = compute_quartiles(values);
+  EXPECT_FLOAT_EQ(2.5f, quartiles.first);
+  EXPECT_FLOAT_EQ(4.5f, quartiles.median);
+  EXPECT_FLOAT_EQ(6.5f, quartiles.third);
+  EXPECT_FLOAT_EQ(4.0f, quartiles.interquartile_range());
+}
+
+TEST_F(TestGeom, QuartilesOfNothingShouldThrow) {
+  std::vector<float> values;
+  EXPECT_THROW_WITH_MESSAGE(compute_quartiles(values), std::invalid_argument, "Can't compute quartiles of no values");
+}
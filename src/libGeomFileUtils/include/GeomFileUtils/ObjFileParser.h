@@ -2,14 +2,54 @@
 
 #include <Geom/Geom.h>
 #include <Eigen/Core>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
 
 namespace animesh {
 
+/**
+ * A polygon mesh held in flat arrays. The corners of face f are entries face_offsets[f] to
+ * face_offsets[f + 1] - 1 of face_vertices and face_normals.
+ */
+struct ObjMesh {
+	std::vector<Eigen::Vector3f> vertices;
+	/* Unit length 'vn' elements */
+	std::vector<Eigen::Vector3f> normals;
+	std::vector<uint32_t> face_offsets{0};
+	std::vector<uint32_t> face_vertices;
+	/* The normal of each corner or -1 if the file gives none */
+	std::vector<int32_t> face_normals;
+	/* Each edge of each face once, lower vertex first, in ascending order */
+	std::vector<std::pair<uint32_t, uint32_t>> edges;
+
+	inline size_t num_faces() const { return face_offsets.size() - 1; }
+};
+
 class ObjFileParser {
 public:
+	/**
+	 * Read the vertices, normals and faces of an OBJ file. The file is mapped and parsed in
+	 * place; large files are split into chunks of whole lines which are counted, so every
+	 * array is allocated once, and then parsed on separate threads. Faces may use any of the
+	 * v, v/vt, v//vn and v/vt/vn forms with absolute or negative relative indices. Texture
+	 * coordinates and all other elements are skipped.
+	 * @param file_name The name of the file.
+	 * @param with_edges Whether to fill in the unique edges of the mesh.
+	 * @param num_threads The most threads to parse with, or 0 to use one per core.
+	 * @throws std::runtime_error naming the file and line if it can't be read or parsed.
+	 */
+	static ObjMesh read_mesh( const std::string& file_name, bool with_edges = true, unsigned int num_threads = 0 );
+
+	/**
+	 * Compute a unit normal for each vertex of a mesh by summing the normals of its corners.
+	 * Corners without a normal use the area weighted normal of their face.
+	 * @param mesh The mesh.
+	 * @return The normal of each vertex, or zero for vertices in no face.
+	 */
+	static std::vector<Eigen::Vector3f> vertex_normals( const ObjMesh& mesh );
+
 	/**
 	 * Parse an OBJ file and return all PointNormals and adjacency.
 	 * @param file_name The name of the file.
@@ -2,11 +2,38 @@
 // Created by Dave Durbin (Old) on 26/9/21.
 //
 
+#pragma once
+
 #include <Eigen/Eigen>
+#include <array>
+#include <cstdint>
 #include <istream>
+#include <string>
+#include <vector>
 
 namespace animesh {
 
+/**
+ * A mesh held in flat arrays. The vertices of face f are face_vertices[face_offsets[f]]
+ * to face_vertices[face_offsets[f + 1] - 1].
+ */
+struct PlyMesh {
+  /* One row per vertex, so each coordinate is contiguous */
+  Eigen::MatrixX3f vertices;
+  /* One row per vertex or empty if the vertices have no nx, ny and nz */
+  Eigen::MatrixX3f normals;
+  std::vector<uint32_t> face_offsets{0};
+  std::vector<uint32_t> face_vertices;
+  /* The vertex1 and vertex2 of each edge element */
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  /* The red, green and blue of each edge or empty if the edges have no colour */
+  std::vector<std::array<uint8_t, 3>> edge_colours;
+
+  inline size_t num_vertices() const { return (size_t) vertices.rows(); }
+
+  inline size_t num_faces() const { return face_offsets.size() - 1; }
+};
+
 class PlyFileParser {
 public:
   struct PlyProperty {
@@ -22,8 +49,12 @@ public:
     int version;
     int num_vertices;
     int num_faces;
+    int num_edges;
     std::vector<PlyProperty> vertex_properties;
     std::vector<PlyProperty> face_properties;
+    std::vector<PlyProperty> edge_properties;
+    /* The elements in the order their data appears */
+    std::vector<std::string> elements;
   };
 
   /**
@@ -37,6 +68,27 @@ public:
   static std::pair<std::vector<Eigen::Vector3f>, std::vector<std::vector<std::size_t>>>
   parse_stream(std::istream &stream);
 
+  /**
+   * Read the vertices, faces and edges of a PLY file. The file is mapped and binary elements
+   * with no list properties are copied a property at a time straight out of the mapping,
+   * byte swapping whole columns where the file's byte order differs from the machine's.
+   * @param file_name The name of the file.
+   * @throws std::runtime_error if the file can't be read, is truncated or refers to missing vertices.
+   */
+  static PlyMesh read_mesh(const std::string &file_name);
+
+  /**
+   * Write a mesh as a PLY file. Binary element data is assembled in memory and written with a
+   * single write per element. Faces are written only if there are any, as are edges.
+   * @param file_name The name of the file.
+   * @param mesh The mesh. Faces may have at most 255 vertices.
+   * @param binary Whether to write binary rather than ascii data.
+   * @param little_endian The byte order of binary data.
+   * @throws std::runtime_error if the file can't be written.
+   */
+  static void write_mesh(const std::string &file_name, const PlyMesh &mesh,
+                         bool binary = true, bool little_endian = true);
+
 };
 
 animesh::PlyFileParser::PlyHeader parse_header(std::istream &stream);
@@ -1,76 +1,426 @@
 
 #include "ObjFileParser.h"
 
-#include "GeomFileUtils/io_utils.h"
-
-#include <FileUtils/FileUtils.h>
+#include <FileUtils/TextFileParser.h>
 #include <Eigen/Geometry>
 #include <Geom/Geom.h>
+#include <Geom/SpatialIndex.h>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 
 using animesh::ObjFileParser;
 using animesh::PointNormal;
 
-void
-handle_vertex_line(const std::string &line, std::vector<Eigen::Vector3f> &vertices) {
-    using namespace std;
-    using namespace Eigen;
+namespace {
+    /* Files with fewer bytes than this per thread are parsed on fewer threads */
+    const size_t MIN_BYTES_PER_THREAD = 1 << 20;
+
+    enum class ObjElement {
+        VERTEX, NORMAL, FACE, OTHER
+    };
+
+    /* The number of lines and of each element in part of a file */
+    struct ObjCounts {
+        size_t lines;
+        size_t vertices;
+        size_t normals;
+        size_t faces;
+        size_t corners;
+    };
+
+    /* A run of whole lines of a file, with the elements in it and in the lines before it */
+    struct ObjChunk {
+        const char *begin;
+        const char *end;
+        ObjCounts counts;
+        ObjCounts before;
+    };
+
+    inline bool
+    is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char *
+    skip_spaces(const char *pos, const char *line_end) {
+        while (pos != line_end && is_space(*pos)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    /* The end of the line starting at pos, excluding its newline */
+    inline const char *
+    line_end_of(const char *pos, const char *end) {
+        const auto newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        return newline ? newline : end;
+    }
+
+    /* Identify a line by its keyword and move pos past the keyword */
+    ObjElement
+    element_of(const char *&pos, const char *line_end) {
+        pos = skip_spaces(pos, line_end);
+        const auto length = line_end - pos;
+        if (length >= 2 && pos[0] == 'v' && is_space(pos[1])) {
+            pos += 1;
+            return ObjElement::VERTEX;
+        }
+        if (length >= 3 && pos[0] == 'v' && pos[1] == 'n' && is_space(pos[2])) {
+            pos += 2;
+            return ObjElement::NORMAL;
+        }
+        if (length >= 2 && pos[0] == 'f' && is_space(pos[1])) {
+            pos += 1;
+            return ObjElement::FACE;
+        }
+        return ObjElement::OTHER;
+    }
+
+    /* The number of space separated corners before the end of the line or a comment */
+    size_t
+    count_corners(const char *pos, const char *line_end) {
+        size_t corners = 0;
+        pos = skip_spaces(pos, line_end);
+        while (pos != line_end && *pos != '#') {
+            ++corners;
+            while (pos != line_end && !is_space(*pos)) {
+                ++pos;
+            }
+            pos = skip_spaces(pos, line_end);
+        }
+        return corners;
+    }
+
+    /*
+     * Split a file into about num_threads runs of whole lines, each at least MIN_BYTES_PER_THREAD long.
+     */
+    std::vector<ObjChunk>
+    split_into_chunks(const char *begin, const char *end, unsigned int num_threads) {
+        const auto size = (size_t) (end - begin);
+        const auto threads = (num_threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : num_threads;
+        const auto num_chunks = std::max<size_t>(1, std::min<size_t>(threads, size / MIN_BYTES_PER_THREAD));
+
+        std::vector<ObjChunk> chunks;
+        auto chunk_begin = begin;
+        for (size_t chunk = 1; chunk <= num_chunks && chunk_begin < end; ++chunk) {
+            auto chunk_end = std::max(chunk_begin, begin + size * chunk / num_chunks);
+            if (chunk_end != end) {
+                chunk_end = line_end_of(chunk_end, end);
+                chunk_end = (chunk_end == end) ? end : chunk_end + 1;
+            }
+            chunks.push_back(ObjChunk{chunk_begin, chunk_end, {}, {}});
+            chunk_begin = chunk_end;
+        }
+        return chunks;
+    }
+
+    /*
+     * Run chunk_function on every chunk, one thread per chunk, rethrowing the exception
+     * from the earliest chunk that failed.
+     */
+    void
+    for_each_chunk(std::vector<ObjChunk> &chunks, const std::function<void(ObjChunk &)> &chunk_function) {
+        if (chunks.size() == 1) {
+            chunk_function(chunks[0]);
+            return;
+        }
+        std::vector<std::exception_ptr> errors(chunks.size());
+        std::vector<std::thread> threads;
+        for (size_t chunk = 0; chunk < chunks.size(); ++chunk) {
+            threads.emplace_back([&, chunk]() {
+                try {
+                    chunk_function(chunks[chunk]);
+                } catch (...) {
+                    errors[chunk] = std::current_exception();
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (const auto &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    void
+    count_elements(ObjChunk &chunk) {
+        for (auto line_start = chunk.begin; line_start != chunk.end;) {
+            const auto line_end = line_end_of(line_start, chunk.end);
+            auto pos = line_start;
+            ++chunk.counts.lines;
+            switch (element_of(pos, line_end)) {
+                case ObjElement::VERTEX:
+                    ++chunk.counts.vertices;
+                    break;
+                case ObjElement::NORMAL:
+                    ++chunk.counts.normals;
+                    break;
+                case ObjElement::FACE:
+                    ++chunk.counts.faces;
+                    chunk.counts.corners += count_corners(pos, line_end);
+                    break;
+                case ObjElement::OTHER:
+                    break;
+            }
+            line_start = (line_end == chunk.end) ? line_end : line_end + 1;
+        }
+    }
+
+    /*
+     * Parses the lines of one chunk into their places in a mesh which has already been sized
+     * for the whole file.
+     */
+    class ObjChunkParser {
+    public:
+        ObjChunkParser(const std::string &file_name, const ObjCounts &totals, animesh::ObjMesh &mesh) //
+                : m_file_name{file_name} //
+                , m_totals{totals} //
+                , m_mesh{mesh} //
+                , m_line_start{nullptr} //
+                , m_line_end{nullptr} //
+                , m_line_number{0} //
+        {}
+
+        void parse(const ObjChunk &chunk) {
+            auto next = chunk.before;
+            m_line_number = next.lines;
+            for (m_line_start = chunk.begin; m_line_start != chunk.end;) {
+                m_line_end = line_end_of(m_line_start, chunk.end);
+                ++m_line_number;
+                auto pos = m_line_start;
+                switch (element_of(pos, m_line_end)) {
+                    case ObjElement::VERTEX:
+                        m_mesh.vertices[next.vertices++] = parse_vector(pos);
+                        break;
+                    case ObjElement::NORMAL:
+                        m_mesh.normals[next.normals++] = parse_vector(pos).normalized();
+                        break;
+                    case ObjElement::FACE:
+                        parse_face(pos, next);
+                        break;
+                    case ObjElement::OTHER:
+                        break;
+                }
+                m_line_start = (m_line_end == chunk.end) ? m_line_end : m_line_end + 1;
+            }
+        }
+
+    private:
+        Eigen::Vector3f parse_vector(const char *pos) const {
+            Eigen::Vector3f vector;
+            for (int i = 0; i < 3; ++i) {
+                pos = skip_spaces(pos, m_line_end);
+                if (!scan_float(pos, m_line_end, vector[i])) {
+                    fail("expected a number");
+                }
+            }
+            return vector;
+        }
+
+        void parse_face(const char *pos, ObjCounts &next) {
+            const auto first_corner = next.corners;
+            pos = skip_spaces(pos, m_line_end);
+            while (pos != m_line_end && *pos != '#') {
+                uint32_t vertex;
+                int32_t normal = -1;
+                if (!scan_index(pos, next.vertices, m_totals.vertices, vertex)) {
+                    fail("expected a vertex index");
+                }
+                if (pos != m_line_end && *pos == '/') {
+                    ++pos;
+                    // Texture coordinates aren't kept
+                    if (pos != m_line_end && *pos != '/') {
+                        if (*pos == '-') {
+                            ++pos;
+                        }
+                        uint32_t ignored;
+                        if (!scan_uint(pos, m_line_end, ignored)) {
+                            fail("expected a texture index");
+                        }
+                    }
+                    if (pos != m_line_end && *pos == '/') {
+                        ++pos;
+                        uint32_t index;
+                        if (!scan_index(pos, next.normals, m_totals.normals, index)) {
+                            fail("expected a normal index");
+                        }
+                        normal = (int32_t) index;
+                    }
+                }
+                if (pos != m_line_end && !is_space(*pos)) {
+                    fail("unexpected characters in face");
+                }
+                m_mesh.face_vertices[next.corners] = vertex;
+                m_mesh.face_normals[next.corners] = normal;
+                ++next.corners;
+                pos = skip_spaces(pos, m_line_end);
+            }
+            if (next.corners - first_corner < 3) {
+                fail("face has fewer than 3 vertices");
+            }
+            m_mesh.face_offsets[++next.faces] = (uint32_t) next.corners;
+        }
+
+        /*
+         * Scan a 1-based index or a negative index relative to the num_before elements read so far.
+         */
+        bool scan_index(const char *&pos, size_t num_before, size_t num_total, uint32_t &index) const {
+            const bool relative = (pos != m_line_end && *pos == '-');
+            auto p = relative ? pos + 1 : pos;
+            uint32_t value;
+            if (!scan_uint(p, m_line_end, value) || value == 0) {
+                return false;
+            }
+            if (relative ? (value > num_before) : (value > num_total)) {
+                fail("index " + std::string{pos, p} + " is out of range");
+            }
+            index = relative ? (uint32_t) (num_before - value) : value - 1;
+            pos = p;
+            return true;
+        }
+
+        [[noreturn]] void fail(const std::string &message) const {
+            throw std::runtime_error(m_file_name + ":" + std::to_string(m_line_number) + ": " + message
+                                             + " in '" + std::string{m_line_start, m_line_end} + "'");
+        }
 
-    istringstream iss(line);
-    string ss;
-    float x, y, z;
-    iss >> ss >> x >> y >> z;
-    Vector3f v{x, y, z};
-    vertices.push_back(v);
+        const std::string &m_file_name;
+        const ObjCounts &m_totals;
+        animesh::ObjMesh &m_mesh;
+        const char *m_line_start;
+        const char *m_line_end;
+        size_t m_line_number;
+    };
+
+    /*
+     * The edges of every face, each once with its lower vertex first, in ascending order.
+     * Edges are bucketed by their lower vertex and each bucket sorted and deduplicated on its own.
+     */
+    std::vector<std::pair<uint32_t, uint32_t>>
+    unique_edges(const animesh::ObjMesh &mesh, unsigned int num_threads) {
+        const auto num_vertices = mesh.vertices.size();
+        const auto for_each_face_edge = [&mesh](auto edge_function) {
+            for (size_t face = 0; face < mesh.num_faces(); ++face) {
+                const auto first = mesh.face_offsets[face];
+                const auto end = mesh.face_offsets[face + 1];
+                for (auto corner = first; corner < end; ++corner) {
+                    const auto from = mesh.face_vertices[corner];
+                    const auto to = mesh.face_vertices[(corner + 1 == end) ? first : corner + 1];
+                    if (from != to) {
+                        edge_function(std::min(from, to), std::max(from, to));
+                    }
+                }
+            }
+        };
+
+        std::vector<uint32_t> bucket_offsets(num_vertices + 1, 0);
+        for_each_face_edge([&bucket_offsets](uint32_t lower, uint32_t) { ++bucket_offsets[lower + 1]; });
+        std::partial_sum(bucket_offsets.begin(), bucket_offsets.end(), bucket_offsets.begin());
+        std::vector<uint32_t> upper_vertices(bucket_offsets.back());
+        std::vector<uint32_t> bucket_ends{bucket_offsets.begin(), bucket_offsets.end() - 1};
+        for_each_face_edge([&](uint32_t lower, uint32_t upper) { upper_vertices[bucket_ends[lower]++] = upper; });
+
+        animesh::spatial_index::for_each_band(num_vertices, num_threads, [&](size_t first, size_t end) {
+            for (auto vertex = first; vertex < end; ++vertex) {
+                const auto bucket_begin = upper_vertices.begin() + bucket_offsets[vertex];
+                std::sort(bucket_begin, upper_vertices.begin() + bucket_ends[vertex]);
+                bucket_ends[vertex] = (uint32_t) (std::unique(bucket_begin, upper_vertices.begin() + bucket_ends[vertex])
+                                                  - upper_vertices.begin());
+            }
+        });
+
+        size_t num_edges = 0;
+        for (size_t vertex = 0; vertex < num_vertices; ++vertex) {
+            num_edges += bucket_ends[vertex] - bucket_offsets[vertex];
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        edges.reserve(num_edges);
+        for (uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+            for (auto i = bucket_offsets[vertex]; i < bucket_ends[vertex]; ++i) {
+                edges.emplace_back(vertex, upper_vertices[i]);
+            }
+        }
+        return edges;
+    }
 }
 
-void
-handle_normal_line(const std::string &line, std::vector<Eigen::Vector3f> &normals) {
+animesh::ObjMesh
+ObjFileParser::read_mesh(const std::string &file_name, bool with_edges, unsigned int num_threads) {
     using namespace std;
-    using namespace Eigen;
 
-    istringstream iss(line);
-    string ss;
-    float x, y, z;
-    iss >> ss >> x >> y >> z;
-    Vector3f vn{x, y, z};
-    vn.normalize();
-    normals.push_back(vn);
+    size_t file_size;
+    const auto mapping = map_text_file(file_name, file_size);
+    auto chunks = split_into_chunks(mapping.get(), mapping.get() + file_size, num_threads);
+
+    // Count everything first so that each chunk can parse straight into its place
+    for_each_chunk(chunks, count_elements);
+    ObjCounts totals{};
+    for (auto &chunk : chunks) {
+        chunk.before = totals;
+        totals.lines += chunk.counts.lines;
+        totals.vertices += chunk.counts.vertices;
+        totals.normals += chunk.counts.normals;
+        totals.faces += chunk.counts.faces;
+        totals.corners += chunk.counts.corners;
+    }
+    if (totals.vertices > INT32_MAX || totals.normals > INT32_MAX || totals.corners > UINT32_MAX) {
+        throw runtime_error(file_name + " has too many elements");
+    }
+
+    ObjMesh mesh;
+    mesh.vertices.resize(totals.vertices);
+    mesh.normals.resize(totals.normals);
+    mesh.face_offsets.resize(totals.faces + 1);
+    mesh.face_vertices.resize(totals.corners);
+    mesh.face_normals.resize(totals.corners);
+    for_each_chunk(chunks, [&](ObjChunk &chunk) {
+        ObjChunkParser{file_name, totals, mesh}.parse(chunk);
+    });
+
+    if (with_edges) {
+        mesh.edges = unique_edges(mesh, num_threads);
+    }
+    return mesh;
 }
 
-/**
- * Handle lines of the form f v//vn v//vn v//vn
- * Where each is a face and v are the indices of vertices and vn of normals
- */
-void
-handle_face_line(
-        const std::string &line,
-        std::vector<size_t> &face_vertex_idx,
-        std::vector<size_t> &face_normal_idx,
-        std::vector<std::vector<std::pair<std::size_t, std::size_t>>> &faces) {
+std::vector<Eigen::Vector3f>
+ObjFileParser::vertex_normals(const ObjMesh &mesh) {
     using namespace std;
     using namespace Eigen;
 
-    vector<string> tokens = split(line, ' ');
-    vector<pair<size_t, size_t>> verts;
-    size_t idx = 1;
-    while (idx < tokens.size()) {
-        // Form is int/int/int
-        vector<string> terms = split(tokens[idx], '/');
-        int v_idx = stoi(terms[0]) - 1;
-        int vn_idx;
-        if (terms.size() > 1) {
-            vn_idx= stoi(terms[2]) - 1;
-        } else {
-            vn_idx = v_idx;
+    vector<Vector3f> normals(mesh.vertices.size(), Vector3f::Zero());
+    for (size_t face = 0; face < mesh.num_faces(); ++face) {
+        const auto first = mesh.face_offsets[face];
+        const auto end = mesh.face_offsets[face + 1];
+
+        // Newell's method gives twice the area vector of any planar polygon
+        Vector3f face_normal = Vector3f::Zero();
+        for (auto corner = first; corner < end; ++corner) {
+            const auto &from = mesh.vertices[mesh.face_vertices[corner]];
+            const auto &to = mesh.vertices[mesh.face_vertices[(corner + 1 == end) ? first : corner + 1]];
+            face_normal += from.cross(to);
+        }
+        face_normal *= 0.5f;
+
+        for (auto corner = first; corner < end; ++corner) {
+            const auto normal = mesh.face_normals[corner];
+            normals[mesh.face_vertices[corner]] += (normal < 0) ? face_normal : mesh.normals[normal];
         }
-        face_normal_idx.push_back(vn_idx);
-        face_vertex_idx.push_back(v_idx);
-        verts.emplace_back(v_idx, vn_idx);
-        idx++;
     }
-    faces.push_back(verts);
+    for (auto &normal : normals) {
+        normal.normalize();
+    }
+    return normals;
 }
 
 void
@@ -83,21 +433,25 @@ read_data(const std::string &file_name,
     using namespace std;
     using namespace Eigen;
 
-
-    process_file_by_lines(file_name, [&](const string &line) {
-        if (line[0] == 'v') {
-            // Normals
-            if (line[1] == 'n') {
-                handle_normal_line(line, given_normals);
-            }
-                // Vertices
-            else {
-                handle_vertex_line(line, given_vertices);
-            }
-        } else if (line[0] == 'f') {
-            handle_face_line(line, face_vertex_indices, face_normal_indices, faces);
+    auto mesh = ObjFileParser::read_mesh(file_name, false);
+    given_vertices = move(mesh.vertices);
+    given_normals = move(mesh.normals);
+
+    // Corners without a normal use the normal with the same index as their vertex
+    faces.reserve(mesh.num_faces());
+    face_vertex_indices.reserve(mesh.face_vertices.size());
+    face_normal_indices.reserve(mesh.face_vertices.size());
+    for (size_t f = 0; f < mesh.num_faces(); ++f) {
+        vector<pair<size_t, size_t>> face;
+        for (auto corner = mesh.face_offsets[f]; corner < mesh.face_offsets[f + 1]; ++corner) {
+            const size_t v_idx = mesh.face_vertices[corner];
+            const size_t vn_idx = (mesh.face_normals[corner] < 0) ? v_idx : (size_t) mesh.face_normals[corner];
+            face_vertex_indices.push_back(v_idx);
+            face_normal_indices.push_back(vn_idx);
+            face.emplace_back(v_idx, vn_idx);
         }
-    });
+        faces.push_back(face);
+    }
 
     // If no normals specified in the file, we must generate them
     // We can do this using a cross product on each face
@@ -4,16 +4,29 @@
 
 #include "GeomFileUtils/PlyFileParser.h"
 #include "GeomFileUtils/io_utils.h"
+#include <FileUtils/TextFileParser.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <fstream>
+#include <numeric>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 
 namespace animesh {
 const static std::vector<std::string> VALID_PROPERTY_TYPES{
     "char", "uchar", "short", "ushort",
     "int", "uint", "float", "double",
+    "int8", "uint8", "int16", "uint16",
+    "int32", "uint32", "float32", "float64",
 };
 const static std::vector<std::string> VALID_LIST_PROPERTY_TYPES{
     "char", "uchar", "short", "ushort",
     "int", "uint",
+    "int8", "uint8", "int16", "uint16",
+    "int32", "uint32",
 };
 
 bool starts_with(const std::string &line, const std::string &prefix) {
@@ -132,12 +145,21 @@ void parse_element(std::istream &file_stream, const std::string &line, animesh::
   if (tokens[1] == "vertex") {
     parse_vertex_element(file_stream, header);
     header.num_vertices = stoi(tokens[2]);
+    header.elements.push_back(tokens[1]);
     return;
   }
 
   if (tokens[1] == "face") {
     parse_face_element(file_stream, header);
     header.num_faces = stoi(tokens[2]);
+    header.elements.push_back(tokens[1]);
+    return;
+  }
+
+  if (tokens[1] == "edge") {
+    parse_properties(file_stream, header, header.edge_properties);
+    header.num_edges = stoi(tokens[2]);
+    header.elements.push_back(tokens[1]);
     return;
   }
 
@@ -174,133 +196,662 @@ animesh::PlyFileParser::PlyHeader parse_header(std::istream &stream) {
   return header;
 }
 
-void
-parse_ascii_vertex_list(std::istream &file_stream,
-                        const animesh::PlyFileParser::PlyHeader &header,
-                        std::vector<Eigen::Vector3f> vertices) {
+namespace {
+enum class PlyType {
+  INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64
+};
+
+PlyType
+type_of(const std::string &type) {
+  if (type == "char" || type == "int8") return PlyType::INT8;
+  if (type == "uchar" || type == "uint8") return PlyType::UINT8;
+  if (type == "short" || type == "int16") return PlyType::INT16;
+  if (type == "ushort" || type == "uint16") return PlyType::UINT16;
+  if (type == "int" || type == "int32") return PlyType::INT32;
+  if (type == "uint" || type == "uint32") return PlyType::UINT32;
+  if (type == "float" || type == "float32") return PlyType::FLOAT32;
+  if (type == "double" || type == "float64") return PlyType::FLOAT64;
+  throw std::runtime_error("Unknown property type " + type);
 }
 
-void parse_ascii_face_list(std::istream &file_stream,
-                           const animesh::PlyFileParser::PlyHeader &header,
-                           std::vector<std::vector<size_t>> face_indices) {
+size_t
+size_of(PlyType type) {
+  switch (type) {
+  case PlyType::INT8:
+  case PlyType::UINT8:return 1;
+  case PlyType::INT16:
+  case PlyType::UINT16:return 2;
+  case PlyType::INT32:
+  case PlyType::UINT32:
+  case PlyType::FLOAT32:return 4;
+  case PlyType::FLOAT64:return 8;
+  }
+  return 0;
 }
 
-float
-read_float(std::istream &stream, bool is_bigendian) {
-  float f;
-  stream.read((char *) &f, 4);
-  if (!is_bigendian) {
-    float g;
-    const char *src = (char *) &f;
-    char *dst = (char *) &g;
-    dst[0] = src[3];
-    dst[1] = src[2];
-    dst[2] = src[1];
-    dst[3] = src[0];
-    f = g;
-  }
-  return f;
+bool
+host_is_little_endian() {
+  const uint16_t one = 1;
+  uint8_t first_byte;
+  memcpy(&first_byte, &one, 1);
+  return first_byte == 1;
+}
+
+template<size_t Size>
+struct BitsOfSize;
+template<>
+struct BitsOfSize<1> { using type = uint8_t; };
+template<>
+struct BitsOfSize<2> { using type = uint16_t; };
+template<>
+struct BitsOfSize<4> { using type = uint32_t; };
+template<>
+struct BitsOfSize<8> { using type = uint64_t; };
+
+inline uint8_t byte_swap(uint8_t bits) { return bits; }
+inline uint16_t byte_swap(uint16_t bits) { return __builtin_bswap16(bits); }
+inline uint32_t byte_swap(uint32_t bits) { return __builtin_bswap32(bits); }
+inline uint64_t byte_swap(uint64_t bits) { return __builtin_bswap64(bits); }
+
+/*
+ * Swapping a whole contiguous column in one tight loop lets the compiler vectorise it.
+ */
+template<typename Bits>
+void
+byte_swap_column(Bits *column, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    column[i] = byte_swap(column[i]);
+  }
+}
+
+/* Columns are converted in batches small enough to stay in cache */
+const size_t COLUMN_BATCH_SIZE = 1024;
+
+/*
+ * Copy one property of count fixed size elements, stride bytes apart starting at first, into
+ * out, converting from the file's type T.
+ */
+template<typename T, typename Out>
+void
+read_column_as(const char *first, size_t count, size_t stride, bool swap, Out *out) {
+  using Bits = typename BitsOfSize<sizeof(T)>::type;
+  Bits batch[COLUMN_BATCH_SIZE];
+  for (size_t batch_start = 0; batch_start < count; batch_start += COLUMN_BATCH_SIZE) {
+    const auto batch_size = std::min(COLUMN_BATCH_SIZE, count - batch_start);
+    for (size_t i = 0; i < batch_size; ++i) {
+      memcpy(&batch[i], first + (batch_start + i) * stride, sizeof(Bits));
+    }
+    if (swap) {
+      byte_swap_column(batch, batch_size);
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+      T value;
+      memcpy(&value, &batch[i], sizeof(T));
+      out[batch_start + i] = (Out) value;
+    }
+  }
 }
 
-unsigned int
-read_int(std::istream &stream, int size, bool is_bigendian) {
-  unsigned int i;
-  char *pi = (char *) &i;
-  switch (size) {
-  case 1:stream.read(pi + 3, 1);
+template<typename Out>
+void
+read_column(PlyType type, const char *first, size_t count, size_t stride, bool swap, Out *out) {
+  switch (type) {
+  case PlyType::INT8:read_column_as<int8_t>(first, count, stride, swap, out);
+    break;
+  case PlyType::UINT8:read_column_as<uint8_t>(first, count, stride, swap, out);
+    break;
+  case PlyType::INT16:read_column_as<int16_t>(first, count, stride, swap, out);
+    break;
+  case PlyType::UINT16:read_column_as<uint16_t>(first, count, stride, swap, out);
+    break;
+  case PlyType::INT32:read_column_as<int32_t>(first, count, stride, swap, out);
     break;
-  case 2:stream.read(pi + 2, 2);
+  case PlyType::UINT32:read_column_as<uint32_t>(first, count, stride, swap, out);
     break;
-  case 4:stream.read(pi, 4);
+  case PlyType::FLOAT32:read_column_as<float>(first, count, stride, swap, out);
     break;
-  default:throw std::runtime_error("Invalid size for int " + std::to_string(size));
-  }
-  if (!is_bigendian) {
-    unsigned int j;
-    char *dst = (char *) &j;
-    dst[0] = pi[3];
-    dst[1] = pi[2];
-    dst[2] = pi[1];
-    dst[3] = pi[0];
-    i = j;
-  }
-  return i;
+  case PlyType::FLOAT64:read_column_as<double>(first, count, stride, swap, out);
+    break;
+  }
 }
 
+/*
+ * Copy count values of type T into a property stride bytes apart starting at first.
+ */
+template<typename T>
 void
-parse_binary_vertex_list(std::istream &stream,
-                         const animesh::PlyFileParser::PlyHeader &header,
-                         std::vector<Eigen::Vector3f> vertices) {
-  for (int i = 0; i < header.num_vertices; ++i) {
-    float x = read_float(stream, header.is_bigendian);
-    float y = read_float(stream, header.is_bigendian);
-    float z = 0.0f;
-    if (header.vertex_properties.size() == 3) {
-      z = read_float(stream, header.is_bigendian);
-    }
-    vertices.emplace_back(x, y, z);
+write_column(const T *values, size_t count, bool swap, char *first, size_t stride) {
+  using Bits = typename BitsOfSize<sizeof(T)>::type;
+  Bits batch[COLUMN_BATCH_SIZE];
+  for (size_t batch_start = 0; batch_start < count; batch_start += COLUMN_BATCH_SIZE) {
+    const auto batch_size = std::min(COLUMN_BATCH_SIZE, count - batch_start);
+    memcpy(batch, values + batch_start, batch_size * sizeof(T));
+    if (swap) {
+      byte_swap_column(batch, batch_size);
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+      memcpy(first + (batch_start + i) * stride, &batch[i], sizeof(Bits));
+    }
   }
 }
 
-int bytes_for_type(const std::string &type) {
-  if (type == "uchar" || type == "char") {
-    return 1;
+/*
+ * Where to put each element's value of one property, if anywhere. The items of a list are
+ * appended to list_items and its length to list_lengths.
+ */
+struct PlyColumn {
+  float *floats;
+  uint32_t *indices;
+  std::vector<uint32_t> *list_items;
+  std::vector<uint32_t> *list_lengths;
+};
+
+/* The length of a list, which is always an integer */
+uint32_t
+read_list_length(PlyType type, const char *pos, bool swap) {
+  switch (type) {
+  case PlyType::INT8:
+  case PlyType::UINT8:return (uint8_t) *pos;
+  case PlyType::INT16:
+  case PlyType::UINT16: {
+    uint16_t length;
+    memcpy(&length, pos, sizeof(length));
+    return swap ? byte_swap(length) : length;
+  }
+  default: {
+    uint32_t length;
+    memcpy(&length, pos, sizeof(length));
+    return swap ? byte_swap(length) : length;
+  }
+  }
+}
+
+/*
+ * Reads the data of each element of a PLY file in turn from memory.
+ */
+class PlyBodyReader {
+public:
+  PlyBodyReader(const std::string &name, const animesh::PlyFileParser::PlyHeader &header,
+                const char *begin, const char *end) //
+      : m_name{name} //
+      , m_header{header} //
+      , m_pos{begin} //
+      , m_end{end} //
+      , m_swap{!header.is_ascii && header.is_bigendian == host_is_little_endian()} //
+  {}
+
+  animesh::PlyMesh read() {
+    animesh::PlyMesh mesh;
+    for (const auto &element: m_header.elements) {
+      if (element == "vertex") {
+        read_vertices(mesh);
+      } else if (element == "face") {
+        read_faces(mesh);
+      } else {
+        read_edges(mesh);
+      }
+    }
+    if (!mesh.face_vertices.empty()) {
+      check_index(*std::max_element(mesh.face_vertices.begin(), mesh.face_vertices.end()), mesh, "face");
+    }
+    for (const auto &edge: mesh.edges) {
+      check_index(std::max(edge.first, edge.second), mesh, "edge");
+    }
+    return mesh;
+  }
+
+private:
+  void read_vertices(animesh::PlyMesh &mesh) {
+    const auto &properties = m_header.vertex_properties;
+    const auto count = checked_count(m_header.num_vertices, properties, "vertex");
+    mesh.vertices.setZero((Eigen::Index) count, 3);
+    const bool has_normals = has_property(properties, "nx") && has_property(properties, "ny")
+        && has_property(properties, "nz");
+    if (has_normals) {
+      mesh.normals.setZero((Eigen::Index) count, 3);
+    }
+
+    std::vector<PlyColumn> columns;
+    for (const auto &property: properties) {
+      PlyColumn column{nullptr, nullptr, nullptr, nullptr};
+      const auto axis = std::string{"xyz"}.find(property.name.back());
+      if (property.name.size() == 1 && axis != std::string::npos) {
+        column.floats = mesh.vertices.col((Eigen::Index) axis).data();
+      } else if (has_normals && property.name.size() == 2 && property.name[0] == 'n' && axis != std::string::npos) {
+        column.floats = mesh.normals.col((Eigen::Index) axis).data();
+      }
+      columns.push_back(column);
+    }
+    read_element(properties, count, columns);
+  }
+
+  void read_faces(animesh::PlyMesh &mesh) {
+    const auto &properties = m_header.face_properties;
+    const auto count = checked_count(m_header.num_faces, properties, "face");
+
+    // The vertex list is usually vertex_indices but some writers use vertex_index
+    int vertex_list = -1;
+    for (size_t p = 0; p < properties.size(); ++p) {
+      if (properties[p].is_list && (vertex_list < 0 || properties[p].name == "vertex_indices"
+          || properties[p].name == "vertex_index")) {
+        vertex_list = (int) p;
+      }
+    }
+    if (vertex_list < 0) {
+      throw std::runtime_error(m_name + ": faces have no list of vertices");
+    }
+    std::vector<PlyColumn> columns(properties.size(), PlyColumn{nullptr, nullptr, nullptr, nullptr});
+    std::vector<uint32_t> face_lengths;
+    face_lengths.reserve(count);
+    mesh.face_vertices.reserve(count * 3);
+    columns[vertex_list].list_items = &mesh.face_vertices;
+    columns[vertex_list].list_lengths = &face_lengths;
+    read_element(properties, count, columns);
+
+    mesh.face_offsets.resize(count + 1);
+    std::partial_sum(face_lengths.begin(), face_lengths.end(), mesh.face_offsets.begin() + 1);
+  }
+
+  void read_edges(animesh::PlyMesh &mesh) {
+    const auto &properties = m_header.edge_properties;
+    const auto count = checked_count(m_header.num_edges, properties, "edge");
+    const std::vector<std::string> names{"vertex1", "vertex2", "red", "green", "blue"};
+    std::vector<std::vector<uint32_t>> values(names.size());
+    std::vector<PlyColumn> columns;
+    for (const auto &property: properties) {
+      PlyColumn column{nullptr, nullptr, nullptr, nullptr};
+      const auto name = std::find(names.begin(), names.end(), property.name);
+      if (name != names.end() && !property.is_list) {
+        auto &value = values[name - names.begin()];
+        value.resize(count, 0);
+        column.indices = value.data();
+      }
+      columns.push_back(column);
+    }
+    read_element(properties, count, columns);
+
+    if (values[0].empty() || values[1].empty()) {
+      throw std::runtime_error(m_name + ": edges need vertex1 and vertex2");
+    }
+    mesh.edges.resize(count);
+    for (size_t e = 0; e < count; ++e) {
+      mesh.edges[e] = std::make_pair(values[0][e], values[1][e]);
+    }
+    if (!values[2].empty() && !values[3].empty() && !values[4].empty()) {
+      mesh.edge_colours.resize(count);
+      for (size_t e = 0; e < count; ++e) {
+        mesh.edge_colours[e] = {(uint8_t) values[2][e], (uint8_t) values[3][e], (uint8_t) values[4][e]};
+      }
+    }
   }
 
-  if (type == "ushort" || type == "short") {
-    return 2;
+  /*
+   * Check the header's count of an element against the bytes left before anything is sized
+   * to it. Each element takes at least one character per value in ASCII, and at least its
+   * fixed size properties and list lengths in binary.
+   */
+  size_t checked_count(int count, const std::vector<animesh::PlyFileParser::PlyProperty> &properties,
+                       const std::string &element) const {
+    if (count < 0) {
+      throw std::runtime_error(m_name + ": " + element + " count " + std::to_string(count) + " is negative");
+    }
+    size_t min_element_size = 0;
+    for (const auto &property: properties) {
+      min_element_size += m_header.is_ascii
+                          ? 1
+                          : size_of(type_of(property.is_list ? property.list_type : property.type));
+    }
+    if (min_element_size > 0 && (size_t) count > (size_t) (m_end - m_pos) / min_element_size) {
+      throw std::runtime_error(m_name + " is truncated");
+    }
+    return (size_t) count;
   }
 
-  if (type == "uint" || type == "int") {
-    return 4;
+  /*
+   * Read count elements, storing property p as columns[p] says. Elements with no lists are
+   * fixed size so each of their properties is read for every element at once.
+   */
+  void read_element(const std::vector<animesh::PlyFileParser::PlyProperty> &properties, size_t count,
+                    const std::vector<PlyColumn> &columns) {
+    std::vector<PlyType> types;
+    bool fixed_size = true;
+    size_t stride = 0;
+    for (const auto &property: properties) {
+      types.push_back(type_of(property.type));
+      fixed_size = fixed_size && !property.is_list;
+      stride += size_of(types.back());
+    }
+
+    if (m_header.is_ascii) {
+      read_ascii_element(properties, types, count, columns);
+    } else if (fixed_size) {
+      require(count * stride);
+      size_t offset = 0;
+      for (size_t p = 0; p < properties.size(); ++p) {
+        if (columns[p].floats) {
+          read_column(types[p], m_pos + offset, count, stride, m_swap, columns[p].floats);
+        } else if (columns[p].indices) {
+          read_column(types[p], m_pos + offset, count, stride, m_swap, columns[p].indices);
+        }
+        offset += size_of(types[p]);
+      }
+      m_pos += count * stride;
+    } else {
+      read_binary_element(properties, types, count, columns);
+    }
   }
 
-  throw std::runtime_error("Unknown list property type " + type);
+  /*
+   * Walk elements with lists. Lists of 32 bit indices, by far the most common, are copied
+   * straight into their items and byte swapped together at the end.
+   */
+  void read_binary_element(const std::vector<animesh::PlyFileParser::PlyProperty> &properties,
+                           const std::vector<PlyType> &types, size_t count,
+                           const std::vector<PlyColumn> &columns) {
+    std::vector<PlyType> length_types;
+    std::vector<size_t> first_items;
+    for (size_t p = 0; p < properties.size(); ++p) {
+      length_types.push_back(properties[p].is_list ? type_of(properties[p].list_type) : types[p]);
+      first_items.push_back(columns[p].list_items ? columns[p].list_items->size() : 0);
+    }
+
+    for (size_t e = 0; e < count; ++e) {
+      for (size_t p = 0; p < properties.size(); ++p) {
+        const auto size = size_of(types[p]);
+        if (!properties[p].is_list) {
+          require(size);
+          if (columns[p].floats) {
+            read_column(types[p], m_pos, 1, 0, m_swap, columns[p].floats + e);
+          } else if (columns[p].indices) {
+            read_column(types[p], m_pos, 1, 0, m_swap, columns[p].indices + e);
+          }
+          m_pos += size;
+          continue;
+        }
+
+        require(size_of(length_types[p]));
+        const auto length = read_list_length(length_types[p], m_pos, m_swap);
+        m_pos += size_of(length_types[p]);
+        require(length * size);
+        if (columns[p].list_items) {
+          auto &items = *columns[p].list_items;
+          const auto first = items.size();
+          items.resize(first + length);
+          if (types[p] == PlyType::INT32 || types[p] == PlyType::UINT32) {
+            memcpy(items.data() + first, m_pos, length * size);
+          } else {
+            read_column(types[p], m_pos, length, size, m_swap, items.data() + first);
+          }
+          columns[p].list_lengths->push_back(length);
+        }
+        m_pos += length * size;
+      }
+    }
+
+    for (size_t p = 0; p < properties.size(); ++p) {
+      if (m_swap && columns[p].list_items && (types[p] == PlyType::INT32 || types[p] == PlyType::UINT32)) {
+        auto &items = *columns[p].list_items;
+        byte_swap_column(items.data() + first_items[p], items.size() - first_items[p]);
+      }
+    }
+  }
+
+  void read_ascii_element(const std::vector<animesh::PlyFileParser::PlyProperty> &properties,
+                          const std::vector<PlyType> &types, size_t count,
+                          const std::vector<PlyColumn> &columns) {
+    for (size_t e = 0; e < count; ++e) {
+      for (size_t p = 0; p < properties.size(); ++p) {
+        if (!properties[p].is_list) {
+          const auto value = next_ascii_value(types[p]);
+          if (columns[p].floats) {
+            columns[p].floats[e] = (float) value;
+          } else if (columns[p].indices) {
+            columns[p].indices[e] = (uint32_t) (int64_t) value;
+          }
+          continue;
+        }
+
+        const auto length = (uint32_t) next_ascii_value(type_of(properties[p].list_type));
+        for (uint32_t i = 0; i < length; ++i) {
+          const auto value = next_ascii_value(types[p]);
+          if (columns[p].list_items) {
+            columns[p].list_items->push_back((uint32_t) (int64_t) value);
+          }
+        }
+        if (columns[p].list_lengths) {
+          columns[p].list_lengths->push_back(length);
+        }
+      }
+    }
+  }
+
+  /* Integers are scanned exactly, up to 32 bits, so large indices aren't rounded */
+  double next_ascii_value(PlyType type) {
+    while (m_pos != m_end && isspace((unsigned char) *m_pos)) {
+      ++m_pos;
+    }
+    if (type == PlyType::FLOAT32 || type == PlyType::FLOAT64) {
+      float value;
+      if (!scan_float(m_pos, m_end, value)) {
+        throw std::runtime_error(m_name + ": expected a number");
+      }
+      return value;
+    }
+    const bool negative = (m_pos != m_end && *m_pos == '-');
+    if (negative) {
+      ++m_pos;
+    }
+    uint32_t value;
+    if (!scan_uint(m_pos, m_end, value)) {
+      throw std::runtime_error(m_name + ": expected an integer");
+    }
+    return negative ? -(double) value : (double) value;
+  }
+
+  static bool has_property(const std::vector<animesh::PlyFileParser::PlyProperty> &properties,
+                           const std::string &name) {
+    return std::any_of(properties.begin(), properties.end(), [&name](const animesh::PlyFileParser::PlyProperty &p) {
+      return p.name == name && !p.is_list;
+    });
+  }
+
+  void check_index(uint32_t index, const animesh::PlyMesh &mesh, const std::string &element) const {
+    if (index >= mesh.num_vertices()) {
+      throw std::runtime_error(m_name + ": " + element + " refers to vertex " + std::to_string(index)
+                                   + " but there are only " + std::to_string(mesh.num_vertices()));
+    }
+  }
+
+  void require(size_t bytes) const {
+    if ((size_t) (m_end - m_pos) < bytes) {
+      throw std::runtime_error(m_name + " is truncated");
+    }
+  }
+
+  const std::string &m_name;
+  const animesh::PlyFileParser::PlyHeader &m_header;
+  const char *m_pos;
+  const char *const m_end;
+  const bool m_swap;
+};
+
+std::pair<std::vector<Eigen::Vector3f>, std::vector<std::vector<std::size_t>>>
+as_points_and_faces(const PlyMesh &mesh) {
+  std::vector<Eigen::Vector3f> vertices(mesh.num_vertices());
+  for (size_t v = 0; v < vertices.size(); ++v) {
+    vertices[v] = mesh.vertices.row((Eigen::Index) v).transpose();
+  }
+  std::vector<std::vector<size_t>> faces(mesh.num_faces());
+  for (size_t f = 0; f < faces.size(); ++f) {
+    faces[f].assign(mesh.face_vertices.begin() + mesh.face_offsets[f],
+                    mesh.face_vertices.begin() + mesh.face_offsets[f + 1]);
+  }
+  return {vertices, faces};
 }
 
-void parse_binary_face_list(std::istream &stream,
-                            const animesh::PlyFileParser::PlyHeader &header,
-                            std::vector<std::vector<size_t>> face_indices) {
-  for (int i = 0; i < header.num_faces; ++i) {
-    std::vector<size_t> face;
+void
+write_header(std::ostream &stream, const PlyMesh &mesh, bool binary, bool little_endian) {
+  stream << "ply\n"
+         << "format " << (!binary ? "ascii" : little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+         << "element vertex " << mesh.num_vertices() << "\n"
+         << "property float x\nproperty float y\nproperty float z\n";
+  if (mesh.normals.rows() > 0) {
+    stream << "property float nx\nproperty float ny\nproperty float nz\n";
+  }
+  if (mesh.num_faces() > 0) {
+    stream << "element face " << mesh.num_faces() << "\n"
+           << "property list uchar int vertex_indices\n";
+  }
+  if (!mesh.edges.empty()) {
+    stream << "element edge " << mesh.edges.size() << "\n"
+           << "property int vertex1\nproperty int vertex2\n";
+    if (!mesh.edge_colours.empty()) {
+      stream << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    }
+  }
+  stream << "end_header\n";
+}
 
-    // Read num items in list
-    int num_bytes_for_list_length = bytes_for_type(header.face_properties[0].list_type);
-    unsigned int num_indices_per_face = read_int(stream, num_bytes_for_list_length, header.is_bigendian);
-    for (unsigned int j = 0; j < num_indices_per_face; ++j) {
-      int num_bytes_for_list_item = bytes_for_type(header.face_properties[0].type);
-      size_t idx = read_int(stream, num_bytes_for_list_item, header.is_bigendian);
-      face.push_back(idx);
+void
+write_binary_body(std::ostream &stream, const PlyMesh &mesh, bool swap) {
+  // Vertices and normals interleaved
+  const auto num_vertices = mesh.num_vertices();
+  const bool has_normals = mesh.normals.rows() > 0;
+  const size_t vertex_stride = (has_normals ? 6 : 3) * sizeof(float);
+  std::vector<char> block(num_vertices * vertex_stride);
+  for (int axis = 0; axis < 3; ++axis) {
+    write_column(mesh.vertices.col(axis).data(), num_vertices, swap, block.data() + axis * sizeof(float), vertex_stride);
+    if (has_normals) {
+      write_column(mesh.normals.col(axis).data(), num_vertices, swap,
+                   block.data() + (axis + 3) * sizeof(float), vertex_stride);
     }
-    face_indices.push_back(face);
+  }
+  stream.write(block.data(), (std::streamsize) block.size());
+
+  // Each face is a one byte count followed by its indices
+  if (mesh.num_faces() > 0) {
+    block.resize(mesh.num_faces() + mesh.face_vertices.size() * sizeof(int32_t));
+    auto pos = block.data();
+    for (size_t f = 0; f < mesh.num_faces(); ++f) {
+      const auto length = mesh.face_offsets[f + 1] - mesh.face_offsets[f];
+      *pos++ = (char) (uint8_t) length;
+      for (auto corner = mesh.face_offsets[f]; corner < mesh.face_offsets[f + 1]; ++corner) {
+        const auto index = swap ? byte_swap(mesh.face_vertices[corner]) : mesh.face_vertices[corner];
+        memcpy(pos, &index, sizeof(index));
+        pos += sizeof(index);
+      }
+    }
+    stream.write(block.data(), (std::streamsize) block.size());
+  }
+
+  if (!mesh.edges.empty()) {
+    const auto num_edges = mesh.edges.size();
+    const bool has_colours = !mesh.edge_colours.empty();
+    const size_t edge_stride = 2 * sizeof(int32_t) + (has_colours ? 3 : 0);
+    block.resize(num_edges * edge_stride);
+    std::vector<uint32_t> starts(num_edges);
+    std::vector<uint32_t> ends(num_edges);
+    for (size_t e = 0; e < num_edges; ++e) {
+      starts[e] = mesh.edges[e].first;
+      ends[e] = mesh.edges[e].second;
+    }
+    write_column(starts.data(), num_edges, swap, block.data(), edge_stride);
+    write_column(ends.data(), num_edges, swap, block.data() + sizeof(int32_t), edge_stride);
+    if (has_colours) {
+      for (size_t e = 0; e < num_edges; ++e) {
+        memcpy(block.data() + e * edge_stride + 2 * sizeof(int32_t), mesh.edge_colours[e].data(), 3);
+      }
+    }
+    stream.write(block.data(), (std::streamsize) block.size());
   }
 }
 
+void
+write_ascii_body(std::ostream &stream, const PlyMesh &mesh) {
+  stream.precision(std::numeric_limits<float>::max_digits10);
+  const bool has_normals = mesh.normals.rows() > 0;
+  for (Eigen::Index v = 0; v < mesh.vertices.rows(); ++v) {
+    stream << mesh.vertices(v, 0) << " " << mesh.vertices(v, 1) << " " << mesh.vertices(v, 2);
+    if (has_normals) {
+      stream << " " << mesh.normals(v, 0) << " " << mesh.normals(v, 1) << " " << mesh.normals(v, 2);
+    }
+    stream << "\n";
+  }
+  for (size_t f = 0; f < mesh.num_faces(); ++f) {
+    stream << mesh.face_offsets[f + 1] - mesh.face_offsets[f];
+    for (auto corner = mesh.face_offsets[f]; corner < mesh.face_offsets[f + 1]; ++corner) {
+      stream << " " << mesh.face_vertices[corner];
+    }
+    stream << "\n";
+  }
+  for (size_t e = 0; e < mesh.edges.size(); ++e) {
+    stream << mesh.edges[e].first << " " << mesh.edges[e].second;
+    if (!mesh.edge_colours.empty()) {
+      for (const auto channel: mesh.edge_colours[e]) {
+        stream << " " << (unsigned int) channel;
+      }
+    }
+    stream << "\n";
+  }
+}
+}
+
 std::pair<std::vector<Eigen::Vector3f>, std::vector<std::vector<std::size_t>>>
 animesh::PlyFileParser::parse_stream(std::istream &stream) {
   auto header = parse_header(stream);
+  const std::string body{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+  return as_points_and_faces(PlyBodyReader{"PLY stream", header, body.data(), body.data() + body.size()}.read());
+}
 
+std::pair<std::vector<Eigen::Vector3f>, std::vector<std::vector<std::size_t>>>
+animesh::PlyFileParser::parse_file(const std::string &file_name) {
+  return as_points_and_faces(read_mesh(file_name));
+}
+
+PlyMesh
+animesh::PlyFileParser::read_mesh(const std::string &file_name) {
   using namespace std;
-  using namespace Eigen;
 
-  vector<Vector3f> vertices;
-  vector<vector<size_t>> faces;
+  size_t file_size;
+  const auto mapping = map_text_file(file_name, file_size);
+  const auto begin = mapping.get();
+  const auto end = begin + file_size;
 
-  if (header.is_ascii) {
-    parse_ascii_vertex_list(stream, header, vertices);
-    parse_ascii_face_list(stream, header, faces);
-  } else {
-    parse_binary_vertex_list(stream, header, vertices);
-    parse_binary_face_list(stream, header, faces);
+  // The header is text ending with an end_header line
+  const string end_header{"\nend_header"};
+  const auto header_end = search(begin, end, end_header.begin(), end_header.end());
+  if (header_end == end) {
+    throw runtime_error(file_name + " has no end_header");
   }
-  return {vertices, faces};
+  auto body = static_cast<const char *>(memchr(header_end + 1, '\n', end - header_end - 1));
+  body = body ? body + 1 : end;
+  istringstream header_stream{string{begin, body}};
+  const auto header = parse_header(header_stream);
+
+  return PlyBodyReader{file_name, header, body, end}.read();
 }
 
-std::pair<std::vector<Eigen::Vector3f>, std::vector<std::vector<std::size_t>>>
-animesh::PlyFileParser::parse_file(const std::string &file_name) {
-  using namespace std;
-  ifstream file_stream{file_name};
-  istream &stream = file_stream;
-  return parse_stream(stream);
+void
+animesh::PlyFileParser::write_mesh(const std::string &file_name, const PlyMesh &mesh,
+                                   bool binary, bool little_endian) {
+  if (mesh.vertices.rows() > INT32_MAX) {
+    throw std::runtime_error("Too many vertices to write " + file_name);
+  }
+  for (size_t f = 0; f < mesh.num_faces(); ++f) {
+    if (mesh.face_offsets[f + 1] - mesh.face_offsets[f] > UINT8_MAX) {
+      throw std::runtime_error("Face " + std::to_string(f) + " has too many vertices to write " + file_name);
+    }
+  }
+
+  std::ofstream file{file_name, std::ios::out | std::ios::binary | std::ios::trunc};
+  write_header(file, mesh, binary, little_endian);
+  if (binary) {
+    write_binary_body(file, mesh, little_endian != host_is_little_endian());
+  } else {
+    write_ascii_body(file, mesh);
+  }
+  if (!file) {
+    throw std::runtime_error("Couldn't write " + file_name);
+  }
+}
 }
-}
\ No newline at end of file
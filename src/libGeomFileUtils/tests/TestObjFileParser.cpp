@@ -1,4 +1,7 @@
 #include "TestObjFileParser.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
 #include <vector>
 
 void TestObjFileParser::TearDown( ) {}
@@ -69,3 +72,94 @@ TEST_F(TestObjFileParser, ParseCubeHasCorrectNormals) {
   EXPECT_EQ(-1, results.second[4].second.x());
   EXPECT_EQ(-1, results.second[5].second.z());
 }
+
+TEST_F(TestObjFileParser, ReadMeshShouldResolveEveryCornerForm) {
+  using namespace std;
+  using namespace animesh;
+
+  const string file_name = "read_mesh_test.obj";
+  {
+    ofstream file{file_name};
+    file << "# A square and a triangle sharing an edge\n"
+         << "o square\n"
+         << "v 0 0 0\nv 1 0 0\nv 1 1 0\r\nv 0 1 0\n"
+         << "vt 0 0\nvt 1 1\n"
+         << "vn 0 0 2\n"
+         << "\n"
+         << "usemtl none\n"
+         << "f 1//1 2//1 3//1 4//1\n"
+         << "v 2 1 0.5 1.0\n"
+         << "f 2/1 -1/2 3 # comment\n"
+         << "f\t-4/1/1   -3/2/-1 -1\n";
+  }
+  const auto mesh = ObjFileParser::read_mesh(file_name);
+  remove(file_name.c_str());
+
+  ASSERT_EQ(5, mesh.vertices.size());
+  EXPECT_EQ(Eigen::Vector3f(2, 1, 0.5f), mesh.vertices[4]);
+  ASSERT_EQ(1, mesh.normals.size());
+  EXPECT_EQ(Eigen::Vector3f(0, 0, 1), mesh.normals[0]);
+
+  ASSERT_EQ(3, mesh.num_faces());
+  EXPECT_EQ((vector<uint32_t>{0, 4, 7, 10}), mesh.face_offsets);
+  EXPECT_EQ((vector<uint32_t>{0, 1, 2, 3, 1, 4, 2, 1, 2, 4}), mesh.face_vertices);
+  EXPECT_EQ((vector<int32_t>{0, 0, 0, 0, -1, -1, -1, 0, 0, -1}), mesh.face_normals);
+
+  const vector<pair<uint32_t, uint32_t>> expected_edges{{0, 1}, {0, 3}, {1, 2}, {1, 4}, {2, 3}, {2, 4}};
+  EXPECT_EQ(expected_edges, mesh.edges);
+}
+
+TEST_F(TestObjFileParser, ReadMeshShouldGiveTheSameMeshOnAnyNumberOfThreads) {
+  using namespace std;
+  using namespace animesh;
+
+  // A triangulated grid large enough to be split between threads
+  const string file_name = "read_mesh_grid_test.obj";
+  const unsigned int n = 300;
+  {
+    ofstream file{file_name};
+    for (unsigned int y = 0; y < n; ++y) {
+      for (unsigned int x = 0; x < n; ++x) {
+        file << "v " << x * 0.01f << " " << y * 0.01f << " " << (x * y) % 7 << "\n";
+      }
+    }
+    for (unsigned int y = 0; y + 1 < n; ++y) {
+      for (unsigned int x = 0; x + 1 < n; ++x) {
+        const auto v = y * n + x + 1;
+        file << "f " << v << " " << v + 1 << " " << v + n + 1 << "\n"
+             << "f " << v << " " << v + n + 1 << " " << v + n << "\n";
+      }
+    }
+  }
+  const auto serial = ObjFileParser::read_mesh(file_name, true, 1);
+  const auto parallel = ObjFileParser::read_mesh(file_name, true, 4);
+  remove(file_name.c_str());
+
+  EXPECT_EQ(n * n, serial.vertices.size());
+  EXPECT_EQ(2 * (n - 1) * (n - 1), serial.num_faces());
+  // Euler's formula for a disc
+  EXPECT_EQ(serial.vertices.size() + serial.num_faces() - 1, serial.edges.size());
+
+  EXPECT_EQ(serial.vertices, parallel.vertices);
+  EXPECT_EQ(serial.face_offsets, parallel.face_offsets);
+  EXPECT_EQ(serial.face_vertices, parallel.face_vertices);
+  EXPECT_EQ(serial.edges, parallel.edges);
+}
+
+TEST_F(TestObjFileParser, ReadMeshErrorsShouldGiveLineNumber) {
+  using namespace std;
+  using namespace animesh;
+
+  const string file_name = "read_mesh_error_test.obj";
+  {
+    ofstream file{file_name};
+    file << "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\nf 1 2 4\n";
+  }
+  try {
+    ObjFileParser::read_mesh(file_name);
+    FAIL() << "Expected a parse error";
+  } catch (const runtime_error &e) {
+    EXPECT_NE(string::npos, string{e.what()}.find(file_name + ":5:"));
+  }
+  remove(file_name.c_str());
+}
@@ -4,6 +4,9 @@
 
 #include "TestPlyFileParser.h"
 #include <GeomFileUtils/PlyFileParser.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <vector>
 
 #define EXPECT_THROW_WITH_MESSAGE(stmt, etype, whatstring) EXPECT_THROW( \
@@ -270,4 +273,178 @@ end_header
   EXPECT_EQ( 1, header.num_faces);
   EXPECT_TRUE( header.is_bigendian);
   EXPECT_FALSE( header.is_ascii);
-}
\ No newline at end of file
+}
+
+namespace {
+animesh::PlyMesh
+make_test_mesh() {
+  animesh::PlyMesh mesh;
+  mesh.vertices.resize(5, 3);
+  mesh.vertices << 0, 0, 0,
+      1.5f, 0, -0.25f,
+      1, 1e-7f, 3.14159f,
+      0, 1, 1e6f,
+      -2, 0.5f, 0.1f;
+  mesh.normals.resize(5, 3);
+  mesh.normals << 0, 0, 1,
+      0, 1, 0,
+      1, 0, 0,
+      0.6f, 0.8f, 0,
+      0, -0.6f, 0.8f;
+  mesh.face_offsets = {0, 3, 7};
+  mesh.face_vertices = {0, 1, 2, 0, 2, 3, 4};
+  mesh.edges = {{0, 1}, {1, 2}, {2, 4}};
+  mesh.edge_colours = {{255, 0, 0}, {0, 0, 255}, {1, 2, 3}};
+  return mesh;
+}
+
+void
+expect_same_mesh(const animesh::PlyMesh &expected, const animesh::PlyMesh &actual) {
+  EXPECT_EQ(expected.vertices, actual.vertices);
+  EXPECT_EQ(expected.normals, actual.normals);
+  EXPECT_EQ(expected.face_offsets, actual.face_offsets);
+  EXPECT_EQ(expected.face_vertices, actual.face_vertices);
+  EXPECT_EQ(expected.edges, actual.edges);
+  EXPECT_EQ(expected.edge_colours, actual.edge_colours);
+}
+
+template<typename T>
+void
+append_big_endian(std::string &bytes, T value) {
+  char raw[sizeof(T)];
+  memcpy(raw, &value, sizeof(T));
+  const uint16_t one = 1;
+  if (*reinterpret_cast<const char *>(&one) == 1) {
+    std::reverse(raw, raw + sizeof(T));
+  }
+  bytes.append(raw, sizeof(T));
+}
+}
+
+TEST_F(TestPlyFileParser, mesh_survives_round_trip_in_every_format) {
+  using namespace std;
+  using namespace animesh;
+
+  const auto mesh = make_test_mesh();
+  const string file_name = "ply_round_trip_test.ply";
+  const vector<pair<bool, bool>> formats{{true, true}, {true, false}, {false, true}};
+  for (const auto &format: formats) {
+    PlyFileParser::write_mesh(file_name, mesh, format.first, format.second);
+    expect_same_mesh(mesh, PlyFileParser::read_mesh(file_name));
+  }
+
+  auto points_and_faces = PlyFileParser::parse_file(file_name);
+  remove(file_name.c_str());
+  ASSERT_EQ(5, points_and_faces.first.size());
+  EXPECT_EQ(Eigen::Vector3f(1, 1e-7f, 3.14159f), points_and_faces.first[2]);
+  ASSERT_EQ(2, points_and_faces.second.size());
+  EXPECT_EQ((vector<size_t>{0, 2, 3, 4}), points_and_faces.second[1]);
+}
+
+TEST_F(TestPlyFileParser, big_endian_elements_with_other_properties_are_read) {
+  using namespace std;
+  using namespace animesh;
+
+  string bytes = "ply\n"
+                 "format binary_big_endian 1.0\n"
+                 "comment Properties we don't keep are skipped\n"
+                 "element vertex 3\n"
+                 "property double x\n"
+                 "property float y\n"
+                 "property short z\n"
+                 "property uchar red\n"
+                 "element face 2\n"
+                 "property uchar flags\n"
+                 "property list ushort uint vertex_index\n"
+                 "end_header\n";
+  for (int v = 0; v < 3; ++v) {
+    append_big_endian<double>(bytes, v + 0.5);
+    append_big_endian<float>(bytes, -2.0f * (float) v);
+    append_big_endian<int16_t>(bytes, (int16_t) (v - 1));
+    append_big_endian<uint8_t>(bytes, 200);
+  }
+  append_big_endian<uint8_t>(bytes, 7);
+  append_big_endian<uint16_t>(bytes, 3);
+  for (uint32_t index: {0, 1, 2}) {
+    append_big_endian<uint32_t>(bytes, index);
+  }
+  append_big_endian<uint8_t>(bytes, 7);
+  append_big_endian<uint16_t>(bytes, 3);
+  for (uint32_t index: {2, 1, 0}) {
+    append_big_endian<uint32_t>(bytes, index);
+  }
+
+  const string file_name = "ply_big_endian_test.ply";
+  {
+    ofstream file{file_name, ios::binary};
+    file.write(bytes.data(), (streamsize) bytes.size());
+  }
+  const auto mesh = PlyFileParser::read_mesh(file_name);
+
+  ASSERT_EQ(3, mesh.num_vertices());
+  EXPECT_EQ(0, mesh.normals.rows());
+  for (int v = 0; v < 3; ++v) {
+    EXPECT_EQ(Eigen::RowVector3f(v + 0.5f, -2.0f * (float) v, (float) (v - 1)), mesh.vertices.row(v));
+  }
+  EXPECT_EQ((vector<uint32_t>{0, 3, 6}), mesh.face_offsets);
+  EXPECT_EQ((vector<uint32_t>{0, 1, 2, 2, 1, 0}), mesh.face_vertices);
+
+  // Cut off part way through the faces
+  {
+    ofstream file{file_name, ios::binary};
+    file.write(bytes.data(), (streamsize) bytes.size() - 5);
+  }
+  EXPECT_THROW_WITH_MESSAGE(PlyFileParser::read_mesh(file_name), runtime_error, file_name + " is truncated");
+  remove(file_name.c_str());
+}
+
+TEST_F(TestPlyFileParser, element_counts_are_checked_before_reading) {
+  using namespace std;
+  using namespace animesh;
+
+  const string file_name = "ply_count_test.ply";
+  const auto write_file = [&file_name](const string &header, size_t num_body_bytes) {
+    ofstream file{file_name, ios::binary};
+    file << header;
+    file << string(num_body_bytes, '\0');
+  };
+
+  // Far more vertices than the body could hold
+  write_file("ply\n"
+             "format binary_big_endian 1.0\n"
+             "element vertex 2000000000\n"
+             "property float x\n"
+             "property float y\n"
+             "property float z\n"
+             "end_header\n", 24);
+  EXPECT_THROW_WITH_MESSAGE(PlyFileParser::read_mesh(file_name), runtime_error, file_name + " is truncated");
+
+  // Every face needs at least its list length
+  write_file("ply\n"
+             "format binary_big_endian 1.0\n"
+             "element vertex 0\n"
+             "property float x\n"
+             "element face 2000000000\n"
+             "property list uchar uint vertex_indices\n"
+             "end_header\n", 16);
+  EXPECT_THROW_WITH_MESSAGE(PlyFileParser::read_mesh(file_name), runtime_error, file_name + " is truncated");
+
+  // And at least a character for each value in ASCII
+  write_file("ply\n"
+             "format ascii 1.0\n"
+             "element vertex 2000000000\n"
+             "property float x\n"
+             "property float y\n"
+             "property float z\n"
+             "end_header\n", 0);
+  EXPECT_THROW_WITH_MESSAGE(PlyFileParser::read_mesh(file_name), runtime_error, file_name + " is truncated");
+
+  write_file("ply\n"
+             "format binary_big_endian 1.0\n"
+             "element vertex -1\n"
+             "property float x\n"
+             "end_header\n", 0);
+  EXPECT_THROW_WITH_MESSAGE(PlyFileParser::read_mesh(file_name), runtime_error,
+                            file_name + ": vertex count -1 is negative");
+  remove(file_name.c_str());
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <vector>
 #include <set>
@@ -9,10 +10,12 @@
 #include <string>
 #include <sstream>
 #include <unordered_set>
+#include <functional>
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
 
 #include "Path.h"
+#include "MemoryReport.h"
 
 namespace animesh {
 
@@ -148,6 +151,16 @@ class Graph {
     m_nodes.emplace_back(node);
   }
 
+  /**
+   * Remove every node and edge.
+   */
+  void clear() {
+    m_nodes.clear();
+    m_nodes_accessible_from.clear();
+    m_nodes_linking_to.clear();
+    m_edges.clear();
+  }
+
   /**
    * Remove the given node (and any incident edges)
    */
@@ -211,6 +224,41 @@ class Graph {
     m_nodes_linking_to.emplace(from_node, to_node);
   }
 
+  /**
+   * Add new nodes and the edges between them in one pass. Edges name their end nodes by
+   * index into node_data and must be distinct, so the linear existence checks made by
+   * add_node and add_edge are skipped.
+   * @return The new nodes in the order of node_data.
+   */
+  std::vector<GraphNodePtr> add_indexed(const std::vector<NodeData> &node_data,
+                                        const std::vector<std::pair<uint32_t, uint32_t>> &edges,
+                                        const std::vector<EdgeData> &edge_data) {
+    using namespace std;
+
+    if (edges.size() != edge_data.size()) {
+      throw runtime_error("Expected data for each of " + to_string(edges.size()) + " edges");
+    }
+    vector<GraphNodePtr> new_nodes;
+    new_nodes.reserve(node_data.size());
+    m_nodes.reserve(m_nodes.size() + node_data.size());
+    for (const auto &data: node_data) {
+      new_nodes.emplace_back(make_node(data));
+      m_nodes.emplace_back(new_nodes.back());
+    }
+    for (size_t i = 0; i < edges.size(); ++i) {
+      const auto &from_node = new_nodes.at(edges[i].first);
+      const auto &to_node = new_nodes.at(edges[i].second);
+      m_nodes_accessible_from.emplace(from_node, to_node);
+      m_nodes_linking_to.emplace(to_node, from_node);
+      m_edges.emplace(make_pair(from_node, to_node), make_shared<EdgeData>(edge_data[i]));
+      if (!m_is_directed) {
+        m_nodes_accessible_from.emplace(to_node, from_node);
+        m_nodes_linking_to.emplace(from_node, to_node);
+      }
+    }
+    return new_nodes;
+  }
+
   /**
    * Remove an edge from the graph. If the graph is directed it will explicitly
    * remove only an edge from from_node to to_node.
@@ -602,10 +650,10 @@ class Graph {
 /**
  *
  */
-  std::vector<const GraphNodePtr> nodes() const {
+  std::vector<GraphNodePtr> nodes() const {
     using namespace std;
 
-    vector<const GraphNodePtr> nodes{begin(m_nodes), end(m_nodes)};
+    vector<GraphNodePtr> nodes{begin(m_nodes), end(m_nodes)};
     return nodes;
   }
 
@@ -683,6 +731,30 @@ class Graph {
     return m_edges.size();
   }
 
+/**
+ * Estimate the memory used by this graph. Node data is counted by value; pass
+ * node_data_report to add anything it owns on the heap.
+ */
+  MemoryReport
+  memory_report(const std::function<void(const NodeData &, MemoryReport &)> &node_data_report = nullptr) const {
+    using namespace std;
+
+    MemoryReport report;
+    report.add("graph nodes", m_nodes.capacity() * sizeof(GraphNodePtr) + m_nodes.size() * sizeof(GraphNode));
+    report.add("adjacency multimaps",
+               (m_nodes_accessible_from.size() + m_nodes_linking_to.size())
+                   * tree_node_bytes<typename decltype(m_nodes_accessible_from)::value_type>());
+    report.add("edge map", m_edges.size() * tree_node_bytes<typename decltype(m_edges)::value_type>());
+    report.add("edge data", m_edges.size() * sizeof(EdgeData));
+    report.add("shared_ptr control blocks", (m_nodes.size() + m_edges.size()) * SHARED_PTR_CONTROL_BLOCK_BYTES);
+    if (node_data_report) {
+      for (const auto &node: m_nodes) {
+        node_data_report(node->data(), report);
+      }
+    }
+    return report;
+  }
+
 /**
  * @return a vector of the neighbours of a given node.
  * A neighbour is a node for which there is an edge from this node to that node.
@@ -66,10 +66,10 @@ namespace animesh {
             /**
              * Return the childnodes of a node
              */
-            std::vector<const GraphNodePtr> child_nodes(const GraphNodePtr gn) const {
+            std::vector<GraphNodePtr> child_nodes(const GraphNodePtr gn) const {
                 using namespace std;
 
-                vector<const GraphNodePtr> children;
+                vector<GraphNodePtr> children;
 
                 auto ret = m_parents_to_children.equal_range(gn);
                 for (auto it = ret.first; it != ret.second; ++it) {
@@ -84,7 +84,7 @@ namespace animesh {
             std::vector<NodeData> children(const GraphNodePtr gn) const {
                 using namespace std;
 
-                vector<const GraphNodePtr> nodes = child_nodes(gn);
+                vector<GraphNodePtr> nodes = child_nodes(gn);
                 vector<NodeData> children;
                 for( auto node : nodes) {
                     children.push_back(node->data());
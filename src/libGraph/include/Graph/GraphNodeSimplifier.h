@@ -69,7 +69,7 @@ public:
     collapse_node(
             const GraphPtr &graph_ptr,
             const GraphNodePtr &node_ptr,
-            std::vector<const GraphNodePtr>& removed_nodes) {
+            std::vector<GraphNodePtr>& removed_nodes) {
         // Get neighbours
         auto neighbours = graph_ptr->neighbours(node_ptr);
         const auto neighbours2 = second_neighbours_of(graph_ptr, node_ptr);
@@ -116,7 +116,7 @@ public:
         }
         auto selected_node = select_random_node(eligible_nodes);
 
-        vector<const GraphNodePtr> removed;
+        vector<GraphNodePtr> removed;
         do {
             removed.clear();
             collapse_node(graph_ptr, selected_node, removed);
@@ -0,0 +1,62 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace animesh {
+
+/**
+ * Estimated heap usage of a data structure, in bytes, broken down by category.
+ * Estimates count payloads and the per-allocation bookkeeping of the standard
+ * containers but not allocator overhead, so they are a lower bound.
+ */
+struct MemoryReport {
+  std::map<std::string, size_t> bytes_by_category;
+
+  inline void add(const std::string &category, size_t bytes) {
+    bytes_by_category[category] += bytes;
+  }
+
+  inline void add(const MemoryReport &other) {
+    for (const auto &category: other.bytes_by_category) {
+      add(category.first, category.second);
+    }
+  }
+
+  inline size_t total() const {
+    size_t total = 0;
+    for (const auto &category: bytes_by_category) {
+      total += category.second;
+    }
+    return total;
+  }
+};
+
+/* Reference counts and deleter for a shared_ptr, allocated alongside the object by make_shared */
+const size_t SHARED_PTR_CONTROL_BLOCK_BYTES = 2 * sizeof(long) + sizeof(void *);
+
+/**
+ * Bytes allocated for one element of a std::map, std::multimap or std::set:
+ * the value plus colour, parent and child links.
+ */
+template<class T>
+inline size_t tree_node_bytes() {
+  return sizeof(T) + 4 * sizeof(void *);
+}
+
+/**
+ * Bytes a string holds on the heap; zero when the small string optimisation applies.
+ */
+inline size_t string_heap_bytes(const std::string &s) {
+  const auto data = s.data();
+  const auto self = reinterpret_cast<const char *>(&s);
+  if (data >= self && data < self + sizeof(std::string)) {
+    return 0;
+  }
+  return s.capacity() + 1;
+}
+}
@@ -20,7 +20,7 @@ void DirectedGraphEdgeTests::SetUp() {
 void DirectedGraphEdgeTests::TearDown() {}
 
 void DirectedGraphEdgeTests::assertContainsInAnyOrder(
-    const std::vector<const GraphNodePtr> &nodes,
+    const std::vector<GraphNodePtr> &nodes,
     const std::vector<std::string> &expected) {
   using namespace std;
   if (nodes.size() != expected.size()) {
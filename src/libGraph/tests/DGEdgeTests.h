@@ -29,7 +29,7 @@ protected:
   GraphNodePtr gn3;
   GraphNodePtr gn4;
   void assertContainsInAnyOrder(
-      const std::vector<const GraphNodePtr> & nodes,
+      const std::vector<GraphNodePtr> & nodes,
       const std::vector<std::string> &expected);
 
 };
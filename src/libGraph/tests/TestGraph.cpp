@@ -45,3 +45,25 @@ TEST_F(TestGraph, copy_constructor_should_copy_graph ) {
   EXPECT_EQ(graph2.num_nodes(), graph->num_nodes());
 }
 
+
+TEST_F(TestGraph, memory_report_grows_with_nodes_and_edges ) {
+  const auto empty_bytes = undirected_graph->memory_report().total();
+
+  undirected_graph->add_node(gn1);
+  undirected_graph->add_node(gn2);
+  const auto nodes_bytes = undirected_graph->memory_report().total();
+  EXPECT_GT(nodes_bytes, empty_bytes);
+
+  undirected_graph->add_edge(gn1, gn2, 1.1);
+  const auto report = undirected_graph->memory_report();
+  EXPECT_GT(report.total(), nodes_bytes);
+  EXPECT_EQ(report.bytes_by_category.at("edge data"), sizeof(float));
+}
+
+TEST_F(TestGraph, memory_report_includes_node_data ) {
+  undirected_graph->add_node(gn1);
+  const auto report = undirected_graph->memory_report([](const std::string &data, animesh::MemoryReport &r) {
+    r.add("strings", 100);
+  });
+  EXPECT_EQ(report.bytes_by_category.at("strings"), 100);
+}
@@ -178,7 +178,7 @@ TEST_F(TestGraphNodeSimplifier, SecondNeighboursOfAMiddleNodeIsCorrect) {
 
 void
 assertContainsInAnyOrder(
-        const std::vector<const std::shared_ptr<TestGraphNodeSimplifier::GraphNode>> & nodes,
+        const std::vector<std::shared_ptr<TestGraphNodeSimplifier::GraphNode>> & nodes,
         const std::vector<std::string> &expected) {
     bool *found = new bool[expected.size()];
     for (int i = 0; i < expected.size(); ++i) {
@@ -204,7 +204,7 @@ TEST_F(TestGraphNodeSimplifier, CollapseMiddleNode) {
     using namespace std;
     using namespace animesh;
 
-    vector<const GraphNodePtr> removed;
+    vector<GraphNodePtr> removed;
     m_simplifier->collapse_node(graph_ptr, m_node_c, removed);
 
     ASSERT_EQ(graph_ptr->num_nodes(), 4);
@@ -221,7 +221,7 @@ TEST_F(TestGraphNodeSimplifier, CollapseEndNode) {
     using namespace std;
     using namespace animesh;
 
-    vector<const GraphNodePtr> removed;
+    vector<GraphNodePtr> removed;
     m_simplifier->collapse_node(graph_ptr, m_node_a, removed);
 
     ASSERT_EQ(graph_ptr->num_nodes(), 5);
@@ -238,7 +238,7 @@ TEST_F(TestGraphNodeSimplifier, CollapseOrphanNode) {
     using namespace std;
     using namespace animesh;
 
-    vector<const GraphNodePtr> removed;
+    vector<GraphNodePtr> removed;
     m_simplifier->collapse_node(graph_ptr, m_node_x, removed);
 
     ASSERT_EQ(graph_ptr->num_nodes(), 6);
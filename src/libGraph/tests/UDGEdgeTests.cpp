@@ -33,7 +33,7 @@ UndirectedGraphEdgeTests::setup_edges_as_square() {
 
 void
 UndirectedGraphEdgeTests::assertContainsInAnyOrder(
-    const std::vector<const GraphNodePtr> & nodes,
+    const std::vector<GraphNodePtr> & nodes,
     const std::vector<std::string> &expected) {
   using namespace std;
   if( nodes.size() != expected.size()) {
@@ -318,3 +318,16 @@ TEST_F(UndirectedGraphEdgeTests, collapse_edge_adds_new_merged_edge) {
 }
 
 
+
+TEST_F(UndirectedGraphEdgeTests, add_indexed_adds_nodes_and_edges_in_both_directions) {
+  auto new_nodes = graph->add_indexed({"e", "f", "g"}, {{0, 1}, {2, 1}}, {0.5f, 0.7f});
+
+  EXPECT_EQ(7, graph->num_nodes());
+  EXPECT_EQ(2, graph->num_edges());
+  ASSERT_EQ(3, new_nodes.size());
+  EXPECT_EQ("f", new_nodes[1]->data());
+  EXPECT_TRUE(graph->has_edge(new_nodes[1], new_nodes[0]));
+  EXPECT_TRUE(graph->has_edge(new_nodes[1], new_nodes[2]));
+  EXPECT_FLOAT_EQ(0.7f, *(graph->edge(new_nodes[1], new_nodes[2])));
+  EXPECT_EQ(2, graph->edges_from(new_nodes[1]).size());
+}
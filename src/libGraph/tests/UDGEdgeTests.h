@@ -26,7 +26,7 @@ protected:
   GraphNodePtr gn4;
   void setup_edges_as_square();
   void assertContainsInAnyOrder(
-      const std::vector<const GraphNodePtr> & nodes,
+      const std::vector<GraphNodePtr> & nodes,
       const std::vector<std::string> &expected);
 
 
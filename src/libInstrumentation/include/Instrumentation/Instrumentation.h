@@ -0,0 +1,115 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * Lightweight timing and counting for capacity planning.
+ *
+ * Timers and counters accumulate in per-thread storage and are only merged
+ * when a snapshot is taken, so instrumented code never contends on a shared
+ * lock. Counters should be incremented in bulk (e.g. once per pass) rather
+ * than once per element.
+ */
+namespace instrumentation {
+
+using CounterId = size_t;
+
+/**
+ * Return the id of the named counter, registering it if necessary.
+ * Look the id up once and keep it; the lookup takes a global lock.
+ */
+CounterId
+counter(const std::string &name);
+
+/**
+ * Add to a counter in the calling thread's accumulator.
+ */
+void
+add(CounterId id, uint64_t amount = 1);
+
+/**
+ * Record one timed interval against the named timer.
+ */
+void
+record_time(const std::string &name, std::chrono::nanoseconds elapsed);
+
+/**
+ * Set a named gauge to the given value, replacing any earlier one.
+ * Gauges record levels, such as memory use, rather than totals.
+ */
+void
+set_gauge(const std::string &name, uint64_t value);
+
+/**
+ * Peak resident set size of this process so far in bytes, or 0 where not supported.
+ */
+uint64_t
+peak_rss_bytes();
+
+/**
+ * Times the scope in which it is declared.
+ */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(std::string name);
+  ~ScopedTimer();
+
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+ private:
+  std::string m_name;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+struct TimerStats {
+  uint64_t count = 0;
+  std::chrono::nanoseconds total{0};
+  std::chrono::nanoseconds max{0};
+};
+
+struct Report {
+  std::map<std::string, TimerStats> timers;
+  std::map<std::string, uint64_t> counters;
+  std::map<std::string, uint64_t> gauges;
+  double elapsed_seconds = 0.0;
+};
+
+/**
+ * Merge the accumulators of all threads, live and finished.
+ * Every snapshot samples the process peak RSS into the "peak rss bytes" gauge.
+ */
+Report
+snapshot();
+
+/**
+ * Render a report as a single line JSON object.
+ */
+std::string
+to_json(const Report &report);
+
+/**
+ * Write a snapshot to the given file, replacing its contents.
+ */
+void
+write_json_report(const std::string &file_name);
+
+/**
+ * Append a snapshot to the given file as one line of JSON.
+ */
+void
+append_json_snapshot(const std::string &file_name);
+
+/**
+ * Discard all accumulated timings, counters and gauges.
+ */
+void
+reset();
+}
@@ -0,0 +1,275 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/resource.h>
+
+namespace instrumentation {
+
+namespace {
+  struct ThreadAccumulator {
+    std::mutex mutex;
+    std::vector<uint64_t> counters;
+    std::map<std::string, TimerStats> timers;
+  };
+
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> counter_names;
+    std::map<std::string, CounterId> counter_ids;
+    std::set<ThreadAccumulator *> live_threads;
+    std::map<std::string, uint64_t> gauges;
+    // Totals from threads which have exited
+    Report retired;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  };
+
+  /*
+   * Never destroyed so that threads which outlive static destruction can still retire.
+   */
+  Registry &
+  registry() {
+    static auto *r = new Registry();
+    return *r;
+  }
+
+  void
+  merge_timer(TimerStats &into, const TimerStats &from) {
+    into.count += from.count;
+    into.total += from.total;
+    into.max = std::max(into.max, from.max);
+  }
+
+  /*
+   * Merge a thread's accumulator into a report. Caller holds the registry lock.
+   */
+  void
+  merge_into(Report &report, const ThreadAccumulator &accumulator, const std::vector<std::string> &counter_names) {
+    for (size_t id = 0; id < accumulator.counters.size(); ++id) {
+      if (accumulator.counters[id] != 0) {
+        report.counters[counter_names[id]] += accumulator.counters[id];
+      }
+    }
+    for (const auto &timer: accumulator.timers) {
+      merge_timer(report.timers[timer.first], timer.second);
+    }
+  }
+
+  struct ThreadAccumulatorHolder {
+    ThreadAccumulator accumulator;
+
+    ThreadAccumulatorHolder() {
+      auto &r = registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      r.live_threads.insert(&accumulator);
+    }
+
+    ~ThreadAccumulatorHolder() {
+      auto &r = registry();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      std::lock_guard<std::mutex> thread_lock{accumulator.mutex};
+      merge_into(r.retired, accumulator, r.counter_names);
+      r.live_threads.erase(&accumulator);
+    }
+  };
+
+  ThreadAccumulator &
+  local_accumulator() {
+    thread_local ThreadAccumulatorHolder holder;
+    return holder.accumulator;
+  }
+
+  void
+  write_json_string(std::ostringstream &out, const std::string &value) {
+    out << '"';
+    for (const auto c: value) {
+      switch (c) {
+        case '"': out << "\\\"";
+          break;
+        case '\\': out << "\\\\";
+          break;
+        case '\n': out << "\\n";
+          break;
+        case '\t': out << "\\t";
+          break;
+        default: out << c;
+      }
+    }
+    out << '"';
+  }
+
+  double
+  seconds(std::chrono::nanoseconds ns) {
+    return std::chrono::duration<double>(ns).count();
+  }
+}
+
+CounterId
+counter(const std::string &name) {
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex};
+  const auto it = r.counter_ids.find(name);
+  if (it != r.counter_ids.end()) {
+    return it->second;
+  }
+  const auto id = r.counter_names.size();
+  r.counter_names.push_back(name);
+  r.counter_ids.emplace(name, id);
+  return id;
+}
+
+void
+add(CounterId id, uint64_t amount) {
+  auto &accumulator = local_accumulator();
+  std::lock_guard<std::mutex> lock{accumulator.mutex};
+  if (id >= accumulator.counters.size()) {
+    accumulator.counters.resize(id + 1, 0);
+  }
+  accumulator.counters[id] += amount;
+}
+
+void
+record_time(const std::string &name, std::chrono::nanoseconds elapsed) {
+  auto &accumulator = local_accumulator();
+  std::lock_guard<std::mutex> lock{accumulator.mutex};
+  auto &stats = accumulator.timers[name];
+  ++stats.count;
+  stats.total += elapsed;
+  stats.max = std::max(stats.max, elapsed);
+}
+
+void
+set_gauge(const std::string &name, uint64_t value) {
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex};
+  r.gauges[name] = value;
+}
+
+uint64_t
+peak_rss_bytes() {
+  struct rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  // Bytes on macOS
+  return (uint64_t) usage.ru_maxrss;
+#else
+  // Kilobytes on Linux
+  return (uint64_t) usage.ru_maxrss * 1024;
+#endif
+}
+
+ScopedTimer::ScopedTimer(std::string name) //
+    : m_name{std::move(name)} //
+    , m_start{std::chrono::steady_clock::now()} //
+{}
+
+ScopedTimer::~ScopedTimer() {
+  record_time(m_name, std::chrono::steady_clock::now() - m_start);
+}
+
+Report
+snapshot() {
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex};
+  Report report = r.retired;
+  for (const auto accumulator: r.live_threads) {
+    std::lock_guard<std::mutex> thread_lock{accumulator->mutex};
+    merge_into(report, *accumulator, r.counter_names);
+  }
+  // Registered counters are always reported, even when zero.
+  for (const auto &name: r.counter_names) {
+    report.counters[name];
+  }
+  report.gauges = r.gauges;
+  report.gauges["peak rss bytes"] = peak_rss_bytes();
+  report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start).count();
+  return report;
+}
+
+std::string
+to_json(const Report &report) {
+  std::ostringstream out;
+  out << std::setprecision(9);
+  out << "{\"elapsed_s\":" << report.elapsed_seconds;
+
+  out << ",\"timers\":{";
+  bool first = true;
+  for (const auto &timer: report.timers) {
+    if (!first) out << ',';
+    first = false;
+    write_json_string(out, timer.first);
+    const auto &stats = timer.second;
+    out << ":{\"count\":" << stats.count
+        << ",\"total_s\":" << seconds(stats.total)
+        << ",\"mean_s\":" << (stats.count == 0 ? 0.0 : seconds(stats.total) / (double) stats.count)
+        << ",\"max_s\":" << seconds(stats.max)
+        << '}';
+  }
+  out << '}';
+
+  out << ",\"counters\":{";
+  first = true;
+  for (const auto &c: report.counters) {
+    if (!first) out << ',';
+    first = false;
+    write_json_string(out, c.first);
+    out << ':' << c.second;
+  }
+  out << '}';
+
+  out << ",\"gauges\":{";
+  first = true;
+  for (const auto &g: report.gauges) {
+    if (!first) out << ',';
+    first = false;
+    write_json_string(out, g.first);
+    out << ':' << g.second;
+  }
+  out << "}}";
+  return out.str();
+}
+
+void
+write_json_report(const std::string &file_name) {
+  std::ofstream file{file_name, std::ios::out | std::ios::trunc};
+  if (file.fail()) {
+    throw std::runtime_error("Error writing instrumentation report " + file_name);
+  }
+  file << to_json(snapshot()) << std::endl;
+}
+
+void
+append_json_snapshot(const std::string &file_name) {
+  std::ofstream file{file_name, std::ios::out | std::ios::app};
+  if (file.fail()) {
+    throw std::runtime_error("Error writing instrumentation snapshot " + file_name);
+  }
+  file << to_json(snapshot()) << std::endl;
+}
+
+void
+reset() {
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock{r.mutex};
+  r.retired = Report{};
+  r.gauges.clear();
+  for (const auto accumulator: r.live_threads) {
+    std::lock_guard<std::mutex> thread_lock{accumulator->mutex};
+    accumulator->counters.clear();
+    accumulator->timers.clear();
+  }
+  r.start = std::chrono::steady_clock::now();
+}
+}
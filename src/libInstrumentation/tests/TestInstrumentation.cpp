@@ -0,0 +1,81 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "TestInstrumentation.h"
+#include <Instrumentation/Instrumentation.h>
+#include <thread>
+#include <vector>
+
+void TestInstrumentation::SetUp() {
+  instrumentation::reset();
+}
+
+void TestInstrumentation::TearDown() {}
+
+TEST_F(TestInstrumentation, CountersAccumulate) {
+  const auto nodes = instrumentation::counter("nodes");
+  EXPECT_EQ(nodes, instrumentation::counter("nodes"));
+
+  instrumentation::add(nodes);
+  instrumentation::add(nodes, 41);
+  EXPECT_EQ(instrumentation::snapshot().counters.at("nodes"), 42);
+}
+
+TEST_F(TestInstrumentation, CountersMergeAcrossThreads) {
+  const auto edges = instrumentation::counter("edges");
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([edges]() {
+      for (int i = 0; i < 1000; ++i) {
+        instrumentation::add(edges, 2);
+      }
+    });
+  }
+  for (auto &thread: threads) {
+    thread.join();
+  }
+  instrumentation::add(edges, 1);
+  EXPECT_EQ(instrumentation::snapshot().counters.at("edges"), 8001);
+}
+
+TEST_F(TestInstrumentation, ScopedTimerRecordsEachScope) {
+  for (int i = 0; i < 3; ++i) {
+    instrumentation::ScopedTimer timer{"phase"};
+  }
+  const auto report = instrumentation::snapshot();
+  EXPECT_EQ(report.timers.at("phase").count, 3);
+  EXPECT_GE(report.timers.at("phase").total, report.timers.at("phase").max);
+}
+
+TEST_F(TestInstrumentation, ResetClearsEverything) {
+  const auto frames = instrumentation::counter("frames");
+  instrumentation::add(frames, 7);
+  { instrumentation::ScopedTimer timer{"phase"}; }
+
+  instrumentation::reset();
+  const auto report = instrumentation::snapshot();
+  EXPECT_EQ(report.counters.at("frames"), 0);
+  EXPECT_EQ(report.timers.count("phase"), 0);
+}
+
+TEST_F(TestInstrumentation, JsonContainsTimersAndCounters) {
+  instrumentation::add(instrumentation::counter("nodes \"visited\""), 5);
+  { instrumentation::ScopedTimer timer{"load"}; }
+
+  const auto json = instrumentation::to_json(instrumentation::snapshot());
+  EXPECT_NE(json.find("\"load\":{\"count\":1,"), std::string::npos);
+  EXPECT_NE(json.find("\"nodes \\\"visited\\\"\":5"), std::string::npos);
+  EXPECT_EQ(json.front(), '{');
+  EXPECT_EQ(json.back(), '}');
+}
+
+TEST_F(TestInstrumentation, GaugesKeepLatestValue) {
+  instrumentation::set_gauge("level bytes", 10);
+  instrumentation::set_gauge("level bytes", 4);
+
+  const auto report = instrumentation::snapshot();
+  EXPECT_EQ(report.gauges.at("level bytes"), 4);
+  EXPECT_GT(report.gauges.at("peak rss bytes"), 0);
+}
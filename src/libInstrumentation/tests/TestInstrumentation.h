@@ -0,0 +1,13 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include <gtest/gtest.h>
+
+class TestInstrumentation : public ::testing::Test {
+public:
+  void SetUp( );
+  void TearDown();
+};
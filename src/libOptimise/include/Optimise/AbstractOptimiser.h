@@ -55,13 +55,15 @@ protected:
   static std::vector<unsigned int>
   get_common_frames(const std::shared_ptr<Surfel> &s1, const std::shared_ptr<Surfel> &s2) ;
 
+  // Protected rather than private only so the benchmarks can time it through a subclass
+  void compute_smoothness(float & mean_node_smoothness, std::vector<float> frame_smoothness);
+
 private:
   // Optimisation
   void optimise_begin();
 
   void optimise_end();
 
-  void compute_smoothness(float & mean_node_smoothness, std::vector<float> frame_smoothness);
   virtual float compute_smoothness_in_frame( const SurfelGraph::Edge & edge, unsigned int frame_idx) const = 0;
   virtual void store_mean_smoothness(SurfelGraphNodePtr node, float smoothness) const = 0;
 
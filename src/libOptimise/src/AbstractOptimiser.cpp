@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <spdlog/spdlog.h>
 #include <Properties/Properties.h>       // termination criteria set up
+#include <Instrumentation/Instrumentation.h>
 
 AbstractOptimiser::AbstractOptimiser(Properties properties, std::default_random_engine &rng)
     : Optimiser{std::move(properties), rng}//
@@ -80,7 +81,10 @@ AbstractOptimiser::optimise_begin() {
 
   using namespace spdlog;
   info("Computing initial smoothness");
-  compute_smoothness(m_last_smoothness, std::vector<float>(m_num_frames,0));
+  {
+    instrumentation::ScopedTimer timer{"smoothness"};
+    compute_smoothness(m_last_smoothness, std::vector<float>(m_num_frames, 0));
+  }
   info("Initial smoothness : {:4.3f}", m_last_smoothness);
   m_num_iterations = 0;
   m_state = OPTIMISING;
@@ -172,7 +176,10 @@ using namespace std;
 
   smoothness = numeric_limits<float>::infinity();
   vector<float> frame_smoothness(m_num_frames,0);
-  compute_smoothness(smoothness, frame_smoothness);
+  {
+    instrumentation::ScopedTimer timer{"smoothness"};
+    compute_smoothness(smoothness, frame_smoothness);
+  }
 
   if (check_cancellation(result)) {
     return true;
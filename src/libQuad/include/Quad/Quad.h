@@ -6,7 +6,10 @@
 
 #include <Surfel/SurfelGraph.h>
 #include <Eigen/Core>
+#include <cstdint>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 typedef enum {
   EDGE_TYPE_NON = 0,
@@ -41,12 +44,71 @@ using ConsensusGraph = animesh::Graph<ConsensusGraphVertex, EdgeType>;
 using ConsensusGraphPtr = std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>>;
 using ConsensusGraphNodePtr = std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>::GraphNode>;
 
+/**
+ * A consensus graph over dense vertex indices. Each red or blue edge is held once as
+ * (lower, higher) vertex index, in sorted order, with its type at the same position
+ * in edge_types.
+ */
+struct IndexedConsensusGraph {
+  std::vector<ConsensusGraphVertex> vertices;
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  std::vector<EdgeType> edge_types;
+};
+
+/**
+ * Build the consensus graph of a frame. There is a vertex for each surfel at either end of
+ * an edge of the surfel graph lying in the frame, numbered in surfel graph order, placed on
+ * the surfel's reference lattice vertex.
+ * @param num_threads Threads used to classify edges and place vertices, 0 for one per hardware thread.
+ */
+IndexedConsensusGraph
+build_indexed_consensus_graph(const SurfelGraphPtr &graph, int frame_index, float rho, unsigned int num_threads = 0);
+
+/**
+ * Copy an indexed consensus graph into a ConsensusGraph.
+ */
+ConsensusGraphPtr
+to_consensus_graph(const IndexedConsensusGraph &indexed_graph);
+
+/**
+ * Copy a ConsensusGraph into an indexed consensus graph, numbering vertices in node order.
+ */
+IndexedConsensusGraph
+to_indexed_consensus_graph(const ConsensusGraphPtr &graph);
+
 ConsensusGraphPtr
 build_consensus_graph(const SurfelGraphPtr &graph, int frame_index, float rho);
 
+/**
+ * Contract the blue edges of a consensus graph, shortest first, merging the clusters of
+ * vertices at their ends. Two clusters merge at the midpoint of their locations with the
+ * normalised sum of their normals, and the lengths of the merged cluster's edges are
+ * re-measured. Clusters joined by any red edge are never merged.
+ * @return One vertex per cluster, numbered in order of their first vertex, and the edges
+ * between clusters, red wherever any edge between them was red.
+ */
+IndexedConsensusGraph
+collapse(const IndexedConsensusGraph &graph);
+
 void
 collapse(const ConsensusGraphPtr &graph);
 
+/**
+ * Find the faces of a consensus graph by walking it as a half edge structure. The edges
+ * around each vertex are ordered by angle about its normal, then every face is traced by
+ * turning as little as possible to the left at each vertex. Faces of three to five
+ * vertices that run anticlockwise about their vertex normals are kept, so the region
+ * outside a boundary is not.
+ * @param face_offsets Filled with the start of each face in face_vertices and one past the last face.
+ * @param face_vertices Filled with the vertex indices of each face, anticlockwise.
+ * @param num_threads Threads used to order the edges about each vertex, 0 for one per hardware thread.
+ */
+void
+extract_faces(const IndexedConsensusGraph &graph,
+              std::vector<uint32_t> &face_offsets,
+              std::vector<uint32_t> &face_vertices,
+              unsigned int num_threads = 0);
+
 void
 extract_faces(const ConsensusGraphPtr &graph,
               std::vector<Eigen::Vector3f> &vertices,
@@ -7,38 +7,14 @@
 #include <PoSy/PoSy.h>
 #include <Surfel/SurfelGraph.h>
 #include <Geom/Geom.h>
+#include <Geom/SpatialIndex.h>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <algorithm>
 #include <map>
+#include <numeric>
 #include <queue>
-
-std::vector<SurfelGraph::Edge>
-get_edges_in_frame(const SurfelGraphPtr &graph, int frame_index) {
-  using namespace std;
-
-  set<pair<string, string>> checked_edges;
-  vector<SurfelGraph::Edge> edges_in_frame;
-
-  for (const auto &edge: graph->edges()) {
-    const auto from_surfel = edge.from()->data();
-    const auto to_surfel = edge.to()->data();
-    // Skip edges where one end is not in this frame
-    if (!((from_surfel->is_in_frame(frame_index)) && to_surfel->is_in_frame(frame_index))) {
-      continue;
-    }
-    // If we already considered this edge (usually its inverse), skip it
-    const string from_id = from_surfel->id();
-    const string to_id = to_surfel->id();
-    if ((checked_edges.count({from_id, to_id}) == 1) || (checked_edges.count({to_id, from_id}) == 1)) {
-      continue;
-    }
-
-    // Otherwise add this to the list of edges we'll include in the graph
-    checked_edges.emplace(make_pair(from_id, to_id));
-    edges_in_frame.emplace_back(edge);
-  }
-  return edges_in_frame;
-}
+#include <unordered_map>
 
 EdgeType compute_edge_type(const Eigen::Vector2i &t_ij,
                            const Eigen::Vector2i &t_ji) {
@@ -55,218 +31,414 @@ EdgeType compute_edge_type(const Eigen::Vector2i &t_ij,
   }
 }
 
-ConsensusGraphNodePtr
-add_or_retrieve_node(const ConsensusGraphPtr &out_graph,
-                     std::map<std::string,
-                              ConsensusGraphNodePtr> &output_graph_nodes_by_surfel_id,
-                     unsigned int frame_idx,
-                     const std::shared_ptr<Surfel> &surfel,
-                     float rho) {
-  ConsensusGraphNodePtr node;
-  std::string surfel_id = surfel->id();
-  if (output_graph_nodes_by_surfel_id.count(surfel_id) == 0) {
-    ConsensusGraphVertex cgv;
-    cgv.surfel_id = surfel_id;
-    cgv.location = surfel->reference_lattice_vertex_in_frame(frame_idx, rho);
-    Eigen::Vector3f ignored1, ignored2, normal;
-    surfel->get_vertex_tangent_normal_for_frame(frame_idx, ignored1, ignored2, normal);
-    cgv.normal = normal;
-    node = out_graph->add_node(cgv);
-    output_graph_nodes_by_surfel_id.emplace(surfel_id, node);
-  } else {
-    node = output_graph_nodes_by_surfel_id[surfel_id];
-  }
-  return node;
-}
-
-ConsensusGraphPtr
-build_consensus_graph(const SurfelGraphPtr &graph, int frame_index, float rho) {
-  using namespace Eigen;
+IndexedConsensusGraph
+build_indexed_consensus_graph(const SurfelGraphPtr &graph, int frame_index, float rho, unsigned int num_threads) {
   using namespace std;
+  using animesh::spatial_index::for_each_band;
 
   spdlog::info("Building consensus graph from graph with {} nodes and {} edges",
                graph->num_nodes(),
                graph->num_edges());
 
-  // Make the output graph
-  ConsensusGraphPtr out_graph = make_shared<animesh::Graph<ConsensusGraphVertex, EdgeType>>(false);
-
-  // For each edge with end nodes in this frame
-  auto edges = get_edges_in_frame(graph, frame_index);
-  spdlog::info("  Found {} unique edges", edges.size());
-
-  // For each edge in this list, insert the end vertices if not present, then add the edge.
-  map<string, ConsensusGraphNodePtr> output_graph_nodes_by_surfel_id;
-  for (const auto &edge: edges) {
-    // Create a node for the from_node if there's not one already.
-    const auto &from_surfel = edge.from()->data();
-    const auto &to_surfel = edge.to()->data();
-    const auto from_node = add_or_retrieve_node(out_graph,
-                                                output_graph_nodes_by_surfel_id,
-                                                frame_index,
-                                                from_surfel,
-                                                rho);
-    const auto to_node = add_or_retrieve_node(out_graph,
-                                              output_graph_nodes_by_surfel_id,
-                                              frame_index,
-                                              to_surfel,
-                                              rho);
-    auto ts = get_t(graph, edge.from(), edge.to());
-    auto t_ij = ts.first;
-    auto t_ji = ts.second;
-    auto edgeType = compute_edge_type(t_ij, t_ji);
-    if (edgeType == EDGE_TYPE_NON) {
-      spdlog::info("  skipped edge from {} {}", from_surfel->id(), to_surfel->id());
+  // Number the surfels densely and note which are in this frame
+  const auto nodes = graph->nodes();
+  const auto num_surfels = (uint32_t) nodes.size();
+  unordered_map<const SurfelGraph::GraphNode *, uint32_t> surfel_index;
+  surfel_index.reserve(num_surfels);
+  vector<bool> in_frame(num_surfels, false);
+  for (uint32_t i = 0; i < num_surfels; ++i) {
+    surfel_index.emplace(nodes[i].get(), i);
+    for (const auto &fd: nodes[i]->data()->frame_data()) {
+      if (fd.pixel_in_frame.frame == (unsigned int) frame_index) {
+        in_frame[i] = true;
+        break;
+      }
+    }
+  }
+
+  // Keep each edge with both ends in this frame once, by its ordered end indices
+  const auto edges = graph->edges();
+  vector<pair<pair<uint32_t, uint32_t>, uint32_t>> edges_in_frame;
+  edges_in_frame.reserve(edges.size());
+  for (uint32_t e = 0; e < edges.size(); ++e) {
+    const auto from = surfel_index.at(edges[e].from().get());
+    const auto to = surfel_index.at(edges[e].to().get());
+    if (in_frame[from] && in_frame[to] && from != to) {
+      edges_in_frame.push_back({minmax(from, to), e});
+    }
+  }
+  sort(begin(edges_in_frame), end(edges_in_frame));
+  edges_in_frame.erase(unique(begin(edges_in_frame), end(edges_in_frame),
+                              [](const pair<pair<uint32_t, uint32_t>, uint32_t> &a,
+                                 const pair<pair<uint32_t, uint32_t>, uint32_t> &b) {
+                                return a.first == b.first;
+                              }),
+                       end(edges_in_frame));
+  spdlog::info("  Found {} unique edges", edges_in_frame.size());
+
+  // The type only depends on the difference between the t values so their order doesn't matter
+  vector<EdgeType> types(edges_in_frame.size());
+  for_each_band(edges_in_frame.size(), num_threads, [&](size_t first, size_t end) {
+    for (auto i = first; i < end; ++i) {
+      const auto &edge_data = edges[edges_in_frame[i].second].data();
+      types[i] = compute_edge_type(edge_data->t_low(), edge_data->t_high());
+    }
+  });
+
+  // Every end of an edge in the frame is a vertex, even if all of its edges are skipped
+  vector<int32_t> vertex_index(num_surfels, -1);
+  for (const auto &edge: edges_in_frame) {
+    vertex_index[edge.first.first] = 0;
+    vertex_index[edge.first.second] = 0;
+  }
+  vector<uint32_t> vertex_surfel;
+  for (uint32_t i = 0; i < num_surfels; ++i) {
+    if (vertex_index[i] == 0) {
+      vertex_index[i] = (int32_t) vertex_surfel.size();
+      vertex_surfel.push_back(i);
+    }
+  }
+
+  IndexedConsensusGraph out_graph;
+  out_graph.vertices.resize(vertex_surfel.size());
+  for_each_band(vertex_surfel.size(), num_threads, [&](size_t first, size_t end) {
+    for (auto i = first; i < end; ++i) {
+      const auto &surfel = nodes[vertex_surfel[i]]->data();
+      auto &cgv = out_graph.vertices[i];
+      cgv.surfel_id = surfel->id();
+      cgv.location = surfel->reference_lattice_vertex_in_frame(frame_index, rho);
+      Eigen::Vector3f ignored1, ignored2;
+      surfel->get_vertex_tangent_normal_for_frame(frame_index, ignored1, ignored2, cgv.normal);
+    }
+  });
+
+  // Vertices are numbered in surfel order so the edges stay sorted
+  size_t num_blue = 0;
+  for (size_t i = 0; i < edges_in_frame.size(); ++i) {
+    if (types[i] == EDGE_TYPE_NON) {
       continue;
     }
-    spdlog::info("  adding {} edge {}->{} :: t_ij:({},{}) , t_ji:({},{}, length: {})",
-                 edgeType == EDGE_TYPE_BLU ? "blue" : "red",
-                 from_surfel->id(),
-                 to_surfel->id(),
-                 t_ij[0], t_ij[1],
-                 t_ji[0], t_ji[1],
-                 (from_node->data().location - to_node->data().location).norm());
-
-    out_graph->add_edge(from_node, to_node, edgeType);
+    out_graph.edges.emplace_back(vertex_index[edges_in_frame[i].first.first],
+                                 vertex_index[edges_in_frame[i].first.second]);
+    out_graph.edge_types.push_back(types[i]);
+    if (types[i] == EDGE_TYPE_BLU) {
+      ++num_blue;
+    }
   }
-  spdlog::info("New graph has {} edges", out_graph->edges().size());
+  spdlog::info("New graph has {} edges ({} blue, {} red, {} skipped)",
+               out_graph.edges.size(),
+               num_blue,
+               out_graph.edges.size() - num_blue,
+               edges_in_frame.size() - out_graph.edges.size());
   return out_graph;
 }
 
-void
-collapse(const ConsensusGraphPtr &graph) {
+ConsensusGraphPtr
+to_consensus_graph(const IndexedConsensusGraph &indexed_graph) {
+  auto out_graph = std::make_shared<ConsensusGraph>(false);
+  out_graph->add_indexed(indexed_graph.vertices, indexed_graph.edges, indexed_graph.edge_types);
+  return out_graph;
+}
+
+ConsensusGraphPtr
+build_consensus_graph(const SurfelGraphPtr &graph, int frame_index, float rho) {
+  return to_consensus_graph(build_indexed_consensus_graph(graph, frame_index, rho));
+}
+
+IndexedConsensusGraph
+to_indexed_consensus_graph(const ConsensusGraphPtr &graph) {
   using namespace std;
 
-  auto edge_merge_function = [&]( //
-      const EdgeType &e1,
-      float weight1,
-      const EdgeType &e2,
-      float weight2) {
-    // TODO : Need to be smarter here
-    if (e1 == EDGE_TYPE_RED)
-      return e1;
-    if (e2 == EDGE_TYPE_RED)
-      return e2;
-    return e1;
-  };
+  const auto nodes = graph->nodes();
+  unordered_map<const ConsensusGraph::GraphNode *, uint32_t> node_index;
+  node_index.reserve(nodes.size());
+  IndexedConsensusGraph indexed_graph;
+  indexed_graph.vertices.reserve(nodes.size());
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    node_index.emplace(nodes[i].get(), i);
+    indexed_graph.vertices.push_back(nodes[i]->data());
+  }
 
-  auto node_merge_function = [&]( //
-      const ConsensusGraphVertex &n1,
-      float weight1,
-      const ConsensusGraphVertex &n2,
-      float weight2) {
+  vector<pair<pair<uint32_t, uint32_t>, EdgeType>> typed_edges;
+  for (const auto &edge: graph->edges()) {
+    typed_edges.push_back({minmax(node_index.at(edge.from().get()), node_index.at(edge.to().get())),
+                           *edge.data()});
+  }
+  sort(begin(typed_edges), end(typed_edges));
+  for (const auto &typed_edge: typed_edges) {
+    indexed_graph.edges.push_back(typed_edge.first);
+    indexed_graph.edge_types.push_back(typed_edge.second);
+  }
+  return indexed_graph;
+}
 
-    return ConsensusGraphVertex{(n1.surfel_id + n2.surfel_id),
-                                ((n1.location * weight1) + (n2.location * weight2)) / (weight1 + weight2),
-                                ((n1.normal * weight1) + (n2.normal * weight2)).normalized()
-    };
+namespace {
+  /* A blue edge between two clusters, valid while neither has changed since it was queued */
+  struct QueuedBlueEdge {
+    float squared_length;
+    uint32_t root_a;
+    uint32_t root_b;
+    uint32_t version_a;
+    uint32_t version_b;
+
+    bool operator>(const QueuedBlueEdge &other) const {
+      return squared_length > other.squared_length;
+    }
   };
+}
 
-  auto edge_sort_pred = [](
-      const pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr> &e1,
-      const pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr> &e2
-  ) -> bool {
-    auto l1 = (e2.second->data().location - e2.first->data().location).squaredNorm();
-    auto l2 = (e1.second->data().location - e1.first->data().location).squaredNorm();
-    // Using this on a queue so the FIRST thing should be the smallest
-    return l1 < l2;
-  };
+IndexedConsensusGraph
+collapse(const IndexedConsensusGraph &graph) {
+  using namespace std;
+  using namespace Eigen;
+
+  const auto num_vertices = (uint32_t) graph.vertices.size();
+
+  // Union-find forest over the vertices. Each root holds the vertex and incident edges of its cluster.
+  vector<uint32_t> parent(num_vertices);
+  iota(begin(parent), end(parent), 0);
+  vector<uint32_t> cluster_size(num_vertices, 1);
+  vector<uint32_t> version(num_vertices, 0);
+  vector<Vector3f> location(num_vertices);
+  vector<Vector3f> normal(num_vertices);
+  vector<vector<uint32_t>> incident_edges(num_vertices);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    location[v] = graph.vertices[v].location;
+    normal[v] = graph.vertices[v].normal;
+  }
+  for (uint32_t e = 0; e < graph.edges.size(); ++e) {
+    incident_edges[graph.edges[e].first].push_back(e);
+    incident_edges[graph.edges[e].second].push_back(e);
+  }
 
-  // Extract blue edges
-  priority_queue<pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr>,
-                 vector<pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr>>,
-                 auto (*)(const pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr> &,
-                          const pair<ConsensusGraphNodePtr, ConsensusGraphNodePtr> &)->bool>
-      blue_edges{edge_sort_pred};
+  const auto find_root = [&parent](uint32_t v) {
+    while (parent[v] != v) {
+      parent[v] = parent[parent[v]];
+      v = parent[v];
+    }
+    return v;
+  };
+  const auto squared_distance = [&](uint32_t root_a, uint32_t root_b) {
+    return (location[root_a] - location[root_b]).squaredNorm();
+  };
 
-  for (const auto &edge: graph->edges()) {
-    if (*(edge.data()) == EDGE_TYPE_BLU) {
-      blue_edges.emplace(edge.from(), edge.to());
+  // Shortest first
+  priority_queue<QueuedBlueEdge, vector<QueuedBlueEdge>, greater<QueuedBlueEdge>> blue_edges;
+  for (uint32_t e = 0; e < graph.edges.size(); ++e) {
+    if (graph.edge_types[e] == EDGE_TYPE_BLU) {
+      const auto &ends = graph.edges[e];
+      blue_edges.push({squared_distance(ends.first, ends.second), ends.first, ends.second, 0, 0});
     }
   }
 
-  // Iterate over the list, deleting edges and adding in newly generated ones
+  // Type of the edge from the cluster being merged to each neighbouring cluster
+  vector<EdgeType> neighbour_type(num_vertices, EDGE_TYPE_NON);
+  vector<uint32_t> neighbours;
   while (!blue_edges.empty()) {
-    auto next_edge = blue_edges.top();
+    const auto edge = blue_edges.top();
     blue_edges.pop();
-    auto from_node = next_edge.first;
-    auto to_node = next_edge.second;
-
-    // Check that the edge is still present as it may not be
-    vector<ConsensusGraph::Edge> removed_edges;
-    vector<ConsensusGraph::Edge> created_edges;
-    if (graph->has_edge(from_node, to_node)) {
-      graph->collapse_edge(from_node, to_node,
-                           node_merge_function,
-                           edge_merge_function,
-                           removed_edges,
-                           created_edges);
+    if (version[edge.root_a] != edge.version_a || version[edge.root_b] != edge.version_b) {
+      continue;
+    }
+
+    // Merge the smaller cluster into the larger, meeting in the middle as collapse_edge does
+    auto root = edge.root_a;
+    auto merged = edge.root_b;
+    if (cluster_size[root] < cluster_size[merged]) {
+      swap(root, merged);
     }
-    // Add newly created edges to queue
-    for (const auto &c_edge: created_edges) {
-      if (*(c_edge.data()) == EDGE_TYPE_BLU) {
-        blue_edges.emplace(c_edge.from(), c_edge.to());
+    parent[merged] = root;
+    cluster_size[root] += cluster_size[merged];
+    location[root] = (location[root] + location[merged]) / 2.0f;
+    normal[root] = (normal[root] + normal[merged]).normalized();
+    ++version[root];
+    ++version[merged];
+    auto &incident = incident_edges[root];
+    incident.insert(end(incident), begin(incident_edges[merged]), end(incident_edges[merged]));
+    vector<uint32_t>().swap(incident_edges[merged]);
+
+    // Drop edges now inside the cluster. Edges to the same neighbour merge, red winning over blue.
+    size_t num_kept = 0;
+    for (const auto e: incident) {
+      auto other = find_root(graph.edges[e].first);
+      if (other == root) {
+        other = find_root(graph.edges[e].second);
+      }
+      if (other == root) {
+        continue;
+      }
+      incident[num_kept++] = e;
+      if (neighbour_type[other] == EDGE_TYPE_NON) {
+        neighbours.push_back(other);
+        neighbour_type[other] = graph.edge_types[e];
+      } else if (graph.edge_types[e] == EDGE_TYPE_RED) {
+        neighbour_type[other] = EDGE_TYPE_RED;
       }
     }
-  }
-}
-
-int get_next_best_edge( //
-    const std::vector<ConsensusGraph::Edge> &potential_next_edges, //
-    std::set<std::pair<std::string, std::string>> used_edges, //
-    const Eigen::Vector3f &last_edge_vector //
-) {
-  using namespace std;
-
-  vector<pair<int, float>> tentative_next_edges;
+    incident.resize(num_kept);
 
-  for (auto i = 0; i < potential_next_edges.size(); ++i) {
-    const auto &pne = potential_next_edges[i];
-    const auto &curr_surfel = pne.from()->data();
-    const auto &curr_surfel_id = curr_surfel.surfel_id;
+    // The cluster has moved so its blue edges are queued again at their new lengths
+    for (const auto neighbour: neighbours) {
+      if (neighbour_type[neighbour] == EDGE_TYPE_BLU) {
+        blue_edges.push({squared_distance(root, neighbour), root, neighbour, version[root], version[neighbour]});
+      }
+      neighbour_type[neighbour] = EDGE_TYPE_NON;
+    }
+    neighbours.clear();
+  }
 
-    const auto &next_surfel = pne.to()->data();
-    const auto &next_surfel_id = next_surfel.surfel_id;
+  // Number the clusters in order of their first vertex
+  IndexedConsensusGraph collapsed;
+  vector<int32_t> cluster_index(num_vertices, -1);
+  for (uint32_t v = 0; v < num_vertices; ++v) {
+    const auto root = find_root(v);
+    if (cluster_index[root] < 0) {
+      cluster_index[root] = (int32_t) collapsed.vertices.size();
+      collapsed.vertices.push_back(ConsensusGraphVertex{"", location[root], normal[root]});
+    }
+    collapsed.vertices[cluster_index[root]].surfel_id += graph.vertices[v].surfel_id;
+  }
 
-    // Reject edges that are used
-    if (used_edges.count({curr_surfel_id, next_surfel_id}) > 0) {
+  // Edges between clusters, once each. Red sorts before blue so it survives the dedupe.
+  vector<pair<pair<uint32_t, uint32_t>, EdgeType>> typed_edges;
+  for (uint32_t e = 0; e < graph.edges.size(); ++e) {
+    const auto a = (uint32_t) cluster_index[find_root(graph.edges[e].first)];
+    const auto b = (uint32_t) cluster_index[find_root(graph.edges[e].second)];
+    if (a != b) {
+      typed_edges.push_back({minmax(a, b), graph.edge_types[e]});
+    }
+  }
+  sort(begin(typed_edges), end(typed_edges));
+  for (size_t i = 0; i < typed_edges.size(); ++i) {
+    if (i > 0 && typed_edges[i].first == typed_edges[i - 1].first) {
       continue;
     }
+    collapsed.edges.push_back(typed_edges[i].first);
+    collapsed.edge_types.push_back(typed_edges[i].second);
+  }
+  return collapsed;
+}
+
+void
+collapse(const ConsensusGraphPtr &graph) {
+  const auto collapsed = collapse(to_indexed_consensus_graph(graph));
+  graph->clear();
+  graph->add_indexed(collapsed.vertices, collapsed.edges, collapsed.edge_types);
+}
 
-    auto next_edge_vector = next_surfel.location - curr_surfel.location;
-    // compute triple product
-    auto triple = last_edge_vector.cross(next_edge_vector).dot(curr_surfel.normal);
+namespace {
+  /* Shortest and longest cycles kept as faces. Quads are the aim, with triangles and pentagons where the lattice is irregular. */
+  const size_t MIN_FACE_SIZE = 3;
+  const size_t MAX_FACE_SIZE = 5;
+}
 
-    // There may be multiple edges with triple product > 0
-    // So we add to a list and pick the one that is closest to 90 degrees
-    if (triple <= 0) {
-      continue;
-    }
+void
+extract_faces(const IndexedConsensusGraph &graph,
+              std::vector<uint32_t> &face_offsets,
+              std::vector<uint32_t> &face_vertices,
+              unsigned int num_threads) {
+  using namespace std;
+  using namespace Eigen;
+  using animesh::spatial_index::for_each_band;
 
+  const auto num_vertices = (uint32_t) graph.vertices.size();
+  const auto num_half_edges = (uint32_t) (2 * graph.edges.size());
 
-    // Add to list of tentative next edges.
-    auto angle = degrees_angle_between_vectors(last_edge_vector, next_edge_vector);
-    tentative_next_edges.emplace_back(make_pair(i, angle));
-  }
+  // Half edge 2e runs from the lower to the higher end of edge e and 2e + 1 runs back, so twins differ in bit 0
+  const auto half_edge_start = [&graph](uint32_t h) {
+    return (h & 1) ? graph.edges[h >> 1].second : graph.edges[h >> 1].first;
+  };
+  const auto half_edge_end = [&graph](uint32_t h) {
+    return (h & 1) ? graph.edges[h >> 1].first : graph.edges[h >> 1].second;
+  };
 
-  if(tentative_next_edges.empty()) {
-    return -1;
+  // Bucket the half edges by start vertex
+  vector<uint32_t> first_outgoing(num_vertices + 1, 0);
+  for (const auto &edge: graph.edges) {
+    ++first_outgoing[edge.first + 1];
+    ++first_outgoing[edge.second + 1];
   }
-
-  if( tentative_next_edges.size() == 1) {
-    return tentative_next_edges[0].first;
+  partial_sum(begin(first_outgoing), end(first_outgoing), begin(first_outgoing));
+  vector<uint32_t> outgoing(num_half_edges);
+  {
+    auto next_slot = first_outgoing;
+    for (uint32_t h = 0; h < num_half_edges; ++h) {
+      outgoing[next_slot[half_edge_start(h)]++] = h;
+    }
   }
 
-  // Check for the best fit from the tentative next edges
-  auto best_index = tentative_next_edges[0].first;
-  auto best_angle = fabsf(90 - tentative_next_edges[0].second);
-  for( const auto & entry : tentative_next_edges) {
-    if( fabsf(90 - entry.second) < best_angle ) {
-      best_angle = fabsf(90 - entry.second);
-      best_index = entry.first;
+  // Sort each vertex's half edges anticlockwise about its normal, noting where each one lands
+  vector<uint32_t> rotation_position(num_half_edges);
+  for_each_band(num_vertices, num_threads, [&](size_t first, size_t end) {
+    vector<pair<float, uint32_t>> by_angle;
+    for (auto v = first; v < end; ++v) {
+      const auto &vertex = graph.vertices[v];
+      const Vector3f normal = (vertex.normal.squaredNorm() > 0) ? vertex.normal : Vector3f::UnitZ();
+      // Only the order of the angles matters so any tangent basis will do
+      const Vector3f u_axis = normal.unitOrthogonal();
+      const Vector3f v_axis = normal.cross(u_axis);
+      by_angle.clear();
+      for (auto i = first_outgoing[v]; i < first_outgoing[v + 1]; ++i) {
+        const Vector3f direction = graph.vertices[half_edge_end(outgoing[i])].location - vertex.location;
+        by_angle.emplace_back(atan2f(direction.dot(v_axis), direction.dot(u_axis)), outgoing[i]);
+      }
+      sort(by_angle.begin(), by_angle.end());
+      for (uint32_t k = 0; k < by_angle.size(); ++k) {
+        outgoing[first_outgoing[v] + k] = by_angle[k].second;
+        rotation_position[by_angle[k].second] = k;
+      }
+    }
+  });
+
+  // The face to the left of u->v carries on along v->w, where w is the neighbour just before u clockwise about v
+  const auto next_half_edge = [&](uint32_t h) {
+    const auto twin = h ^ 1;
+    const auto v = half_edge_start(twin);
+    const auto degree = first_outgoing[v + 1] - first_outgoing[v];
+    return outgoing[first_outgoing[v] + (rotation_position[twin] + degree - 1) % degree];
+  };
+
+  // Every half edge lies on exactly one face so each is walked once
+  face_offsets.assign(1, 0);
+  face_vertices.clear();
+  vector<bool> walked(num_half_edges, false);
+  vector<uint32_t> face;
+  for (uint32_t first_half_edge = 0; first_half_edge < num_half_edges; ++first_half_edge) {
+    if (walked[first_half_edge]) {
+      continue;
+    }
+    face.clear();
+    auto h = first_half_edge;
+    do {
+      walked[h] = true;
+      face.push_back(half_edge_start(h));
+      h = next_half_edge(h);
+    } while (h != first_half_edge);
+
+    if (face.size() < MIN_FACE_SIZE || face.size() > MAX_FACE_SIZE) {
+      continue;
+    }
+    // Walks around a dangling edge pass through a vertex twice
+    bool repeats_vertex = false;
+    for (size_t i = 0; i < face.size() && !repeats_vertex; ++i) {
+      repeats_vertex = find(begin(face) + (long) i + 1, end(face), face[i]) != end(face);
+    }
+    if (repeats_vertex) {
+      continue;
     }
+    // Faces run anticlockwise about the vertex normals. A boundary walked from outside runs clockwise.
+    Vector3f area = Vector3f::Zero();
+    Vector3f normal = Vector3f::Zero();
+    for (size_t i = 0; i < face.size(); ++i) {
+      area += graph.vertices[face[i]].location.cross(graph.vertices[face[(i + 1) % face.size()]].location);
+      normal += graph.vertices[face[i]].normal;
+    }
+    if (area.dot(normal) <= 0) {
+      continue;
+    }
+    face_vertices.insert(end(face_vertices), begin(face), end(face));
+    face_offsets.push_back((uint32_t) face_vertices.size());
   }
-  return best_index;
 }
 
 void
@@ -277,69 +449,24 @@ extract_faces(const ConsensusGraphPtr &graph,
 ) {
   using namespace std;
 
-  map<string, unsigned long> vertex_name_to_index;
-  set<pair<string, string>> used_edges;
-
-  for (const auto &edge: graph->edges()) {
-    if (used_edges.count({edge.from()->data().surfel_id, edge.to()->data().surfel_id}) > 0) {
-      continue;
-    }
-
-    auto starting_node = edge.from();
-    bool found_face = false;
-    vector<ConsensusGraph::Edge> face;
-    face.emplace_back(edge);
-
-    while (true) {
-      auto curr_node = face.back().to();
-      auto curr_surfel = curr_node->data();
-      auto curr_surfel_id = curr_surfel.surfel_id;
-      auto prev_node = face.back().from();
-      auto prev_surfel = prev_node->data();
-      auto prev_surfel_id = prev_surfel.surfel_id;
-      auto last_edge_vector = curr_surfel.location - prev_surfel.location;
-
-      // Get next edges and see if we can make a quad from them.
-      auto potential_next_edges = graph->edges_from(curr_node, prev_node);
-      if( potential_next_edges.empty()) {
-        break;
-      }
-
-      // Get the best fit for a next edge
-      auto next_edge_index = get_next_best_edge(potential_next_edges, used_edges, last_edge_vector);
-      if (next_edge_index == -1) {
-        break;
-      }
-
-      // Add the next edge
-      face.emplace_back(potential_next_edges[next_edge_index]);
-
-      // If we've closed a cycle and it's the right length, found_face
-      if (face.size() == 4) {
-        // Was loop closed?
-        if (face.back().to() == starting_node) {
-          found_face = true;
-        }
-        break;
-      }
-    }
-
-    if (found_face) {
-      // Mark all used as used.
-      // Add to faces
-      // Mark each edge as complete
-      faces.emplace_back();
-      for (const auto &face_edge: face) {
-        const auto &from_surfel = face_edge.from()->data();
-        const auto &from_surfel_id = from_surfel.surfel_id;
-        used_edges.emplace(make_pair(from_surfel_id, face_edge.to()->data().surfel_id));
-        if (vertex_name_to_index.count(from_surfel_id) == 0) {
-          vertices.emplace_back(from_surfel.location);
-          vertex_normals.emplace_back(from_surfel.normal);
-          vertex_name_to_index.emplace(from_surfel_id, vertices.size());
-        }
-        faces.back().emplace_back(vertex_name_to_index[from_surfel_id]);
+  const auto indexed_graph = to_indexed_consensus_graph(graph);
+  vector<uint32_t> face_offsets;
+  vector<uint32_t> face_vertices;
+  extract_faces(indexed_graph, face_offsets, face_vertices);
+
+  // Vertices are numbered from 1 in order of first use
+  vector<unsigned long> vertex_number(indexed_graph.vertices.size(), 0);
+  for (size_t f = 0; f + 1 < face_offsets.size(); ++f) {
+    faces.emplace_back();
+    for (auto i = face_offsets[f]; i < face_offsets[f + 1]; ++i) {
+      const auto &vertex = indexed_graph.vertices[face_vertices[i]];
+      auto &number = vertex_number[face_vertices[i]];
+      if (number == 0) {
+        vertices.emplace_back(vertex.location);
+        vertex_normals.emplace_back(vertex.normal);
+        number = vertices.size();
       }
+      faces.back().emplace_back(number);
     }
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,341 @@
+#include "TestQuad.h"
+#include <gtest/gtest.h>
+#include <Quad/Quad.h>
+#include <Surfel/SurfelBuilder.h>
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+void TestQuad::SetUp( ) {}
+void TestQuad::TearDown() {}
+
+namespace {
+    /* A vertex at (x, y, z) facing +z */
+    ConsensusGraphVertex vertex(const std::string &id, float x, float y, float z = 0.0f) {
+        return ConsensusGraphVertex{id, Eigen::Vector3f{x, y, z}, Eigen::Vector3f::UnitZ()};
+    }
+
+    /* An indexed graph with each edge held as (lower, higher) in sorted order */
+    IndexedConsensusGraph make_graph(const std::vector<ConsensusGraphVertex> &vertices,
+                                     const std::vector<std::tuple<uint32_t, uint32_t, EdgeType>> &edges) {
+        using namespace std;
+
+        vector<pair<pair<uint32_t, uint32_t>, EdgeType>> typed_edges;
+        for (const auto &edge: edges) {
+            typed_edges.push_back({minmax(get<0>(edge), get<1>(edge)), get<2>(edge)});
+        }
+        sort(begin(typed_edges), end(typed_edges));
+        IndexedConsensusGraph graph;
+        graph.vertices = vertices;
+        for (const auto &typed_edge: typed_edges) {
+            graph.edges.push_back(typed_edge.first);
+            graph.edge_types.push_back(typed_edge.second);
+        }
+        return graph;
+    }
+
+    /* An n x n grid of unit squares in the xy plane, vertex y * n + x at (x, y) */
+    IndexedConsensusGraph make_grid(uint32_t n) {
+        using namespace std;
+
+        vector<ConsensusGraphVertex> vertices;
+        vector<tuple<uint32_t, uint32_t, EdgeType>> edges;
+        for (uint32_t y = 0; y < n; ++y) {
+            for (uint32_t x = 0; x < n; ++x) {
+                const auto v = y * n + x;
+                vertices.push_back(vertex(to_string(v), (float) x, (float) y));
+                if (x + 1 < n) {
+                    edges.emplace_back(v, v + 1, EDGE_TYPE_RED);
+                }
+                if (y + 1 < n) {
+                    edges.emplace_back(v, v + n, EDGE_TYPE_RED);
+                }
+            }
+        }
+        return make_graph(vertices, edges);
+    }
+
+    /* The faces of a graph, each starting at its lowest vertex, in sorted order */
+    std::vector<std::vector<uint32_t>> faces_of(const IndexedConsensusGraph &graph) {
+        using namespace std;
+
+        vector<uint32_t> face_offsets;
+        vector<uint32_t> face_vertices;
+        extract_faces(graph, face_offsets, face_vertices);
+        vector<vector<uint32_t>> faces;
+        for (size_t f = 0; f + 1 < face_offsets.size(); ++f) {
+            vector<uint32_t> face{begin(face_vertices) + face_offsets[f], begin(face_vertices) + face_offsets[f + 1]};
+            rotate(begin(face), min_element(begin(face), end(face)), end(face));
+            faces.push_back(face);
+        }
+        sort(begin(faces), end(faces));
+        return faces;
+    }
+
+    /* Add a red edge between a and b, keeping the edges sorted */
+    void add_edge(IndexedConsensusGraph &graph, uint32_t a, uint32_t b) {
+        const std::pair<uint32_t, uint32_t> edge = std::minmax(a, b);
+        const auto it = std::lower_bound(begin(graph.edges), end(graph.edges), edge);
+        graph.edge_types.insert(begin(graph.edge_types) + (it - begin(graph.edges)), EDGE_TYPE_RED);
+        graph.edges.insert(it, edge);
+    }
+
+    /* Drop the edge between a and b */
+    void remove_edge(IndexedConsensusGraph &graph, uint32_t a, uint32_t b) {
+        const std::pair<uint32_t, uint32_t> edge = std::minmax(a, b);
+        const auto it = std::find(begin(graph.edges), end(graph.edges), edge);
+        graph.edge_types.erase(begin(graph.edge_types) + (it - begin(graph.edges)));
+        graph.edges.erase(it);
+    }
+
+    /* An edge of a surfel graph whose ends have the given t values */
+    SurfelGraphEdge surfel_edge(int t_low_x, int t_low_y, int t_high_x, int t_high_y) {
+        SurfelGraphEdge edge{1.0f};
+        edge.set_t_low(t_low_x, t_low_y);
+        edge.set_t_high(t_high_x, t_high_y);
+        return edge;
+    }
+}
+
+/* ********************************************************************************
+ * ** Test building consensus graphs
+ * ********************************************************************************/
+TEST_F( TestQuad, BuildIndexedConsensusGraphShouldKeepEachTypedEdgeInFrameOnce ) {
+    using namespace std;
+    using namespace Eigen;
+
+    // s0, s1, s2 and s4 are seen in frame 0; s3 only in frame 1
+    default_random_engine rng{123};
+    SurfelBuilder builder{rng};
+    const vector<unsigned int> frames{0, 0, 0, 1, 0};
+    auto graph = make_shared<SurfelGraph>(true);
+    vector<SurfelGraphNodePtr> nodes;
+    for (unsigned int i = 0; i < frames.size(); ++i) {
+        const auto surfel = builder.reset()
+                ->with_id("s" + to_string(i))
+                ->with_tangent(1, 0, 0)
+                ->with_reference_lattice_offset(0, 0)
+                ->with_frame({i, 0, frames[i]}, 1.0f, Vector3f::UnitY(), Vector3f{(float) i, 0.0f, 1.0f})
+                ->build();
+        nodes.push_back(graph->add_node(make_shared<Surfel>(surfel)));
+    }
+    // s0-s1 is given in both directions, s2-s0 runs from the higher surfel to the lower,
+    // s2-s3 leaves the frame and s2-s4 is too long to be red or blue
+    graph->add_edge(nodes[0], nodes[1], surfel_edge(0, 0, 0, 0));
+    graph->add_edge(nodes[1], nodes[0], surfel_edge(0, 0, 0, 0));
+    graph->add_edge(nodes[2], nodes[0], surfel_edge(1, 0, 0, 0));
+    graph->add_edge(nodes[1], nodes[2], surfel_edge(0, 0, 0, 1));
+    graph->add_edge(nodes[2], nodes[3], surfel_edge(0, 0, 0, 0));
+    graph->add_edge(nodes[2], nodes[4], surfel_edge(0, 0, 1, 1));
+
+    for (const auto num_threads: {1u, 4u}) {
+        const auto consensus_graph = build_indexed_consensus_graph(graph, 0, 1.0f, num_threads);
+
+        // s4 stays a vertex though its only edge is dropped
+        ASSERT_EQ(4, consensus_graph.vertices.size());
+        const vector<string> ids{"s0", "s1", "s2", "s4"};
+        const vector<float> xs{0.0f, 1.0f, 2.0f, 4.0f};
+        for (size_t v = 0; v < ids.size(); ++v) {
+            EXPECT_EQ(ids[v], consensus_graph.vertices[v].surfel_id);
+            EXPECT_TRUE(consensus_graph.vertices[v].location.isApprox(Vector3f(xs[v], 0.0f, 1.0f)));
+            EXPECT_TRUE(consensus_graph.vertices[v].normal.isApprox(Vector3f::UnitY()));
+        }
+
+        EXPECT_EQ((vector<pair<uint32_t, uint32_t>>{{0, 1}, {0, 2}, {1, 2}}), consensus_graph.edges);
+        EXPECT_EQ((vector<EdgeType>{EDGE_TYPE_BLU, EDGE_TYPE_RED, EDGE_TYPE_RED}), consensus_graph.edge_types);
+    }
+}
+
+/* ********************************************************************************
+ * ** Test collapse
+ * ********************************************************************************/
+TEST_F( TestQuad, CollapseShouldMergeBlueTwinsAtTheirMidpoint ) {
+    using namespace std;
+    using namespace Eigen;
+
+    auto twin = vertex("b", 0.2f, 0.0f);
+    twin.normal = Vector3f::UnitY();
+    const auto graph = make_graph(
+            {vertex("a", 0.0f, 0.0f), twin, vertex("c", 1.0f, 0.0f)},
+            {{0, 1, EDGE_TYPE_BLU}, {0, 2, EDGE_TYPE_RED}, {1, 2, EDGE_TYPE_BLU}});
+
+    const auto collapsed = collapse(graph);
+
+    ASSERT_EQ(2, collapsed.vertices.size());
+    EXPECT_EQ("ab", collapsed.vertices[0].surfel_id);
+    EXPECT_TRUE(collapsed.vertices[0].location.isApprox(Vector3f{0.1f, 0.0f, 0.0f}));
+    EXPECT_TRUE(collapsed.vertices[0].normal.isApprox(Vector3f{0.0f, 1.0f, 1.0f}.normalized()));
+    EXPECT_EQ("c", collapsed.vertices[1].surfel_id);
+    EXPECT_TRUE(collapsed.vertices[1].location.isApprox(Vector3f{1.0f, 0.0f, 0.0f}));
+
+    // The red edge from a and the blue edge from b meet and red wins, so c is never merged
+    ASSERT_EQ(1, collapsed.edges.size());
+    EXPECT_EQ(make_pair(0u, 1u), collapsed.edges[0]);
+    EXPECT_EQ(EDGE_TYPE_RED, collapsed.edge_types[0]);
+}
+
+TEST_F( TestQuad, CollapseShouldMergeClustersAtTheMidpointOfTheirLocations ) {
+    using namespace Eigen;
+
+    // 0 and 1 merge first at 0.05, then meet 2 halfway rather than at the mean of all three
+    const auto graph = make_graph(
+            {vertex("a", 0.0f, 0.0f), vertex("b", 0.1f, 0.0f), vertex("c", 0.3f, 0.0f)},
+            {{0, 1, EDGE_TYPE_BLU}, {1, 2, EDGE_TYPE_BLU}});
+
+    const auto collapsed = collapse(graph);
+
+    ASSERT_EQ(1, collapsed.vertices.size());
+    EXPECT_EQ("abc", collapsed.vertices[0].surfel_id);
+    EXPECT_TRUE(collapsed.vertices[0].location.isApprox(Vector3f{0.175f, 0.0f, 0.0f}));
+    EXPECT_TRUE(collapsed.edges.empty());
+    EXPECT_TRUE(collapsed.edge_types.empty());
+}
+
+TEST_F( TestQuad, CollapseShouldReduceGridOfTwinsToGrid ) {
+    using namespace std;
+    using namespace Eigen;
+
+    // Each lattice point of a 3x3 grid is a pair of twins joined by a blue edge. Both twins
+    // have red edges to the twins of their neighbours.
+    const uint32_t n = 3;
+    vector<ConsensusGraphVertex> vertices;
+    vector<tuple<uint32_t, uint32_t, EdgeType>> edges;
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            const auto point = 2 * (y * n + x);
+            vertices.push_back(vertex("", (float) x - 0.05f, (float) y));
+            vertices.push_back(vertex("", (float) x + 0.05f, (float) y));
+            edges.emplace_back(point, point + 1, EDGE_TYPE_BLU);
+            if (x + 1 < n) {
+                edges.emplace_back(point, point + 2, EDGE_TYPE_RED);
+                edges.emplace_back(point + 1, point + 3, EDGE_TYPE_RED);
+            }
+            if (y + 1 < n) {
+                edges.emplace_back(point, point + 2 * n, EDGE_TYPE_RED);
+                edges.emplace_back(point + 1, point + 2 * n + 1, EDGE_TYPE_RED);
+            }
+        }
+    }
+
+    const auto collapsed = collapse(make_graph(vertices, edges));
+
+    ASSERT_EQ(n * n, collapsed.vertices.size());
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            EXPECT_TRUE(collapsed.vertices[y * n + x].location.isApprox(Vector3f{(float) x, (float) y, 0.0f}));
+        }
+    }
+    ASSERT_EQ(2 * n * (n - 1), collapsed.edges.size());
+    for (size_t e = 0; e < collapsed.edges.size(); ++e) {
+        const auto &edge = collapsed.edges[e];
+        EXPECT_TRUE(edge.second == edge.first + 1 || edge.second == edge.first + n);
+        EXPECT_EQ(EDGE_TYPE_RED, collapsed.edge_types[e]);
+    }
+}
+
+TEST_F( TestQuad, CollapseShouldReplaceConsensusGraphInPlace ) {
+    const auto indexed_graph = make_graph(
+            {vertex("a", 0.0f, 0.0f), vertex("b", 0.2f, 0.0f), vertex("c", 1.0f, 0.0f)},
+            {{0, 1, EDGE_TYPE_BLU}, {1, 2, EDGE_TYPE_RED}});
+    const auto graph = to_consensus_graph(indexed_graph);
+
+    collapse(graph);
+
+    EXPECT_EQ(2, graph->num_nodes());
+    EXPECT_EQ(1, graph->num_edges());
+    const auto collapsed = to_indexed_consensus_graph(graph);
+    ASSERT_EQ(1, collapsed.edge_types.size());
+    EXPECT_EQ(EDGE_TYPE_RED, collapsed.edge_types[0]);
+}
+
+/* ********************************************************************************
+ * ** Test extract_faces
+ * ********************************************************************************/
+TEST_F( TestQuad, ExtractFacesShouldFindEachSquareOfGrid ) {
+    using namespace std;
+
+    const uint32_t n = 5;
+    const auto faces = faces_of(make_grid(n));
+
+    vector<vector<uint32_t>> expected;
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            const auto v = y * n + x;
+            expected.push_back({v, v + 1, v + n + 1, v + n});
+        }
+    }
+    EXPECT_EQ((n - 1) * (n - 1), faces.size());
+    EXPECT_EQ(expected, faces);
+}
+
+TEST_F( TestQuad, ExtractFacesShouldRejectOutsideOfBoundary ) {
+    using namespace std;
+
+    // The walk around the outside of a lone square is also four vertices long, but clockwise
+    const auto faces = faces_of(make_grid(2));
+
+    EXPECT_EQ((vector<vector<uint32_t>>{{0, 1, 3, 2}}), faces);
+}
+
+TEST_F( TestQuad, ExtractFacesShouldRejectWalksAroundDanglingEdge ) {
+    using namespace std;
+
+    // A spike from 0 into the triangle makes its walk 0, 1, 2, 0, 3, which is anticlockwise
+    // and short enough to keep but passes through 0 twice
+    const auto triangle = make_graph(
+            {vertex("0", 0.0f, 0.0f), vertex("1", 2.0f, 0.0f), vertex("2", 0.0f, 2.0f), vertex("3", 0.5f, 0.5f)},
+            {{0, 1, EDGE_TYPE_RED}, {1, 2, EDGE_TYPE_RED}, {2, 0, EDGE_TYPE_RED}, {0, 3, EDGE_TYPE_RED}});
+    EXPECT_TRUE(faces_of(triangle).empty());
+
+    // A spike out of a square leaves the square alone
+    auto square = make_grid(2);
+    square.vertices.push_back(vertex("4", 2.0f, 0.0f));
+    add_edge(square, 1, 4);
+    EXPECT_EQ((vector<vector<uint32_t>>{{0, 1, 3, 2}}), faces_of(square));
+}
+
+TEST_F( TestQuad, ExtractFacesShouldKeepTrianglesAndPentagons ) {
+    using namespace std;
+
+    // A diagonal splits a square into two triangles
+    auto split_square = make_grid(2);
+    add_edge(split_square, 0, 3);
+    EXPECT_EQ((vector<vector<uint32_t>>{{0, 1, 3}, {0, 3, 2}}), faces_of(split_square));
+
+    // Routing the edge from 0 to 1 through a new vertex 9 below them turns a square into a pentagon
+    auto pentagon_grid = make_grid(3);
+    remove_edge(pentagon_grid, 0, 1);
+    pentagon_grid.vertices.push_back(vertex("9", 0.5f, -0.8f));
+    add_edge(pentagon_grid, 0, 9);
+    add_edge(pentagon_grid, 1, 9);
+    EXPECT_EQ((vector<vector<uint32_t>>{{0, 9, 1, 4, 3}, {1, 2, 5, 4}, {3, 4, 7, 6}, {4, 5, 8, 7}}),
+              faces_of(pentagon_grid));
+
+    // Dropping an inner edge merges two squares into a hexagon, which is too long to keep
+    auto hexagon_grid = make_grid(3);
+    remove_edge(hexagon_grid, 1, 4);
+    EXPECT_EQ((vector<vector<uint32_t>>{{3, 4, 7, 6}, {4, 5, 8, 7}}), faces_of(hexagon_grid));
+}
+
+TEST_F( TestQuad, ExtractFacesShouldNumberConsensusGraphVerticesInOrderOfUse ) {
+    using namespace std;
+
+    const auto graph = to_consensus_graph(make_grid(3));
+    vector<Eigen::Vector3f> vertices;
+    vector<Eigen::Vector3f> vertex_normals;
+    vector<vector<unsigned long>> faces;
+    extract_faces(graph, vertices, vertex_normals, faces);
+
+    EXPECT_EQ(9, vertices.size());
+    EXPECT_EQ(9, vertex_normals.size());
+    ASSERT_EQ(4, faces.size());
+    unsigned long highest_number = 0;
+    for (const auto &face: faces) {
+        ASSERT_EQ(4, face.size());
+        for (const auto number: face) {
+            EXPECT_LE(number, highest_number + 1);
+            highest_number = max(highest_number, number);
+        }
+    }
+    EXPECT_EQ(9, highest_number);
+}
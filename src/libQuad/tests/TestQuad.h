@@ -0,0 +1,9 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+class TestQuad : public ::testing::Test {
+public:
+	void SetUp( );
+	void TearDown();
+};
@@ -0,0 +1,13 @@
+/**
+ * All tests
+ */
+
+#include <gtest/gtest.h>
+
+/**
+ * Run all tests
+ */ 
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
\ No newline at end of file
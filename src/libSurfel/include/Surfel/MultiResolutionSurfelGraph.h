@@ -38,6 +38,19 @@ class MultiResolutionSurfelGraph {
     return m_levels.size();
   }
 
+  /**
+   * Estimate the memory used by all levels and the mappings between them.
+   */
+  animesh::MemoryReport memory_report() const;
+
+  /**
+   * Stop generate_levels from building a level which would take the estimated
+   * memory use above this many bytes. Zero means no limit.
+   */
+  inline void set_memory_budget(size_t bytes) {
+    m_memory_budget = bytes;
+  }
+
   /**
    * Return a reference to the specified level of the graph
    */
@@ -59,6 +72,15 @@ class MultiResolutionSurfelGraph {
 
   std::default_random_engine &m_random_engine;
 
+  size_t m_memory_budget;
+
+  /**
+   * Estimate the bytes needed to generate one more level, including working storage,
+   * from the size of the current coarsest level.
+   * @param top_report The memory report of the current coarsest level.
+   */
+  size_t estimate_next_level_bytes(const animesh::MemoryReport &top_report) const;
+
   /**
  * Generate the next level for this multi-resolution graph.
  * Uses an additive approach
@@ -2,6 +2,7 @@
 
 #include <Eigen/Core>
 #include <Graph/Graph.h>
+#include <Graph/MemoryReport.h>
 #include "Surfel.h"
 
 class SurfelGraphEdge {
@@ -66,6 +67,13 @@ using SurfelGraphNodePtr = std::shared_ptr<animesh::Graph<std::shared_ptr<Surfel
 unsigned int
 get_num_frames(const SurfelGraphPtr &surfel_graph);
 
+/**
+ * Estimate the memory used by a surfel graph, including the surfels themselves,
+ * their per-frame data and their IDs.
+ */
+animesh::MemoryReport
+memory_report(const SurfelGraphPtr &surfel_graph);
+
 std::vector<SurfelGraphNodePtr>
 get_node_neighbours_in_frame(
     const SurfelGraphPtr &graph,
@@ -50,6 +50,28 @@ are_neighbours(const std::shared_ptr<Surfel> &surfel1, const std::shared_ptr<Sur
 SurfelGraphPtr
 graph_from_surfels(std::vector<std::shared_ptr<Surfel>> &surfels, bool eight_connected);
 
+/**
+ * Find the pairs of surfels which are near one another in at least min_common_frames frames.
+ * @param surfels The surfels.
+ * @param radius Surfels are near in a frame when they are no further apart than this. If k is
+ * non-zero this only caps the distance and may be zero for no cap.
+ * @param k If non-zero, surfels are near in a frame when either is one of the k nearest to the other.
+ * @param min_common_frames The number of frames in which a pair must be near.
+ * @return The pairs as indices into surfels, lower index first, in ascending order.
+ */
+std::vector<std::pair<unsigned int, unsigned int>>
+find_proximate_surfels(const std::vector<std::shared_ptr<Surfel>> &surfels,
+                       float radius, unsigned int k, unsigned int min_common_frames);
+
+/**
+ * Build a graph of surfels connecting those which are near one another in at least
+ * min_common_frames frames, for surfels with no pixel grid to find neighbours in.
+ * See find_proximate_surfels for the meaning of the parameters.
+ */
+SurfelGraphPtr
+graph_from_proximate_surfels(std::vector<std::shared_ptr<Surfel>> &surfels,
+                             float radius, unsigned int k, unsigned int min_common_frames);
+
 SurfelGraphPtr
 generate_surfels(const std::vector<DepthMap> &depth_maps,
                  const std::vector<std::vector<PixelInFrame>> &correspondences,
@@ -6,10 +6,31 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <fstream>
 
 const unsigned int FLAG_SMOOTHNESS = (1 << 1);
 const unsigned int FLAG_EDGES = (1 << 0);
 
+/**
+ * Write the start of a surfel file: the flags marker, the flags and the surfel count.
+ * The marker is always written so a count can never be mistaken for it when loading.
+ */
+void
+write_surfel_file_header(std::ofstream &file, unsigned short flags, unsigned int num_surfels);
+
+/**
+ * Write a single surfel record, including the ids of its neighbours.
+ * Use this to stream a graph to disk without building it in memory: write the
+ * header with write_surfel_file_header and flags 0, then one record per surfel.
+ * Files written this way have no edge section; edges are rebuilt from the
+ * neighbour ids when loaded.
+ */
+void
+write_surfel_to_file(std::ofstream &file,
+                     const Surfel &surfel,
+                     const std::vector<std::string> &neighbour_ids,
+                     bool save_smoothness = false);
+
 /**
  * Save surfel data as binary file to disk
  */
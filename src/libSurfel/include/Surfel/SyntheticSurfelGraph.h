@@ -0,0 +1,104 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+
+#include "Surfel.h"
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+/**
+ * Parametric surfaces which can be sampled to make synthetic surfel graphs.
+ */
+enum SyntheticSurface {
+  SS_PLANE,
+  SS_SPHERE,
+  SS_TORUS,
+  SS_CLOTH
+};
+
+/**
+ * Return the surface with the given name (plane, sphere, torus or cloth).
+ * Throws if the name is not recognised.
+ */
+SyntheticSurface
+synthetic_surface_with_name(const std::string &name);
+
+struct SyntheticSurfelGraphParameters {
+  SyntheticSurfelGraphParameters();
+
+  SyntheticSurface surface;
+  unsigned int width;         // Samples in u (around the surface for sphere and torus)
+  unsigned int height;        // Samples in v
+  unsigned int num_frames;    // Frames over which the surface deforms
+  float scale;                // Plane and cloth side length, sphere radius, torus major radius
+  float position_noise;       // Std dev of Gaussian noise added to each position
+  float normal_noise;         // Std dev of Gaussian noise added to each normal before normalising
+  float dropout;              // Probability that a surfel is occluded in any given frame
+  float edge_dropout;         // Probability that an edge between neighbouring samples is removed
+  bool eight_connected;       // Connect diagonal neighbours as well as 4-neighbours
+  unsigned int seed;
+};
+
+/**
+ * Generates multi-frame surfel graphs by sampling a parametric surface on a
+ * width x height grid and deforming it over a number of frames.
+ *
+ * Every surfel, and every edge, is a pure function of the parameters and its
+ * index so surfels can be generated in any order and graphs far larger than
+ * memory can be streamed straight to disk with write().
+ */
+class SyntheticSurfelGraphGenerator {
+ public:
+  explicit SyntheticSurfelGraphGenerator(const SyntheticSurfelGraphParameters &parameters);
+
+  inline size_t num_surfels() const {
+    return (size_t) m_parameters.width * m_parameters.height;
+  }
+
+  std::string surfel_id(size_t index) const;
+
+  /**
+   * Build the surfel with the given index.
+   */
+  Surfel surfel(size_t index) const;
+
+  /**
+   * Return the indices of the surfels connected to the given one.
+   * Neighbours are adjacent grid samples which are visible together in at least one frame.
+   */
+  std::vector<size_t> neighbours(size_t index) const;
+
+  /**
+   * Write the graph to file in the format read by load_surfel_graph_from_file,
+   * one surfel at a time.
+   */
+  void write(const std::string &file_name) const;
+
+ private:
+  /* Uniform value in [0,1) derived from the seed and the given keys */
+  float hash_to_unit(size_t key1, size_t key2) const;
+
+  bool is_visible(size_t index, unsigned int frame_idx) const;
+
+  bool has_edge(size_t index_a, size_t index_b) const;
+
+  inline bool wraps_in_u() const {
+    return m_parameters.surface == SS_SPHERE || m_parameters.surface == SS_TORUS;
+  }
+
+  inline bool wraps_in_v() const {
+    return m_parameters.surface == SS_TORUS;
+  }
+
+  /* Position of the surface at parameters u, v in frame time t, all in [0,1] */
+  Eigen::Vector3f surface_point(float u, float v, float t) const;
+
+  Eigen::Vector3f surface_normal(float u, float v, float t) const;
+
+  void grid_parameters(size_t index, float &u, float &v) const;
+
+  SyntheticSurfelGraphParameters m_parameters;
+};
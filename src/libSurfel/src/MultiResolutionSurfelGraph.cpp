@@ -10,6 +10,13 @@
 #include <map>
 #include <Eigen/Core>
 
+/* Bytes used by an up mapping with the given number of entries */
+static size_t
+up_mapping_bytes(size_t num_entries) {
+  return num_entries * animesh::tree_node_bytes<
+      std::map<SurfelGraphNodePtr, std::pair<SurfelGraphNodePtr, SurfelGraphNodePtr>>::value_type>();
+}
+
 struct MultiResolutionSurfelGraph::SurfelGraphEdgeComparator {
   bool operator()(const SurfelGraph::Edge &lhs, const SurfelGraph::Edge &rhs) const {
     if (lhs.from()->data()->id() < rhs.from()->data()->id()) {
@@ -69,6 +76,7 @@ MultiResolutionSurfelGraph::MultiResolutionSurfelGraph(
     const SurfelGraphPtr &surfel_graph,
     std::default_random_engine &rng)
     : m_random_engine{rng} //
+    , m_memory_budget{0} //
 {
   m_levels.push_back(surfel_graph);
 }
@@ -93,11 +101,77 @@ MultiResolutionSurfelGraph::generate_levels(unsigned int num_levels) {
     return;
   }
 
+  // Measure what's already built once, then add each new level as it's made
+  size_t current_bytes = 0;
+  animesh::MemoryReport top_report;
+  if (m_memory_budget > 0) {
+    current_bytes = memory_report().total();
+    top_report = ::memory_report(m_levels.back());
+  }
+
   for (unsigned int lvl_idx = 1; lvl_idx < num_levels; ++lvl_idx) {
+    if (m_memory_budget > 0) {
+      const auto next_level_bytes = estimate_next_level_bytes(top_report);
+      if (current_bytes + next_level_bytes > m_memory_budget) {
+        spdlog::warn("  Not generating level {}: needs ~{} MB on top of {} MB in use, budget is {} MB",
+                     m_levels.size(),
+                     next_level_bytes >> 20,
+                     current_bytes >> 20,
+                     m_memory_budget >> 20);
+        return;
+      }
+    }
     generate_new_level_additive();
+    if (m_memory_budget > 0) {
+      top_report = ::memory_report(m_levels.back());
+      current_bytes += top_report.total() + up_mapping_bytes(m_up_mapping.back().size());
+    }
   }
 }
 
+animesh::MemoryReport
+MultiResolutionSurfelGraph::memory_report() const {
+  using namespace animesh;
+
+  MemoryReport report;
+  for (const auto &level: m_levels) {
+    report.add(::memory_report(level));
+  }
+  for (const auto &mapping: m_up_mapping) {
+    report.add("up mapping", up_mapping_bytes(mapping.size()));
+  }
+  return report;
+}
+
+/*
+ * The next level has no more nodes or edges than the current coarsest one, but
+ * merged surfel IDs roughly double in length. Building it also needs the per-node
+ * maps and per-edge scores of generate_new_level_additive.
+ */
+size_t
+MultiResolutionSurfelGraph::estimate_next_level_bytes(const animesh::MemoryReport &top_report) const {
+  using namespace std;
+  using namespace animesh;
+
+  const auto &top = m_levels.back();
+  const auto num_nodes = top->num_nodes();
+  const auto num_edges = top->num_edges();
+  const auto it = top_report.bytes_by_category.find("surfel ids");
+  const auto id_bytes = (it == top_report.bytes_by_category.end()) ? 0 : it->second;
+
+  // New level and its up mapping
+  auto bytes = top_report.total() + id_bytes;
+  bytes += up_mapping_bytes(num_nodes);
+
+  // Working storage: dual areas and mean normals keyed by ID, fine to coarse mapping, edge scores
+  bytes += num_nodes * (tree_node_bytes<pair<const string, int>>()
+      + tree_node_bytes<pair<const string, Eigen::Vector3f>>()
+      + tree_node_bytes<pair<const SurfelGraphNodePtr, SurfelGraphNodePtr>>());
+  bytes += 2 * id_bytes;
+  bytes += num_edges * (tree_node_bytes<pair<const SurfelGraph::Edge, float>>() + sizeof(pair<SurfelGraph::Edge, float>));
+  return bytes;
+}
+
 /**
  * Compute the mean normal for the given node across
  * all frames in which it appears.
@@ -17,6 +17,19 @@ get_node_neighbours_in_frame(
   return neighbours_in_frame;
 }
 
+animesh::MemoryReport
+memory_report(const SurfelGraphPtr &surfel_graph) {
+  using namespace animesh;
+
+  return surfel_graph->memory_report([](const std::shared_ptr<Surfel> &surfel, MemoryReport &report) {
+    report.add("surfels", sizeof(Surfel));
+    report.add("shared_ptr control blocks", SHARED_PTR_CONTROL_BLOCK_BYTES);
+    report.add("frame data", surfel->frame_data().capacity() * sizeof(FrameData)
+        + surfel->frames().capacity() * sizeof(unsigned int));
+    report.add("surfel ids", string_heap_bytes(surfel->id()));
+  });
+}
+
 /**
  * @param surfel_graph The graph.
  * @return the number of frames spanned by this graph.
@@ -2,6 +2,8 @@
 #include <iostream>
 #endif
 
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <regex>
 #include <random>
@@ -9,6 +11,7 @@
 #include <memory>
 #include <DepthMap/DepthMap.h>
 #include <Geom/Geom.h>
+#include <Geom/SpatialIndex.h>
 #include <Properties/Properties.h>
 #include "Surfel_Compute.h"
 #include "PixelInFrame.h"
@@ -135,6 +138,151 @@ graph_from_surfels(std::vector<std::shared_ptr<Surfel>> &surfels, bool eight_con
     return graph;
 }
 
+/* A pair of surfel indices, lower index in the high word, so pairs sort by their first surfel */
+static inline uint64_t
+surfel_pair_key(uint32_t surfel1, uint32_t surfel2) {
+    return (surfel1 < surfel2)
+           ? ((uint64_t) surfel1 << 32 | surfel2)
+           : ((uint64_t) surfel2 << 32 | surfel1);
+}
+
+/**
+ * Find the pairs of surfels which are near one another in at least min_common_frames frames.
+ * Each frame is searched on its own thread through a spatial index over the positions of the
+ * surfels in that frame.
+ * @param surfels The surfels.
+ * @param radius Surfels are near in a frame when they are no further apart than this. If k is
+ * non-zero this only caps the distance and may be zero for no cap.
+ * @param k If non-zero, surfels are near in a frame when either is one of the k nearest to the other.
+ * @param min_common_frames The number of frames in which a pair must be near.
+ * @return The pairs as indices into surfels, lower index first, in ascending order.
+ */
+std::vector<std::pair<unsigned int, unsigned int>>
+find_proximate_surfels(const std::vector<std::shared_ptr<Surfel>> &surfels,
+                       float radius, unsigned int k, unsigned int min_common_frames) {
+    using namespace std;
+    using namespace Eigen;
+
+    if (k == 0 && radius <= 0.0f) {
+        throw invalid_argument("Surfel proximity needs a positive radius or a number of nearest neighbours");
+    }
+
+    // Gather the positions of each frame's surfels contiguously
+    unsigned int num_frames = 0;
+    for (const auto &surfel : surfels) {
+        for (const auto &fd : surfel->frame_data()) {
+            num_frames = max(num_frames, fd.pixel_in_frame.frame + 1);
+        }
+    }
+    vector<size_t> frame_offsets(num_frames + 1, 0);
+    for (const auto &surfel : surfels) {
+        for (const auto &fd : surfel->frame_data()) {
+            ++frame_offsets[fd.pixel_in_frame.frame + 1];
+        }
+    }
+    for (unsigned int frame = 0; frame < num_frames; ++frame) {
+        frame_offsets[frame + 1] += frame_offsets[frame];
+    }
+    Matrix3Xf positions(3, (Index) frame_offsets.back());
+    vector<uint32_t> surfel_at(frame_offsets.back());
+    {
+        auto next_slot = frame_offsets;
+        for (uint32_t surfel = 0; surfel < surfels.size(); ++surfel) {
+            for (const auto &fd : surfels[surfel]->frame_data()) {
+                const auto slot = next_slot[fd.pixel_in_frame.frame]++;
+                positions.col((Index) slot) = fd.position;
+                surfel_at[slot] = surfel;
+            }
+        }
+    }
+
+    // Find the pairs near in each frame, once each
+    vector<vector<uint64_t>> pairs_by_frame(num_frames);
+    animesh::spatial_index::for_each_index(num_frames, 0, [&](size_t frame) {
+        const auto offset = frame_offsets[frame];
+        const auto count = (Index) (frame_offsets[frame + 1] - offset);
+        const auto frame_positions = positions.middleCols((Index) offset, count);
+        auto &pairs = pairs_by_frame[frame];
+
+        if (k > 0) {
+            animesh::KdTree tree{frame_positions, 1};
+            MatrixXi nearest;
+            MatrixXf squared_distances;
+            // Each point finds itself too
+            tree.nearest_to_each_point(k + 1, nearest, squared_distances, 1);
+            for (Index i = 0; i < count; ++i) {
+                for (unsigned int j = 0; j <= k; ++j) {
+                    const auto n = nearest(j, i);
+                    if (n < 0 || n == i || (radius > 0.0f && squared_distances(j, i) > radius * radius)) {
+                        continue;
+                    }
+                    pairs.push_back(surfel_pair_key(surfel_at[offset + i], surfel_at[offset + n]));
+                }
+            }
+        } else {
+            animesh::VoxelHash voxels{frame_positions, radius};
+            voxels.for_each_pair_within_radius([&](int i, int j) {
+                pairs.push_back(surfel_pair_key(surfel_at[offset + i], surfel_at[offset + j]));
+            });
+        }
+        sort(pairs.begin(), pairs.end());
+        pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+    });
+
+    // Vote across frames. Pairs are split into bands of first surfel and each band counted
+    // separately, so bands are independent and come out in order.
+    const size_t num_bands = min<size_t>(max<size_t>(1, surfels.size()), 4 * (size_t) animesh::spatial_index::thread_count(0));
+    vector<vector<pair<unsigned int, unsigned int>>> pairs_by_band(num_bands);
+    animesh::spatial_index::for_each_index(num_bands, 0, [&](size_t band) {
+        const auto first_key = (uint64_t) (band * surfels.size() / num_bands) << 32;
+        const auto end_key = (uint64_t) ((band + 1) * surfels.size() / num_bands) << 32;
+        vector<uint64_t> keys;
+        for (const auto &pairs : pairs_by_frame) {
+            keys.insert(keys.end(),
+                        lower_bound(pairs.begin(), pairs.end(), first_key),
+                        lower_bound(pairs.begin(), pairs.end(), end_key));
+        }
+        sort(keys.begin(), keys.end());
+        for (size_t run_start = 0, run_end; run_start < keys.size(); run_start = run_end) {
+            for (run_end = run_start + 1; run_end < keys.size() && keys[run_end] == keys[run_start]; ++run_end);
+            if (run_end - run_start >= min_common_frames) {
+                pairs_by_band[band].emplace_back((unsigned int) (keys[run_start] >> 32),
+                                                 (unsigned int) (keys[run_start] & 0xffffffff));
+            }
+        }
+    });
+
+    vector<pair<unsigned int, unsigned int>> surfel_pairs;
+    for (const auto &band_pairs : pairs_by_band) {
+        surfel_pairs.insert(surfel_pairs.end(), band_pairs.begin(), band_pairs.end());
+    }
+    return surfel_pairs;
+}
+
+/**
+ * Build a graph of surfels connecting those which are near one another in at least
+ * min_common_frames frames. Unlike graph_from_surfels this needs no pixel grid.
+ * See find_proximate_surfels for the meaning of the parameters.
+ */
+SurfelGraphPtr
+graph_from_proximate_surfels(std::vector<std::shared_ptr<Surfel>> &surfels,
+                             float radius, unsigned int k, unsigned int min_common_frames) {
+    using namespace std;
+
+    auto graph = make_shared<SurfelGraph>();
+    vector<SurfelGraphNodePtr> nodes;
+    nodes.reserve(surfels.size());
+    for (const auto &surfel : surfels) {
+        nodes.push_back(graph->add_node(surfel));
+    }
+    const auto surfel_pairs = find_proximate_surfels(surfels, radius, k, min_common_frames);
+    for (const auto &surfel_pair : surfel_pairs) {
+        graph->add_edge(nodes[surfel_pair.first], nodes[surfel_pair.second], SurfelGraphEdge{1.0});
+    }
+    spdlog::info("Connected {:d} surfels with {:d} edges", surfels.size(), surfel_pairs.size());
+    return graph;
+}
+
 /**
  * For each entry in the correspondence group, we need to construct a 
  * FrameData object which tells us the frame and pixel affected as
@@ -150,8 +298,10 @@ populate_frame_data(const std::vector<PixelInFrame> &pifs_in_correspondence_grou
     Vector3f y_axis{0.0, 1.0, 0.0};
     vector<FrameData> frame_data;
     for (const auto &pif : pifs_in_correspondence_group) {
-        const auto &normal = depth_maps_by_frame.at(pif.frame).normal_at(pif.pixel.x, pif.pixel.y);
-        Vector3f target_normal{normal.x, normal.y, normal.z};
+        const auto &normals = depth_maps_by_frame.at(pif.frame).get_normals();
+        Vector3f target_normal{normals.nx(pif.pixel.x, pif.pixel.y),
+                               normals.ny(pif.pixel.x, pif.pixel.y),
+                               normals.nz(pif.pixel.x, pif.pixel.y)};
         auto depth = depth_maps_by_frame.at(pif.frame).depth_at(pif.pixel.x, pif.pixel.y);
         auto target_position = coordinates_by_pif.at(pif);
 
@@ -180,10 +330,11 @@ filter_pifs_with_normals(const std::vector<PixelInFrame> &corresponding_pifs,
     vector<PixelInFrame> pifs_with_normals;
     stringstream msg;
     for (const auto &pif : corresponding_pifs) {
-        if (depth_maps.at(pif.frame).is_normal_defined(pif.pixel.x, pif.pixel.y)) {
+        const auto &normals = depth_maps.at(pif.frame).get_normals();
+        if (normals.is_defined(pif.pixel.x, pif.pixel.y)) {
             pifs_with_normals.push_back(pif);
 
-            const auto &nn = depth_maps.at(pif.frame).normal_at(pif.pixel.x, pif.pixel.y);
+            const auto nn = normals(pif.pixel.x, pif.pixel.y);
             msg << pif << " --> Normal: {"
                 << nn.type << " " << nn.x << " " << nn.y << " " << nn.z << "}" << endl;
         } else {
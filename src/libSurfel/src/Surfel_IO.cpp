@@ -21,6 +21,62 @@
 
 static const unsigned short FLAGS_MARKER = 0xa9f1; // f1a9 = flag
 
+void
+write_surfel_file_header(std::ofstream &file, unsigned short flags, unsigned int num_surfels) {
+  write_unsigned_short(file, FLAGS_MARKER);
+  write_unsigned_short(file, flags);
+  write_unsigned_int(file, num_surfels);
+}
+
+/**
+ * Write a single surfel record. Records follow the surfel count at the start of the file.
+ */
+void
+write_surfel_to_file(std::ofstream &file,
+                     const Surfel &surfel,
+                     const std::vector<std::string> &neighbour_ids,
+                     bool save_smoothness) {
+  // ID
+  write_string(file, surfel.id());
+  // FrameData size
+  write_unsigned_int(file, surfel.frame_data().size());
+  for (auto const &fd : surfel.frame_data()) {
+    // PixelInFrame
+    write_size_t(file, fd.pixel_in_frame.pixel.x);
+    write_size_t(file, fd.pixel_in_frame.pixel.y);
+    write_size_t(file, fd.pixel_in_frame.frame);
+    write_float(file, fd.depth);
+
+    // Transform
+    write_float(file, fd.transform(0, 0));
+    write_float(file, fd.transform(0, 1));
+    write_float(file, fd.transform(0, 2));
+    write_float(file, fd.transform(1, 0));
+    write_float(file, fd.transform(1, 1));
+    write_float(file, fd.transform(1, 2));
+    write_float(file, fd.transform(2, 0));
+    write_float(file, fd.transform(2, 1));
+    write_float(file, fd.transform(2, 2));
+
+    // Normal
+    write_vector_3f(file, fd.normal);
+
+    // Position
+    write_vector_3f(file, fd.position);
+  }
+
+  write_unsigned_int(file, neighbour_ids.size());
+  for (const auto &neighbour_id : neighbour_ids) {
+    write_string(file, neighbour_id);
+  }
+  write_vector_3f(file, surfel.tangent());
+  write_vector_2f(file, surfel.reference_lattice_offset());
+  if (save_smoothness) {
+    write_float(file, surfel.rosy_smoothness());
+    write_float(file, surfel.posy_smoothness());
+  }
+}
+
 /**
  * Save surfel data as binary file to disk
  */
@@ -51,46 +107,11 @@ save_surfel_graph_to_file(const std::string &file_name,
   }
   write_unsigned_int(file, surfel_graph->num_nodes());
   for (auto const &surfel : surfel_graph->nodes()) {
-    // ID
-    write_string(file, surfel->data()->id());
-    // FrameData size
-    write_unsigned_int(file, surfel->data()->frame_data().size());
-    for (auto const &fd : surfel->data()->frame_data()) {
-      // PixelInFrame
-      write_size_t(file, fd.pixel_in_frame.pixel.x);
-      write_size_t(file, fd.pixel_in_frame.pixel.y);
-      write_size_t(file, fd.pixel_in_frame.frame);
-      write_float(file, fd.depth);
-
-      // Transform
-      write_float(file, fd.transform(0, 0));
-      write_float(file, fd.transform(0, 1));
-      write_float(file, fd.transform(0, 2));
-      write_float(file, fd.transform(1, 0));
-      write_float(file, fd.transform(1, 1));
-      write_float(file, fd.transform(1, 2));
-      write_float(file, fd.transform(2, 0));
-      write_float(file, fd.transform(2, 1));
-      write_float(file, fd.transform(2, 2));
-
-      // Normal
-      write_vector_3f(file, fd.normal);
-
-      // Position
-      write_vector_3f(file, fd.position);
-    }
-
-    const auto neighbours = surfel_graph->neighbours(surfel);
-    write_unsigned_int(file, neighbours.size());
-    for (const auto &surfel_ptr : neighbours) {
-      write_string(file, surfel_ptr->data()->id());
-    }
-    write_vector_3f(file, surfel->data()->tangent());
-    write_vector_2f(file, surfel->data()->reference_lattice_offset());
-    if (save_smoothness) {
-      write_float(file, surfel->data()->rosy_smoothness());
-      write_float(file, surfel->data()->posy_smoothness());
+    vector<string> neighbour_ids;
+    for (const auto &surfel_ptr : surfel_graph->neighbours(surfel)) {
+      neighbour_ids.emplace_back(surfel_ptr->data()->id());
     }
+    write_surfel_to_file(file, *(surfel->data()), neighbour_ids, save_smoothness);
   }
 
   if (save_edges) {
@@ -0,0 +1,306 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "SyntheticSurfelGraph.h"
+#include "SurfelBuilder.h"
+#include "Surfel_IO.h"
+
+#include <GeomFileUtils/io_utils.h>
+#include <Eigen/Geometry>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+
+namespace {
+  const float TWO_PI = 2.0f * (float) M_PI;
+
+  /* Step used for finite difference normals, in parameter space */
+  const float NORMAL_STEP = 1e-3f;
+
+  /* Key used to pick the frame in which a surfel is always visible */
+  const size_t ANCHOR_FRAME_KEY = std::numeric_limits<unsigned int>::max();
+
+  /* Key offset used to decide edge dropout */
+  const size_t EDGE_KEY = 0x9e3779b97f4a7c15ULL;
+
+  uint64_t
+  split_mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+}
+
+SyntheticSurface
+synthetic_surface_with_name(const std::string &name) {
+  const static std::map<std::string, SyntheticSurface> surfaces{
+      {"plane", SS_PLANE},
+      {"sphere", SS_SPHERE},
+      {"torus", SS_TORUS},
+      {"cloth", SS_CLOTH},
+  };
+  const auto it = surfaces.find(name);
+  if (it == surfaces.end()) {
+    throw std::runtime_error("Unknown synthetic surface " + name);
+  }
+  return it->second;
+}
+
+SyntheticSurfelGraphParameters::SyntheticSurfelGraphParameters() //
+    : surface{SS_PLANE} //
+    , width{100} //
+    , height{100} //
+    , num_frames{1} //
+    , scale{1.0f} //
+    , position_noise{0.0f} //
+    , normal_noise{0.0f} //
+    , dropout{0.0f} //
+    , edge_dropout{0.0f} //
+    , eight_connected{true} //
+    , seed{123} //
+{}
+
+SyntheticSurfelGraphGenerator::SyntheticSurfelGraphGenerator(const SyntheticSurfelGraphParameters &parameters) //
+    : m_parameters{parameters} //
+{
+  if (m_parameters.width < 2 || m_parameters.height < 2) {
+    throw std::runtime_error("Synthetic surfel graphs must be at least 2x2");
+  }
+  if (m_parameters.num_frames == 0) {
+    throw std::runtime_error("Synthetic surfel graphs must have at least one frame");
+  }
+  if (num_surfels() > std::numeric_limits<unsigned int>::max()) {
+    throw std::runtime_error("Too many surfels for the surfel graph file format");
+  }
+}
+
+std::string
+SyntheticSurfelGraphGenerator::surfel_id(size_t index) const {
+  return "s" + std::to_string(index);
+}
+
+float
+SyntheticSurfelGraphGenerator::hash_to_unit(size_t key1, size_t key2) const {
+  const auto h = split_mix(split_mix(split_mix(m_parameters.seed) ^ key1) ^ key2);
+  return (float) (h >> 40) / (float) (1 << 24);
+}
+
+/*
+ * A surfel is occluded in a frame with probability dropout, except in one
+ * anchor frame in which it is always visible.
+ */
+bool
+SyntheticSurfelGraphGenerator::is_visible(size_t index, unsigned int frame_idx) const {
+  if (m_parameters.dropout <= 0.0f) {
+    return true;
+  }
+  const auto anchor = (unsigned int) (hash_to_unit(index, ANCHOR_FRAME_KEY) * (float) m_parameters.num_frames);
+  if (frame_idx == std::min(anchor, m_parameters.num_frames - 1)) {
+    return true;
+  }
+  return hash_to_unit(index, frame_idx) >= m_parameters.dropout;
+}
+
+bool
+SyntheticSurfelGraphGenerator::has_edge(size_t index_a, size_t index_b) const {
+  if (m_parameters.edge_dropout > 0.0f) {
+    const auto lo = std::min(index_a, index_b);
+    const auto hi = std::max(index_a, index_b);
+    if (hash_to_unit(lo ^ EDGE_KEY, hi) < m_parameters.edge_dropout) {
+      return false;
+    }
+  }
+  for (unsigned int frame_idx = 0; frame_idx < m_parameters.num_frames; ++frame_idx) {
+    if (is_visible(index_a, frame_idx) && is_visible(index_b, frame_idx)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+SyntheticSurfelGraphGenerator::grid_parameters(size_t index, float &u, float &v) const {
+  const auto x = index % m_parameters.width;
+  const auto y = index / m_parameters.width;
+  // Periodic directions must not sample the seam twice.
+  u = (float) x / (float) (wraps_in_u() ? m_parameters.width : m_parameters.width - 1);
+  v = (float) y / (float) (wraps_in_v() ? m_parameters.height : m_parameters.height - 1);
+}
+
+Eigen::Vector3f
+SyntheticSurfelGraphGenerator::surface_point(float u, float v, float t) const {
+  using namespace std;
+
+  const auto s = m_parameters.scale;
+  switch (m_parameters.surface) {
+    case SS_PLANE: {
+      // Travelling wave across the plane
+      const auto y = 0.05f * s * sin(TWO_PI * (u + t));
+      return {s * (u - 0.5f), y, s * (v - 0.5f)};
+    }
+
+    case SS_CLOTH: {
+      // Sheet sagging between its edges with a ripple blowing across it
+      const auto sag = 0.2f * s * sin((float) M_PI * u) * sin((float) M_PI * v) * (1.0f + 0.5f * sin(TWO_PI * t));
+      const auto ripple = 0.03f * s * sin(TWO_PI * (2.0f * u + v + t));
+      return {s * (u - 0.5f), ripple - sag, s * (v - 0.5f)};
+    }
+
+    case SS_SPHERE: {
+      // Rotating sphere with lobes which breathe in and out. Poles are avoided.
+      const auto theta = TWO_PI * u + 0.5f * (float) M_PI * t;
+      const auto phi = (float) M_PI * (0.05f + 0.9f * v);
+      const auto r = s * (1.0f + 0.1f * sin(TWO_PI * t + 3.0f * phi));
+      return {r * sin(phi) * cos(theta), r * cos(phi), r * sin(phi) * sin(theta)};
+    }
+
+    case SS_TORUS: {
+      // Torus whose tube twists and swells over time
+      const auto theta = TWO_PI * u;
+      const auto psi = TWO_PI * v + 0.5f * (float) M_PI * t;
+      const auto r = 0.3f * s * (1.0f + 0.2f * sin(TWO_PI * t + 2.0f * theta));
+      const auto ring = s + r * cos(psi);
+      return {ring * cos(theta), r * sin(psi), ring * sin(theta)};
+    }
+  }
+  throw std::runtime_error("Unknown synthetic surface");
+}
+
+/*
+ * Normal by central differences, oriented away from the inside of closed
+ * surfaces and upwards for open ones.
+ */
+Eigen::Vector3f
+SyntheticSurfelGraphGenerator::surface_normal(float u, float v, float t) const {
+  using namespace Eigen;
+
+  const Vector3f du = surface_point(u + NORMAL_STEP, v, t) - surface_point(u - NORMAL_STEP, v, t);
+  const Vector3f dv = surface_point(u, v + NORMAL_STEP, t) - surface_point(u, v - NORMAL_STEP, t);
+  Vector3f normal = dv.cross(du).normalized();
+
+  Vector3f outward;
+  const auto p = surface_point(u, v, t);
+  switch (m_parameters.surface) {
+    case SS_SPHERE:outward = p;
+      break;
+    case SS_TORUS: {
+      const auto theta = TWO_PI * u;
+      outward = p - m_parameters.scale * Vector3f{std::cos(theta), 0.0f, std::sin(theta)};
+      break;
+    }
+    default:outward = Vector3f::UnitY();
+      break;
+  }
+  if (normal.dot(outward) < 0) {
+    normal = -normal;
+  }
+  return normal;
+}
+
+Surfel
+SyntheticSurfelGraphGenerator::surfel(size_t index) const {
+  using namespace std;
+  using namespace Eigen;
+
+  // Each surfel has its own stream of random numbers so that it is independent of generation order.
+  default_random_engine rng{(unsigned int) split_mix(split_mix(m_parameters.seed) ^ index)};
+  normal_distribution<float> position_noise{0.0f, max(m_parameters.position_noise, numeric_limits<float>::min())};
+  normal_distribution<float> normal_noise{0.0f, max(m_parameters.normal_noise, numeric_limits<float>::min())};
+
+  float u, v;
+  grid_parameters(index, u, v);
+  const auto x = (unsigned int) (index % m_parameters.width);
+  const auto y = (unsigned int) (index / m_parameters.width);
+  const Vector3f camera{0.0f, 0.0f, -4.0f * m_parameters.scale};
+
+  SurfelBuilder sb{rng};
+  sb.with_id(surfel_id(index));
+  for (unsigned int frame_idx = 0; frame_idx < m_parameters.num_frames; ++frame_idx) {
+    if (!is_visible(index, frame_idx)) {
+      continue;
+    }
+    const auto t = (float) frame_idx / (float) m_parameters.num_frames;
+    Vector3f position = surface_point(u, v, t);
+    Vector3f normal = surface_normal(u, v, t);
+    if (m_parameters.position_noise > 0.0f) {
+      position += Vector3f{position_noise(rng), position_noise(rng), position_noise(rng)};
+    }
+    if (m_parameters.normal_noise > 0.0f) {
+      normal = (normal + Vector3f{normal_noise(rng), normal_noise(rng), normal_noise(rng)}).normalized();
+    }
+    sb.with_frame({x, y, frame_idx}, (position - camera).norm(), normal, position);
+  }
+  return sb.build();
+}
+
+std::vector<size_t>
+SyntheticSurfelGraphGenerator::neighbours(size_t index) const {
+  using namespace std;
+
+  const int width = (int) m_parameters.width;
+  const int height = (int) m_parameters.height;
+  const int x = (int) (index % m_parameters.width);
+  const int y = (int) (index / m_parameters.width);
+
+  vector<size_t> neighbours;
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      if ((dx == 0 && dy == 0) || (!m_parameters.eight_connected && dx != 0 && dy != 0)) {
+        continue;
+      }
+      auto nx = x + dx;
+      auto ny = y + dy;
+      if (wraps_in_u()) {
+        nx = (nx + width) % width;
+      }
+      if (wraps_in_v()) {
+        ny = (ny + height) % height;
+      }
+      if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+        continue;
+      }
+      const auto neighbour = (size_t) ny * m_parameters.width + nx;
+      if (neighbour != index && has_edge(index, neighbour)) {
+        neighbours.push_back(neighbour);
+      }
+    }
+  }
+  // Small periodic grids can reach the same neighbour twice
+  sort(neighbours.begin(), neighbours.end());
+  neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+  return neighbours;
+}
+
+void
+SyntheticSurfelGraphGenerator::write(const std::string &file_name) const {
+  using namespace std;
+
+  spdlog::info("Writing {} synthetic surfels over {} frames to {}", num_surfels(), m_parameters.num_frames, file_name);
+  ofstream file{file_name, ios::out | ios::binary};
+  if (file.fail()) {
+    throw runtime_error("Error writing file " + file_name);
+  }
+
+  write_surfel_file_header(file, 0, (unsigned int) num_surfels());
+  vector<string> neighbour_ids;
+  for (size_t index = 0; index < num_surfels(); ++index) {
+    neighbour_ids.clear();
+    for (const auto neighbour: neighbours(index)) {
+      neighbour_ids.emplace_back(surfel_id(neighbour));
+    }
+    write_surfel_to_file(file, surfel(index), neighbour_ids);
+
+    if ((index + 1) % 1000000 == 0) {
+      spdlog::info("  written {} surfels", index + 1);
+    }
+  }
+  file.close();
+  spdlog::info(" done.");
+}
@@ -47,4 +47,23 @@ TEST_F(TestMultiResolutionGraph, generate_multi_levels_should_fail) {
   std::default_random_engine rng{123};
   MultiResolutionSurfelGraph g{m_surfel_graph, rng};
   g.generate_levels(2);
-}
\ No newline at end of file
+}
+TEST_F(TestMultiResolutionGraph, memory_report_counts_surfels) {
+  std::default_random_engine rng{123};
+  MultiResolutionSurfelGraph g{m_surfel_graph, rng};
+  const auto report = g.memory_report();
+  EXPECT_EQ(report.bytes_by_category.at("surfels"), 2 * sizeof(Surfel));
+  EXPECT_GE(report.bytes_by_category.at("frame data"), 6 * sizeof(FrameData));
+}
+
+TEST_F(TestMultiResolutionGraph, memory_budget_stops_level_generation) {
+  std::default_random_engine rng{123};
+  MultiResolutionSurfelGraph g{m_surfel_graph, rng};
+  g.set_memory_budget(g.memory_report().total() + 1);
+  g.generate_levels(2);
+  EXPECT_EQ(g.num_levels(), 1);
+
+  g.set_memory_budget(0);
+  g.generate_levels(2);
+  EXPECT_EQ(g.num_levels(), 2);
+}
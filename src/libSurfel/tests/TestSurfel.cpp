@@ -2,6 +2,7 @@
 #include <Surfel/Surfel.h>
 #include <Surfel/FrameData.h>
 #include <Surfel/Surfel_IO.h>
+#include <Surfel/Surfel_Compute.h>
 #include <Surfel/SurfelGraph.h>
 #include <Graph/Graph.h>
 #include <Eigen/Core>
@@ -221,8 +222,8 @@ expect_nodes_equal(const SurfelGraphNodePtr &node1,
 
 void
 expect_node_vectors_equal(
-    std::vector<const SurfelGraphNodePtr> &nodes1,
-    std::vector<const SurfelGraphNodePtr> &nodes2,
+    std::vector<SurfelGraphNodePtr> &nodes1,
+    std::vector<SurfelGraphNodePtr> &nodes2,
     bool exclude_smoothness = false
 ) {
   using namespace std;
@@ -250,8 +251,8 @@ expect_graphs_equal(const SurfelGraphPtr &graph1,
     expect_edges_equal(g1_edges, g2_edges);
   }
 
-  std::vector<const SurfelGraphNodePtr> g1_nodes = graph1->nodes();
-  std::vector<const SurfelGraphNodePtr> g2_nodes = graph2->nodes();
+  std::vector<SurfelGraphNodePtr> g1_nodes = graph1->nodes();
+  std::vector<SurfelGraphNodePtr> g2_nodes = graph2->nodes();
   expect_node_vectors_equal(g1_nodes, g2_nodes, exclude_smoothness);
 }
 
@@ -366,3 +367,52 @@ TEST_F(TestSurfelGraph, k_is_switched_based_on_node_order_when_accessed_indirect
   EXPECT_EQ(19, switched_ks.first);
   EXPECT_EQ(32, switched_ks.second);
 }
+
+/*
+ * Surfels 0 and 1 are 1 apart in every frame. Surfel 2 is 1.2 from surfel 0 in frame 0 only
+ * and surfel 3 is always far from the rest.
+ */
+std::vector<std::shared_ptr<Surfel>>
+make_proximity_surfels(SurfelBuilder *surfel_builder) {
+  using namespace std;
+  using namespace Eigen;
+
+  const vector<vector<Vector3f>> positions{
+      {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}},
+      {{1, 0, 0}, {1, 0, 0}, {1, 0, 0}},
+      {{0, 1.2f, 0}, {5, 0, 0}, {5, 0, 0}},
+      {{10, 0, 0}, {10, 0, 0}, {10, 0, 0}}
+  };
+  vector<shared_ptr<Surfel>> surfels;
+  for (unsigned int surfel = 0; surfel < positions.size(); ++surfel) {
+    surfel_builder->reset()->with_id("s" + to_string(surfel));
+    for (unsigned int frame = 0; frame < positions[surfel].size(); ++frame) {
+      surfel_builder->with_frame({surfel, 0, frame}, 1.0f, Vector3f{0, 1, 0}, positions[surfel][frame]);
+    }
+    surfels.push_back(make_shared<Surfel>(surfel_builder->build()));
+  }
+  return surfels;
+}
+
+TEST_F(TestSurfel, surfels_within_radius_in_enough_frames_are_proximate) {
+  using namespace std;
+
+  const auto surfels = make_proximity_surfels(m_surfel_builder);
+  using Pairs = vector<pair<unsigned int, unsigned int>>;
+  EXPECT_EQ((Pairs{{0, 1}}), find_proximate_surfels(surfels, 1.6f, 0, 2));
+  EXPECT_EQ((Pairs{{0, 1}, {0, 2}, {1, 2}}), find_proximate_surfels(surfels, 1.6f, 0, 1));
+}
+
+TEST_F(TestSurfel, nearest_surfels_in_enough_frames_are_proximate) {
+  using namespace std;
+
+  const auto surfels = make_proximity_surfels(m_surfel_builder);
+  using Pairs = vector<pair<unsigned int, unsigned int>>;
+  EXPECT_EQ((Pairs{{0, 1}}), find_proximate_surfels(surfels, 3.0f, 1, 2));
+  EXPECT_EQ((Pairs{{0, 1}, {0, 2}}), find_proximate_surfels(surfels, 3.0f, 1, 1));
+
+  auto mutable_surfels = surfels;
+  const auto graph = graph_from_proximate_surfels(mutable_surfels, 3.0f, 1, 2);
+  EXPECT_EQ(4, graph->num_nodes());
+  EXPECT_EQ(1, graph->num_edges());
+}
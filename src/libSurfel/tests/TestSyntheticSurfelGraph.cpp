@@ -0,0 +1,132 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#include "TestSyntheticSurfelGraph.h"
+#include <Surfel/Surfel_IO.h>
+#include <GeomFileUtils/io_utils.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+
+void TestSyntheticSurfelGraph::SetUp() {
+  m_parameters.width = 10;
+  m_parameters.height = 10;
+  m_parameters.num_frames = 1;
+}
+
+void TestSyntheticSurfelGraph::TearDown() {}
+
+TEST_F(TestSyntheticSurfelGraph, UnknownSurfaceShouldThrow) {
+  EXPECT_THROW(synthetic_surface_with_name("teapot"), std::runtime_error);
+}
+
+TEST_F(TestSyntheticSurfelGraph, PlaneHasGridEdges) {
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+
+  size_t total_degree = 0;
+  for (size_t i = 0; i < generator.num_surfels(); ++i) {
+    total_degree += generator.neighbours(i).size();
+  }
+  // 2 * 10 * 9 horizontal and vertical plus 2 * 9 * 9 diagonal, each seen from both ends
+  EXPECT_EQ(total_degree, 2 * (180 + 162));
+}
+
+TEST_F(TestSyntheticSurfelGraph, TorusWrapsInBothDirections) {
+  m_parameters.surface = SS_TORUS;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+
+  for (size_t i = 0; i < generator.num_surfels(); ++i) {
+    EXPECT_EQ(generator.neighbours(i).size(), 8);
+  }
+}
+
+TEST_F(TestSyntheticSurfelGraph, NormalsAreUnitLength) {
+  m_parameters.surface = SS_SPHERE;
+  m_parameters.num_frames = 3;
+  m_parameters.normal_noise = 0.1f;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+
+  for (size_t i = 0; i < generator.num_surfels(); ++i) {
+    const auto surfel = generator.surfel(i);
+    for (const auto &fd: surfel.frame_data()) {
+      EXPECT_NEAR(fd.normal.norm(), 1.0f, 1e-5);
+    }
+  }
+}
+
+TEST_F(TestSyntheticSurfelGraph, DroppedOutSurfelsAppearInSomeFrame) {
+  m_parameters.surface = SS_CLOTH;
+  m_parameters.num_frames = 5;
+  m_parameters.dropout = 0.9f;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+
+  for (size_t i = 0; i < generator.num_surfels(); ++i) {
+    const auto surfel = generator.surfel(i);
+    EXPECT_GE(surfel.frames().size(), 1);
+    EXPECT_LT(surfel.frames().size(), 5);
+
+    // Neighbours must be visible together in at least one frame
+    const std::set<unsigned int> frames{surfel.frames().begin(), surfel.frames().end()};
+    for (const auto n: generator.neighbours(i)) {
+      const auto neighbour = generator.surfel(n);
+      bool shared = false;
+      for (const auto f: neighbour.frames()) {
+        shared |= (frames.count(f) > 0);
+      }
+      EXPECT_TRUE(shared);
+    }
+  }
+}
+
+TEST_F(TestSyntheticSurfelGraph, SurfelsAreIndependentOfGenerationOrder) {
+  m_parameters.position_noise = 0.01f;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+
+  const auto late = generator.surfel(57);
+  generator.surfel(3);
+  const auto again = generator.surfel(57);
+  EXPECT_EQ(late.tangent(), again.tangent());
+  EXPECT_EQ(late.frame_data()[0].position, again.frame_data()[0].position);
+}
+
+TEST_F(TestSyntheticSurfelGraph, WrittenGraphLoads) {
+  m_parameters.num_frames = 3;
+  m_parameters.edge_dropout = 0.25f;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+  generator.write("synthetic_graph.bin");
+
+  std::default_random_engine rng{123};
+  auto graph = load_surfel_graph_from_file("synthetic_graph.bin", rng);
+  std::remove("synthetic_graph.bin");
+
+  size_t total_degree = 0;
+  for (size_t i = 0; i < generator.num_surfels(); ++i) {
+    total_degree += generator.neighbours(i).size();
+  }
+  EXPECT_EQ(graph->num_nodes(), 100);
+  EXPECT_EQ(graph->num_edges(), total_degree / 2);
+  for (const auto &node: graph->nodes()) {
+    EXPECT_EQ(node->data()->frames().size(), 3);
+  }
+}
+
+TEST_F(TestSyntheticSurfelGraph, WrittenGraphStartsWithFlagsMarker) {
+  // Without the marker a count whose low 16 bits match it would be read as flags
+  m_parameters.width = 2;
+  m_parameters.height = 3;
+  SyntheticSurfelGraphGenerator generator{m_parameters};
+  generator.write("synthetic_graph_marker.bin");
+
+  std::ifstream file{"synthetic_graph_marker.bin", std::ios::in | std::ios::binary};
+  const auto marker = read_unsigned_short(file);
+  const auto flags = read_unsigned_short(file);
+  const auto num_surfels = read_unsigned_int(file);
+  file.close();
+  std::remove("synthetic_graph_marker.bin");
+
+  EXPECT_EQ(marker, 0xa9f1);
+  EXPECT_EQ(flags, 0);
+  EXPECT_EQ(num_surfels, 6);
+}
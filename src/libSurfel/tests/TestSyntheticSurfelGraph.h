@@ -0,0 +1,16 @@
+//
+// Created by Dave Durbin on 18/10/2026.
+//
+
+#pragma once
+#include <gtest/gtest.h>
+#include <Surfel/SyntheticSurfelGraph.h>
+
+class TestSyntheticSurfelGraph : public ::testing::Test {
+public:
+  void SetUp( );
+  void TearDown();
+
+protected:
+  SyntheticSurfelGraphParameters m_parameters;
+};
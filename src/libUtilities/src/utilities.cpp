@@ -6,6 +6,7 @@
 #include <iostream>
 #include <DepthMap/DepthMap.h>
 #include <DepthMap/DepthMapIO.h>
+#include <DepthMap/DepthPyramid.h>
 #include <Properties/Properties.h>
 #include <Camera/Camera.h>
 
@@ -105,6 +106,8 @@ tNormalMethod normal_computation_method(const Properties &properties) {
     method = CROSS;
   } else if (normal_method_name == "planar") {
     method = PLANAR;
+  } else if (normal_method_name == "integral") {
+    method = INTEGRAL;
   } else {
     throw std::runtime_error("Unrecognised normal computation method [" + normal_method_name + "]");
   }
@@ -145,28 +148,31 @@ create_depth_map_hierarchy(const Properties &properties,
 
   int num_levels = properties.getIntProperty("num-levels");
   cout << "Constructing depth map hierarchy with " << num_levels << " levels." << endl;
-
-  vector<vector<DepthMap>> depth_map_hierarchy;
-  depth_map_hierarchy.reserve(num_levels);
-  depth_map_hierarchy.push_back(depth_maps);
-  cout << "1 of " << num_levels << "    " << flush;
-  for (int i = 1; i < num_levels; i++) {
-    cout << "\r" << (i + 1) << " of " << num_levels << "    " << flush;
-    depth_map_hierarchy.push_back(resample_depth_maps(depth_map_hierarchy.at(i - 1)));
-  }
-  cout << endl;
+  vector<DepthPyramid> pyramids = build_depth_pyramids(depth_maps, num_levels);
 
   tNormalMethod method = normal_computation_method(properties);
+  const int window_radius = properties.hasProperty("normal-window-radius")
+                            ? properties.getIntProperty("normal-window-radius")
+                            : 1;
+  if (window_radius < 1) {
+    throw std::runtime_error("normal-window-radius must be at least 1 but is " + to_string(window_radius));
+  }
 
   //
-  // Compute normals for each level
-  for (auto &level_depth_maps: depth_map_hierarchy) {
-    cout << "1 of " << depth_maps.size() << "    " << flush;
-    for (int f = 0; f < depth_maps.size(); ++f) {
-      cout << "\r" << (f + 1) << " of " << depth_maps.size() << "    " << flush;
-      Camera camera = cameras.at(f);
-      camera.set_image_size(level_depth_maps.at(0).width(), level_depth_maps.at(0).height());
-      level_depth_maps.at(f).compute_normals(camera, method);
+  // Compute normals for each level of each frame
+  cout << "1 of " << depth_maps.size() << "    " << flush;
+  for (int f = 0; f < depth_maps.size(); ++f) {
+    cout << "\r" << (f + 1) << " of " << depth_maps.size() << "    " << flush;
+    pyramids.at(f).compute_normals(cameras.at(f), method, (unsigned int) window_radius);
+  }
+  cout << endl;
+
+  // Levels share their pyramid's storage so moving them out copies no depths
+  vector<vector<DepthMap>> depth_map_hierarchy(num_levels);
+  for (int level = 0; level < num_levels; ++level) {
+    depth_map_hierarchy.at(level).reserve(depth_maps.size());
+    for (auto &pyramid: pyramids) {
+      depth_map_hierarchy.at(level).push_back(std::move(pyramid.level(level)));
     }
   }
 
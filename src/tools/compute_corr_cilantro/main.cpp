@@ -12,6 +12,7 @@
 
 #include <Surfel/PixelInFrame.h>
 #include <Correspondence/CorrespondenceIO.h>
+#include <Geom/SpatialIndex.h>
 #include <Utilities/utilities.h>
 #include <Tools/tools.h>
 #include <spdlog/spdlog.h>
@@ -113,6 +114,17 @@ compute_correspondences(const cilantro::PointCloud3f &from_point_cloud,
 
   auto residuals = icp.getResiduals();
 
+  // Match each warped source point to the nearest target point in range
+  const auto warped = from_point_cloud.transformed(tf_est);
+  animesh::KdTree target_tree{to_point_cloud.points};
+  Eigen::MatrixXi nearest;
+  Eigen::MatrixXf squared_distances;
+  target_tree.nearest_batch(warped.points, 1, nearest, squared_distances);
+  for (unsigned int i = 0; i < nearest.cols(); ++i) {
+    if (nearest(0, i) >= 0 && squared_distances(0, i) <= max_correspondence_dist_sq) {
+      correspondence[i] = (unsigned int) nearest(0, i);
+    }
+  }
 }
 
 int main(int argc, const char *argv[]) {
@@ -126,110 +138,17 @@ int main(int argc, const char *argv[]) {
   string pcloud_regex = properties.getProperty("corr-pc-regex");
   auto pointclouds = load_pcls(pcloud_directory, pcloud_regex);
 
-  struct frame_index {
-    unsigned int frame;
-    unsigned int idx;
-    bool operator<(const frame_index &other) const {
-      if (frame < other.frame) return true;
-      if (frame > other.frame) return false;
-      if (idx < other.idx) return true;
-      return false;
-    }
-    frame_index(unsigned int f, unsigned int i) {
-      frame = f;
-      idx = i;
-    }
-  };
-
-  // Paths are vectors of (frame,index) pairs
-  vector<vector<frame_index>> paths;
-
-  // This maps from the item at the tail of the path into the paths vector
-  map<frame_index, unsigned int> path_tail_item_to_path;
-
-  // Create a new path starting at each point in the first frame
-  for (unsigned int i = 0; i < pointclouds.at(0).points.rows(); ++i) {
-    vector<frame_index> path;
-    frame_index fi{0, i};
-    path.push_back(fi);
-    paths.push_back(path);
-    path_tail_item_to_path.emplace(fi, i);
-  }
-
-  vector<map<unsigned int, unsigned int>> corr;
-  for (unsigned int i = 1; i < pointclouds.size(); ++i) {
-    unsigned int from_frame = i - 1;
-    unsigned int to_frame = i;
+  // Chain the correspondences between each pair of frames into paths
+  PathBuilder path_builder{(unsigned int) pointclouds.at(0).size()};
+  for (unsigned int to_frame = 1; to_frame < pointclouds.size(); ++to_frame) {
+    unsigned int from_frame = to_frame - 1;
     spdlog::info("Computing correspondences {} to {}", from_frame, to_frame);
 
-    // Mark all 'to_frame' points as unconsumed
-    unsigned int num_target_rows = pointclouds.at(to_frame).points.rows();
-    bool is_consumed[num_target_rows];
-    for (auto &b: is_consumed) {
-      b = false;
-    }
-
-    // Compute correspondences
-    corr.emplace_back();
-    compute_correspondences(pointclouds[from_frame], pointclouds[to_frame], corr.back());
-
-    // For each correspondence
-    int ii=0;
-    for (const auto &entry: corr.back()) {
-      unsigned int from_point_idx = entry.first;
-      unsigned int to_point_idx = entry.second;
-      spdlog::info("{}: {}, {}, {}, {}, {}, {} % {}",ii,
-                   pointclouds[from_frame].points(from_point_idx, 0),
-                   pointclouds[from_frame].points(from_point_idx, 1),
-                   pointclouds[from_frame].points(from_point_idx, 2),
-                   pointclouds[to_frame].points(to_point_idx, 0),
-                   pointclouds[to_frame].points(to_point_idx, 1),
-                   pointclouds[to_frame].points(to_point_idx, 2),
-                   (entry.first == entry.second) ? "" : "x"
-      );
-      ii++;
-      // Some other path includes this point already. Skip it.
-      if (is_consumed[to_point_idx]) {
-        continue;
-      }
-
-      // Get the path that contains the from_point_idx
-      const frame_index from_key{from_frame, from_point_idx};
-      auto path_index = path_tail_item_to_path.at(from_key);
-
-      const frame_index to_key{to_frame, to_point_idx};
-      paths.at(path_index).push_back(to_key);
-      path_tail_item_to_path.emplace(to_key, path_index);
-      is_consumed[to_point_idx] = true;
-    }
-
-    // Now add any unconsumed points as the start of a new path
-    for (unsigned int ti = 0; ti < num_target_rows; ++ti) {
-      if (is_consumed[ti]) {
-        continue;
-      }
-
-      const frame_index to_key{to_frame, ti};
-      vector<frame_index> new_path;
-      new_path.push_back(to_key);
-      paths.push_back(new_path);
-      path_tail_item_to_path.emplace(to_key, paths.size() - 1);
-    }
+    map<unsigned int, unsigned int> corr;
+    compute_correspondences(pointclouds[from_frame], pointclouds[to_frame], corr);
+    spdlog::info("  {} of {} points matched", corr.size(), pointclouds.at(from_frame).size());
+    path_builder.add_frame((unsigned int) pointclouds.at(to_frame).size(), corr);
   }
 
-  const auto output_paths = pcloud_directory + "/paths.txt";
-  ofstream fout{output_paths};
-  for (const auto &path: paths) {
-    if (path.size() == 1) {
-      continue;
-    }
-    for (int i = 0; i < path.size(); ++i) {
-      fout << "(" << path.at(i).frame << " " << path.at(i).idx << ")";
-      if (i < path.size() - 1) {
-        fout << ",";
-      }
-    }
-    fout << endl;
-  }
-  fout.close();
-}
\ No newline at end of file
+  save_paths_to_file(pcloud_directory + "/paths.bin", path_builder.paths());
+}
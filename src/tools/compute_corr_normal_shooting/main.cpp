@@ -0,0 +1,120 @@
+//
+// Created by Dave Durbin on 7/3/2022.
+//
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <Correspondence/CorrespondenceIO.h>
+#include <Geom/SpatialIndex.h>
+#include <Properties/Properties.h>
+#include <Tools/tools.h>
+
+/* Number of nearest target points tested for each source point */
+const unsigned int NORMAL_SHOOTING_CANDIDATES = 10;
+
+/**
+ * Compute correspondences between two point clouds by normal shooting: of the target points
+ * nearest each source point, match the one closest to the line along the source normal.
+ * The target's search tree is prebuilt and shared.
+ * @return For each source point, the index of the target point matched to it or -1.
+ */
+std::vector<int>
+compute_correspondences(const std::vector<Eigen::Vector3f> &source,
+                        const std::vector<Eigen::Vector3f> &source_normals,
+                        const std::vector<Eigen::Vector3f> &target,
+                        const animesh::KdTree &target_tree) {
+  using namespace std;
+  using namespace Eigen;
+
+  MatrixXi candidates;
+  MatrixXf squared_distances;
+  target_tree.nearest_batch(animesh::as_point_matrix(source), NORMAL_SHOOTING_CANDIDATES,
+                            candidates, squared_distances, 1);
+
+  vector<int> target_for_source(source.size(), -1);
+  for (size_t i = 0; i < source.size(); ++i) {
+    auto best_distance = numeric_limits<float>::infinity();
+    for (unsigned int c = 0; c < NORMAL_SHOOTING_CANDIDATES && candidates(c, i) >= 0; ++c) {
+      const auto offset = target[candidates(c, i)] - source[i];
+      const auto distance_from_normal = source_normals[i].cross(offset).squaredNorm();
+      if (distance_from_normal < best_distance) {
+        best_distance = distance_from_normal;
+        target_for_source[i] = candidates(c, i);
+      }
+    }
+  }
+  return target_for_source;
+}
+
+int main(int argc, const char *argv[]) {
+  using namespace std;
+
+  string property_file_name = (argc == 2) ? argv[1] : "animesh.properties";
+  Properties properties{property_file_name};
+
+  // Load point clouds
+  string pcloud_directory = properties.getProperty("corr-pc-directory");
+
+  string pcloud_regex = properties.getProperty("corr-pc-regex");
+  const auto pointclouds = load_vec3s_from_directory(pcloud_directory, pcloud_regex);
+
+  string normal_regex = properties.getProperty("corr-norm-regex");
+  const auto normals = load_vec3s_from_directory(pcloud_directory, normal_regex);
+
+  const auto num_frames = (unsigned int) pointclouds.size();
+  if (num_frames == 0) {
+    throw runtime_error("No point clouds found in " + pcloud_directory);
+  }
+
+  if (normals.size() != num_frames) {
+    throw runtime_error("Found " + to_string(num_frames) + " point clouds but " + to_string(normals.size()) + " normal files");
+  }
+
+  // Frames are keyed by the number in their file names; the threads below index them by
+  // position so every position must be present.
+  for (unsigned int frame = 0; frame < num_frames; ++frame) {
+    if (pointclouds.count(frame) == 0 || normals.count(frame) == 0) {
+      throw runtime_error("Point clouds and normals must be numbered 0 to " + to_string(num_frames - 1)
+                              + " but frame " + to_string(frame) + " is missing");
+    }
+    if (normals.at(frame).size() != pointclouds.at(frame).size()) {
+      throw runtime_error("Frame " + to_string(frame) + " has " + to_string(pointclouds.at(frame).size())
+                              + " points but " + to_string(normals.at(frame).size()) + " normals");
+    }
+  }
+
+  // Build each frame's search tree once, straight over the loaded points. Frame i is the
+  // target of pair (i-1, i) and the source of pair (i, i+1).
+  vector<unique_ptr<animesh::KdTree>> trees(num_frames);
+  animesh::spatial_index::for_each_index(num_frames, 0, [&](size_t frame) {
+    trees[frame].reset(new animesh::KdTree{animesh::as_point_matrix(pointclouds.at(frame)), 1});
+  });
+
+  // Match every consecutive pair of frames concurrently
+  spdlog::info("Computing correspondences for {} frame pairs", num_frames - 1);
+  vector<vector<int>> corr(num_frames - 1);
+  animesh::spatial_index::for_each_index(num_frames - 1, 0, [&](size_t from_frame) {
+    corr[from_frame] = compute_correspondences(pointclouds.at(from_frame), normals.at(from_frame),
+                                               pointclouds.at(from_frame + 1), *trees[from_frame + 1]);
+  });
+
+  // Stitch the matches into paths
+  PathBuilder path_builder{(unsigned int) pointclouds.at(0).size()};
+  for (unsigned int to_frame = 1; to_frame < num_frames; ++to_frame) {
+    const unsigned int from_frame = to_frame - 1;
+    const auto &matches = corr[from_frame];
+    const auto num_matched = count_if(matches.begin(), matches.end(), [](int m) { return m >= 0; });
+    spdlog::info("Frames {} to {}: {} of {} points matched", from_frame, to_frame, num_matched, matches.size());
+    path_builder.add_frame((unsigned int) pointclouds.at(to_frame).size(), matches);
+  }
+  const auto paths = path_builder.paths();
+  spdlog::info("Found {} paths", paths.size());
+
+  save_paths_to_file(pcloud_directory + "/paths.bin", paths);
+}
@@ -0,0 +1,71 @@
+/**
+* Convert text depth maps to the binary depth map format, which loads
+* without parsing. Each input file x.ext is written alongside it as x.dmb
+* unless an output directory is given.
+*/
+#include <DepthMap/BinaryDepthMap.h>
+#include <FileUtils/FileUtils.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+void usage(const char *name) {
+    std::cerr << "Usage: " << name << " [-t float32|uint16] [-s scale] [-o output_directory] depth_file..." << std::endl
+              << "  uint16 stores round(depth / scale), e.g. -t uint16 -s 0.001 for millimetres" << std::endl;
+}
+
+int main(int argc, char *const argv[]) {
+    BinaryDepthType type = BDT_FLOAT32;
+    float scale = 1.0f;
+    std::string output_directory;
+    int ch;
+    const char *opts = "t:s:o:";
+    try {
+        while ((ch = getopt(argc, argv, opts)) != -1) {
+            switch (ch) {
+                case 't':
+                    if (std::string{optarg} == "float32") {
+                        type = BDT_FLOAT32;
+                    } else if (std::string{optarg} == "uint16") {
+                        type = BDT_UINT16;
+                    } else {
+                        throw std::runtime_error("Unknown sample type " + std::string{optarg});
+                    }
+                    break;
+                case 's':
+                    scale = std::stof(optarg);
+                    break;
+                case 'o':
+                    output_directory = optarg;
+                    break;
+                default:
+                    usage(argv[0]);
+                    return 1;
+            }
+        }
+        if (optind == argc) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        for (int i = optind; i < argc; ++i) {
+            const std::string input_file{argv[i]};
+            const auto name_and_extension = get_file_name_and_extension(input_file);
+            std::string output_file;
+            if (!output_directory.empty()) {
+                output_file = file_in_directory(output_directory, name_and_extension.first + ".dmb");
+            } else {
+                const auto extension_length = name_and_extension.second.empty() ? 0 : name_and_extension.second.size() + 1;
+                output_file = input_file.substr(0, input_file.size() - extension_length) + ".dmb";
+            }
+            DepthMap depth_map{input_file};
+            save_binary_depth_map(output_file, depth_map, type, scale);
+            spdlog::info("{} -> {}", input_file, output_file);
+        }
+    } catch (const std::exception &e) {
+        spdlog::error("{}", e.what());
+        return 1;
+    }
+    return 0;
+}
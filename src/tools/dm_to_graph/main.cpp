@@ -3,28 +3,41 @@
 //
 
 #include <CommonUtilities/split.h>
+#include <Correspondence/CorrespondenceIO.h>
+#include <Geom/SpatialIndex.h>
+#include <Geom/Statistics.h>
 #include <FileUtils/FileUtils.h>
+#include <FileUtils/FrameLoader.h>
+#include <FileUtils/TextFileParser.h>
 #include <Properties/Properties.h>
 #include <Surfel/PixelInFrame.h>
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
 #include <regex>
 #include <Surfel/SurfelGraph.h>
 #include <Surfel/SurfelBuilder.h>
+#include <Surfel/Surfel_Compute.h>
 #include <Surfel/Surfel_IO.h>
 #include <Tools/tools.h>
 
-// frame/idx
-std::vector<std::vector<std::pair<unsigned int, unsigned int>>> load_paths(const std::string &filename) {
+/**
+ * Load paths of frame/idx entries, either from a binary paths file or from the older text format
+ * of one path per line written as (frame idx),(frame idx),...
+ */
+Paths load_paths(const std::string &filename) {
   using namespace std;
 
+  if (is_binary_paths_file(filename)) {
+    return load_paths_from_file(filename);
+  }
 
-  vector<vector<pair<unsigned int, unsigned int>>> paths;
-
+  Paths paths;
   process_file_by_lines(filename, [&paths](const std::string &line) {
     using namespace std;
 
-    vector<pair<unsigned int, unsigned int>> path;
-
     vector<string> path_entries = split(line, ',');
     string rs = R"(\w*\(([0-9]*) ([0-9]*)\)\w*)";
     regex entry_r{rs};
@@ -37,11 +50,11 @@ std::vector<std::vector<std::pair<unsigned int, unsigned int>>> load_paths(const
       }
 
       // 0 is the whole string, 1 is fr, 2 is idx
-      unsigned int frameIdx = stoi(matches[1].str());
-      unsigned int idx = stoi(matches[2].str());
-      path.emplace_back(frameIdx, idx);
+      uint32_t frameIdx = stoi(matches[1].str());
+      uint32_t idx = stoi(matches[2].str());
+      paths.entries.push_back({frameIdx, idx});
     }
-    paths.push_back(path);
+    paths.offsets.push_back((uint32_t) paths.entries.size());
   });
   return paths;
 }
@@ -64,163 +77,176 @@ file_name_from_template_and_level(const std::string &file_name_template, unsigne
   return file_name;
 }
 
-void
-cull_unreasonable_neighbours(
-    const SurfelGraphNodePtr &node,
-    std::vector<SurfelGraphNodePtr> &potential_neighbour_nodes) {
-
-  auto &this_surfel = node->data();
-
-  bool should_log = (potential_neighbour_nodes.size() >= 8);
-
-  if (should_log) {
-    spdlog::info(
-        "Found a point with {} potential neighbours. Checking for culling of outliers.",
-        potential_neighbour_nodes.size());
-  }
-
-  std::set<SurfelGraphNodePtr> cullable_neighbours;
-  for (const auto &neighbour: potential_neighbour_nodes) {
-    auto &that_surfel = neighbour->data();
-    int this_surfel_frame_idx = 0;
-    int that_surfel_frame_idx = 0;
-    std::vector<std::pair<int, float>> frame_to_dist;
-
-    while ((this_surfel_frame_idx < this_surfel->num_frames()) &&
-        (that_surfel_frame_idx < that_surfel->num_frames())) {
-      auto this_surfel_frame = this_surfel->frames()[this_surfel_frame_idx];
-      auto that_surfel_frame = that_surfel->frames()[that_surfel_frame_idx];
-      if (this_surfel_frame < that_surfel_frame) {
-        ++this_surfel_frame_idx;
-        continue;
+/**
+ * The frames and positions of every surfel, stored as flat arrays so that comparing two
+ * surfels reads a few contiguous runs rather than chasing their frame data.
+ */
+class SurfelTracks {
+public:
+  explicit SurfelTracks(const std::vector<SurfelGraphNodePtr> &surfel_nodes) {
+    m_offsets.reserve(surfel_nodes.size() + 1);
+    m_offsets.push_back(0);
+    for (const auto &node: surfel_nodes) {
+      const auto &frame_data = node->data()->frame_data();
+      const auto first = m_frames.size();
+      for (const auto &fd: frame_data) {
+        m_frames.push_back(fd.pixel_in_frame.frame);
       }
-      if (this_surfel_frame > that_surfel_frame) {
-        ++that_surfel_frame_idx;
-        continue;
+      // Frame data is normally in frame order already
+      std::vector<uint32_t> order(frame_data.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return m_frames[first + a] < m_frames[first + b];
+      });
+      for (size_t i = 0; i < order.size(); ++i) {
+        const auto &position = frame_data[order[i]].position;
+        m_frames[first + i] = frame_data[order[i]].pixel_in_frame.frame;
+        m_x.push_back(position.x());
+        m_y.push_back(position.y());
+        m_z.push_back(position.z());
       }
-      // Surfels coexist in this frame
-      float delta = (this_surfel->frame_data()[this_surfel_frame_idx].position
-          - that_surfel->frame_data()[this_surfel_frame_idx].position).norm();
-      frame_to_dist.emplace_back(this_surfel_frame, delta);
-      ++this_surfel_frame_idx;
-      ++that_surfel_frame_idx;
+      m_offsets.push_back((uint32_t) m_frames.size());
     }
+  }
 
-    // OK we have a bunch of frames and associated distances
-    if (frame_to_dist.size() == 1) {
-      if (should_log) {
-        // Only neighbours in one frame - not really trustworthy.
-        spdlog::info("Point is only a neighbour on the basis of a single frame. Culling.");
-      }
-      cullable_neighbours.emplace(neighbour);
-      continue;
-    } else {
-      if (should_log) {
-        spdlog::info(
-            "Neighbour is apparently present in {} frames.",
-            frame_to_dist.size());
-      }
-    }
-
-
-    // Sort frame_to_dist by dist.
-    std::sort(frame_to_dist.begin(),
-              frame_to_dist.end(),
-              [](const std::pair<int, float> &p1, const std::pair<int, float> &p2) {
-                return p1.second < p2.second;
-              });
-
-    // These values...
-    if (should_log) {
-      for (const auto &x: frame_to_dist) {
-        spdlog::info(" [{}, {}] ", x.first, x.second);
+  /**
+   * Merge the frame lists of two surfels and append their distance apart in each frame they share.
+   */
+  void distances_in_common_frames(uint32_t surfel1, uint32_t surfel2, std::vector<float> &distances) const {
+    auto i = m_offsets[surfel1];
+    auto j = m_offsets[surfel2];
+    const auto end1 = m_offsets[surfel1 + 1];
+    const auto end2 = m_offsets[surfel2 + 1];
+    while (i < end1 && j < end2) {
+      if (m_frames[i] < m_frames[j]) {
+        ++i;
+      } else if (m_frames[j] < m_frames[i]) {
+        ++j;
+      } else {
+        const auto dx = m_x[i] - m_x[j];
+        const auto dy = m_y[i] - m_y[j];
+        const auto dz = m_z[i] - m_z[j];
+        distances.push_back(std::sqrt(dx * dx + dy * dy + dz * dz));
+        ++i;
+        ++j;
       }
     }
+  }
 
-    // Compute q1 and q3
-    float q1, q2, q3;
-    size_t q2_index = frame_to_dist.size() / 2;
-    size_t q1_index = q2_index / 2;
-    size_t q3_index = q2_index + q1_index + ((frame_to_dist.size() % 2 == 1) ? 1 : 0);
-
-    if (frame_to_dist.size() % 2 == 1) {
-      q2 = frame_to_dist[q2_index].second;
-    } else {
-      q2 = (frame_to_dist[q2_index].second + frame_to_dist[q2_index - 1].second) / 2.0f;
-    }
-    if (q2_index % 2 == 1) {
-      q1 = frame_to_dist[q1_index].second;
-      q3 = frame_to_dist[q3_index].second;
-    } else {
-      q1 = (frame_to_dist[q1_index].second + frame_to_dist[q1_index - 1].second) / 2.0f;
-      q3 = (frame_to_dist[q3_index].second + frame_to_dist[q3_index - 1].second) / 2.0f;
-    }
-
-    // Compute IQR
-    auto iqr = q3 - q1;
-    // Max value is q3.dist + 1.5 * IQR
-    auto max_dist = q3 + (1.0f * iqr);
-    // Anything greater than this is an outlier.
+private:
+  /* First entry of each surfel and one past the last surfel */
+  std::vector<uint32_t> m_offsets;
+  std::vector<uint32_t> m_frames;
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_z;
+};
+
+/**
+ * Remove neighbours whose distance from the surfel is unreliable: those which share only one
+ * frame with it, and those whose distance in some frame is an outlier among the distances
+ * in all shared frames, i.e. more than one interquartile range above the third quartile.
+ * @param distances Scratch space, reused between calls.
+ */
+void
+cull_unreasonable_neighbours(
+    const SurfelTracks &tracks,
+    uint32_t surfel,
+    std::vector<int32_t> &potential_neighbours,
+    std::vector<float> &distances) {
+
+  const auto num_potential_neighbours = potential_neighbours.size();
+  potential_neighbours.erase(
+      std::remove_if(potential_neighbours.begin(),
+                     potential_neighbours.end(),
+                     [&](int32_t neighbour) {
+                       distances.clear();
+                       tracks.distances_in_common_frames(surfel, (uint32_t) neighbour, distances);
+                       // Neighbours in only one frame are not really trustworthy
+                       if (distances.size() < 2) {
+                         return true;
+                       }
+                       const auto max_distance = *std::max_element(distances.begin(), distances.end());
+                       const auto quartiles = compute_quartiles(distances);
+                       return max_distance > quartiles.third + quartiles.interquartile_range();
+                     }),
+      potential_neighbours.end());
+
+  if (num_potential_neighbours >= 8) {
+    spdlog::debug("Surfel {} had {} potential neighbours. Culled {}.",
+                  surfel, num_potential_neighbours, num_potential_neighbours - potential_neighbours.size());
+  }
+}
 
-    if (should_log) {
-      spdlog::info(" q1: {}, q2: {}, q3: {}, IQR: {}, max_dist: {}", q1, q2, q3, iqr, max_dist);
+/**
+ * Per frame images of the surfel covering each pixel, so that finding the surfels
+ * around a pixel is a handful of array reads.
+ */
+class PixelIndex {
+public:
+  static const int32_t NO_SURFEL = -1;
+
+  /**
+   * Size an empty image for each frame.
+   * @param frame_sizes The width and height covering all of each frame's pixels.
+   */
+  explicit PixelIndex(const std::vector<std::pair<unsigned int, unsigned int>> &frame_sizes) {
+    m_frames.reserve(frame_sizes.size());
+    for (const auto &size: frame_sizes) {
+      m_frames.push_back({size.first, size.second, std::vector<int32_t>((size_t) size.first * size.second, NO_SURFEL)});
     }
+  }
 
-    bool bad_value_present = false;
-    for (const auto &frame_dist: frame_to_dist) {
-      if (frame_dist.second > max_dist) {
-        if (should_log) {
-          spdlog::info("   Distance in {} frame {} is an outlier.", frame_dist.second, frame_dist.first);
-        }
-
-        bad_value_present = true;
-        break;
-      }
-    }
-
-    if (bad_value_present) {
-      cullable_neighbours.emplace(neighbour);
-      if (should_log) {
-        spdlog::info("   Culling this neighbour.");
-      }
-    } else {
-      if (should_log) {
-        spdlog::info("   This neighbour is fine.");
-      }
+  /**
+   * Record the surfel covering a pixel. The first surfel recorded for a pixel keeps it.
+   */
+  void add(const PixelInFrame &pif, int32_t surfel_index) {
+    auto &surfel = m_frames.at(pif.frame).surfels.at((size_t) pif.pixel.y * m_frames[pif.frame].width + pif.pixel.x);
+    if (surfel == NO_SURFEL) {
+      surfel = surfel_index;
     }
   }
 
-  if (!cullable_neighbours.empty()) {
-    if (should_log) {
-      spdlog::info(" Found {} cullable neighbours.", cullable_neighbours.size());
+  /**
+   * @return The surfel covering pixel (x, y) of a frame or NO_SURFEL if there is none or
+   * the pixel is outside the frame.
+   */
+  inline int32_t surfel_at(unsigned int frame, int x, int y) const {
+    const auto &index = m_frames[frame];
+    if (x < 0 || y < 0 || (unsigned int) x >= index.width || (unsigned int) y >= index.height) {
+      return NO_SURFEL;
     }
-
-    potential_neighbour_nodes.erase(
-        std::remove_if(potential_neighbour_nodes.begin(),
-                             potential_neighbour_nodes.end(),
-                             [&](const SurfelGraphNodePtr &n) {
-                               return cullable_neighbours.count(n) > 0;
-                             }),
-              potential_neighbour_nodes.end()
-    );
-  }
-  if (should_log) {
-    spdlog::info(" Removed {} nodes. Now {} left",
-                 cullable_neighbours.size(),
-                 potential_neighbour_nodes.size());
+    return index.surfels[(size_t) y * index.width + x];
   }
-}
 
-std::vector<SurfelGraphNodePtr>
+private:
+  struct FrameIndex {
+    unsigned int width;
+    unsigned int height;
+    std::vector<int32_t> surfels;
+  };
+  std::vector<FrameIndex> m_frames;
+};
+
+const int32_t PixelIndex::NO_SURFEL;
+
+/**
+ * @return The surfels other than this one which cover a pixel next to any of its pixels,
+ * each once, in the order found.
+ */
+std::vector<int32_t>
 get_potential_neighbours( //
-    const std::map<PixelInFrame, SurfelGraphNodePtr> &pif_to_graph_node, //
-    const SurfelGraphNodePtr &node) {
+    const PixelIndex &pixel_index, //
+    const SurfelGraphNodePtr &node, //
+    int32_t surfel_index) {
   using namespace std;
 
-  set<SurfelGraphNodePtr> potential_neighbours;
-
+  // Surfels have few distinct neighbours so a linear scan is the cheapest dedupe
+  vector<int32_t> potential_neighbours;
   for (const auto &fd: node->data()->frame_data()) {
     const auto &pif = fd.pixel_in_frame;
+    const auto x = (int) pif.pixel.x;
+    const auto y = (int) pif.pixel.y;
 
     for (int dx = -1; dx <= 1; ++dx) {
       for (int dy = -1; dy <= 1; ++dy) {
@@ -228,60 +254,155 @@ get_potential_neighbours( //
         if (dx == 0 && dy == 0) {
           continue;
         }
-        const auto &n = pif_to_graph_node.find({pif.pixel.x + dx, pif.pixel.y + dy, pif.frame});
+        const auto n = pixel_index.surfel_at(pif.frame, x + dx, y + dy);
         // Not an actual node
-        if (n == pif_to_graph_node.end()) {
+        if (n == PixelIndex::NO_SURFEL || n == surfel_index) {
           continue;
         }
         // Don't double count.
-        if (potential_neighbours.count(n->second) > 0) {
+        if (find(potential_neighbours.begin(), potential_neighbours.end(), n) != potential_neighbours.end()) {
           continue;
         }
-        potential_neighbours.emplace(n->second);
+        potential_neighbours.push_back(n);
       }
     }
   }
-  return vector<SurfelGraphNodePtr>{begin(potential_neighbours), end(potential_neighbours)};
+  return potential_neighbours;
 }
 
 void
 generate_edges( //
     SurfelGraph *graph, //
-    const std::map<PixelInFrame, SurfelGraphNodePtr> &pif_to_graph_node, //
-    unsigned int num_frames, //
+    const std::vector<SurfelGraphNodePtr> &surfel_nodes, //
+    const PixelIndex &pixel_index, //
     float nbr_threshold //
 ) {
-  //    Add neighbours based on PIF data
-  for (const auto &node: graph->nodes()) {
-    auto potential_neighbour_nodes = get_potential_neighbours(pif_to_graph_node, node);
-    cull_unreasonable_neighbours(node, potential_neighbour_nodes);
-    for (const auto &neighbour_node: potential_neighbour_nodes) {
-      try {
-        graph->add_edge(node, neighbour_node, SurfelGraphEdge{1});
-      } catch (std::runtime_error const &err) {
+  using namespace std;
+
+  // Find and cull each surfel's neighbours in parallel; only reads the graph
+  const SurfelTracks tracks{surfel_nodes};
+  vector<vector<int32_t>> neighbours_by_surfel(surfel_nodes.size());
+  animesh::spatial_index::for_each_band(surfel_nodes.size(), 0, [&](size_t first, size_t end) {
+    vector<float> distances;
+    for (auto surfel = first; surfel < end; ++surfel) {
+      auto &potential_neighbours = neighbours_by_surfel[surfel];
+      potential_neighbours = get_potential_neighbours(pixel_index, surfel_nodes[surfel], (int32_t) surfel);
+      cull_unreasonable_neighbours(tracks, (uint32_t) surfel, potential_neighbours, distances);
+    }
+  });
+
+  //    Add neighbours based on PIF data. Each pair is usually found from both ends.
+  for (size_t surfel = 0; surfel < surfel_nodes.size(); ++surfel) {
+    for (const auto neighbour: neighbours_by_surfel[surfel]) {
+      if (!graph->has_edge(surfel_nodes[surfel], surfel_nodes[neighbour])) {
+        graph->add_edge(surfel_nodes[surfel], surfel_nodes[neighbour], SurfelGraphEdge{1});
       }
     }
   }
 }
 
-std::map<unsigned int, std::vector<Eigen::Vector3f>>
+/**
+ * Values of one kind for every path entry, set a frame at a time as the frames load.
+ */
+template<typename T>
+struct EntryValues {
+  /* The value of each of Paths::entries */
+  std::vector<T> values;
+  /* Whether the entries in each frame have been set */
+  std::vector<bool> frame_set;
+};
+
+/**
+ * The path entries lying in each frame. Each frame's pixels, points and normals are copied into
+ * the entries that use them as soon as the frame loads, so no frame is held once it is copied.
+ */
+class EntriesByFrame {
+public:
+  explicit EntriesByFrame(const Paths &paths) : m_paths{paths} {
+    uint32_t num_frames = 0;
+    for (const auto &entry: paths.entries) {
+      num_frames = std::max(num_frames, entry.frame + 1);
+    }
+    m_first_entry.assign(num_frames + 1, 0);
+    for (const auto &entry: paths.entries) {
+      ++m_first_entry[entry.frame + 1];
+    }
+    std::partial_sum(m_first_entry.begin(), m_first_entry.end(), m_first_entry.begin());
+    m_entries.resize(paths.entries.size());
+    auto next_slot = m_first_entry;
+    for (uint32_t e = 0; e < paths.entries.size(); ++e) {
+      m_entries[next_slot[paths.entries[e].frame]++] = e;
+    }
+  }
+
+  inline unsigned int num_frames() const { return (unsigned int) m_first_entry.size() - 1; }
+
+  template<typename T>
+  EntryValues<T> make_values(const T &initial_value) const {
+    return {std::vector<T>(m_paths.entries.size(), initial_value), std::vector<bool>(num_frames(), false)};
+  }
+
+  /**
+   * Set each entry (frame, index) to frame_values[index].
+   */
+  template<typename T>
+  void set(unsigned int frame, const std::vector<T> &frame_values, const std::string &kind,
+           EntryValues<T> &entry_values) const {
+    if (frame >= num_frames()) {
+      return;
+    }
+    for (auto i = m_first_entry[frame]; i < m_first_entry[frame + 1]; ++i) {
+      const auto entry = m_entries[i];
+      const auto index = m_paths.entries[entry].index;
+      if (index >= frame_values.size()) {
+        throw std::runtime_error("Paths use " + kind + " " + std::to_string(index) + " of frame "
+                                     + std::to_string(frame) + " but it has only " + std::to_string(frame_values.size()));
+      }
+      entry_values.values[entry] = frame_values[index];
+    }
+    entry_values.frame_set[frame] = true;
+  }
+
+  /**
+   * Throw unless every frame the paths use has been set.
+   */
+  template<typename T>
+  void check_set(const EntryValues<T> &entry_values, const std::string &kind) const {
+    for (unsigned int frame = 0; frame < num_frames(); ++frame) {
+      if (m_first_entry[frame] != m_first_entry[frame + 1] && !entry_values.frame_set[frame]) {
+        throw std::runtime_error("Paths use frame " + std::to_string(frame) + " but it has no " + kind);
+      }
+    }
+  }
+
+private:
+  const Paths &m_paths;
+  /* Entries in frame f are m_entries[m_first_entry[f]] up to m_entries[m_first_entry[f + 1]] */
+  std::vector<uint32_t> m_first_entry;
+  std::vector<uint32_t> m_entries;
+};
+
+void
 load_normals(
     const std::string &normal_file_template,
     unsigned int num_frames,
-    unsigned int level
+    unsigned int level,
+    const EntriesByFrame &entries_by_frame,
+    EntryValues<Eigen::Vector3f> &entry_normals
 ) {
   using namespace std;
   using namespace Eigen;
 
-  map<unsigned int, vector<Vector3f>> normals_by_frame;
-  for (int frameIdx = 0; frameIdx < num_frames; ++frameIdx) {
-    auto normal_file_name = file_name_from_template_level_and_frame(normal_file_template, level, frameIdx);
-    process_file_by_lines(normal_file_name, [&normals_by_frame, &frameIdx](const std::string &line) {
-      auto normal = string_to_vec3f(line);
-      normals_by_frame[frameIdx].emplace_back(normal);
-    });
-  }
-  return normals_by_frame;
+  FrameLoader<vector<Vector3f>> loader{
+      num_frames,
+      [&normal_file_template, level](unsigned int frameIdx) {
+        auto normal_file_name = file_name_from_template_level_and_frame(normal_file_template, level, frameIdx);
+        return read_vec3f_text_file(normal_file_name);
+      },
+      [](const vector<Vector3f> &normals) { return normals.size() * sizeof(Vector3f); }};
+  loader.for_each([&](unsigned int frameIdx, vector<Vector3f> &&normals) {
+    entries_by_frame.set(frameIdx, normals, "normal", entry_normals);
+  });
 }
 
 unsigned int extract_frame_from_pif_filename(std::string file_name, const std::string &pif_regex) {
@@ -297,10 +418,16 @@ unsigned int extract_frame_from_pif_filename(std::string file_name, const std::s
   throw runtime_error("pif file name is invalid " + file_name);
 }
 
-std::vector<std::vector<Pixel>> load_pifs( //
+/**
+ * Load the PIF files, copying each frame's pixels into the path entries once all of that frame's
+ * files have loaded. A frame's pixels are those of its files in name order.
+ * @return The width and height covering each frame's pixels.
+ */
+std::vector<std::pair<unsigned int, unsigned int>> load_pifs( //
     const std::string &source_directory, //
     const std::string &pif_regex, //
-    unsigned int &num_frames) {
+    const EntriesByFrame &entries_by_frame, //
+    EntryValues<Pixel> &entry_pixels) {
   using namespace std;
 
   vector<string> pif_files;
@@ -318,27 +445,51 @@ std::vector<std::vector<Pixel>> load_pifs( //
 
   std::sort(pif_files.begin(), pif_files.end());
 
-  vector<vector<Pixel>> pixel_by_frame;
-  num_frames = 0;
+  vector<unsigned int> frame_by_file;
+  unsigned int num_frames = 0;
   for (const auto &pif_file: pif_files) {
     auto frameIdx = extract_frame_from_pif_filename(pif_file, pif_regex);
-    if (frameIdx >= num_frames) {
-      num_frames = frameIdx + 1;
-      pixel_by_frame.resize(num_frames);
-    }
-
-    size_t index = 0;
-    process_file_by_lines(pif_file, [&pixel_by_frame, frameIdx, &index](const std::string &line) {
-      // Strip ()
-      auto values = line.substr(1, line.size() - 2);
-      auto coords = split(values, ',');
-      unsigned int px = stoi(coords[0]);
-      unsigned int py = stoi(coords[1]);
-      pixel_by_frame[frameIdx].push_back({px, py});
-      ++index;
-    });
+    frame_by_file.push_back(frameIdx);
+    num_frames = max(num_frames, frameIdx + 1);
+  }
+  vector<unsigned int> files_left_in_frame(num_frames, 0);
+  for (const auto frameIdx: frame_by_file) {
+    ++files_left_in_frame[frameIdx];
   }
-  return pixel_by_frame;
+
+  vector<pair<unsigned int, unsigned int>> frame_sizes(num_frames, {0, 0});
+  map<unsigned int, vector<Pixel>> partial_frames;
+  FrameLoader<vector<Pixel>> loader{
+      (unsigned int) pif_files.size(),
+      [&pif_files](unsigned int file) {
+        auto coords = read_uint_pair_text_file(pif_files[file]);
+        vector<Pixel> pixels;
+        pixels.reserve(coords.size());
+        for (const auto &xy: coords) {
+          pixels.push_back({xy.first, xy.second});
+        }
+        return pixels;
+      },
+      [](const vector<Pixel> &pixels) { return pixels.size() * sizeof(Pixel); }};
+  loader.for_each([&](unsigned int file, vector<Pixel> &&pixels) {
+    const auto frameIdx = frame_by_file[file];
+    auto &size = frame_sizes[frameIdx];
+    for (const auto &pixel: pixels) {
+      size.first = max(size.first, pixel.x + 1);
+      size.second = max(size.second, pixel.y + 1);
+    }
+    auto &frame_pixels = partial_frames[frameIdx];
+    if (frame_pixels.empty()) {
+      frame_pixels = move(pixels);
+    } else {
+      frame_pixels.insert(frame_pixels.end(), pixels.begin(), pixels.end());
+    }
+    if (--files_left_in_frame[frameIdx] == 0) {
+      entries_by_frame.set(frameIdx, frame_pixels, "pixel", entry_pixels);
+      partial_frames.erase(frameIdx);
+    }
+  });
+  return frame_sizes;
 }
 
 int main(int argc, const char *argv[]) {
@@ -359,6 +510,11 @@ int main(int argc, const char *argv[]) {
   auto eight_connected = properties.getBooleanProperty("d2g-eight-connected");
   auto source_directory = properties.getProperty("d2g-source-directory");
   auto nbr_threshold = properties.getFloatProperty("d2g-max-neighbour-distance");
+  // Surfels are neighbours when adjacent in a depth map ("pixel") or when close in space
+  // in enough frames ("radius" or "nearest"), for point clouds with no pixel grid
+  string neighbour_mode = properties.hasProperty("d2g-neighbour-mode")
+                          ? properties.getProperty("d2g-neighbour-mode")
+                          : "pixel";
 
   cout << "Running " << argv[0] << " with the following settings:" << endl;
   cout << "  d2g-level                        : " << level << endl;
@@ -369,12 +525,13 @@ int main(int argc, const char *argv[]) {
   cout << "  d2g-eight-connected              : " << (eight_connected ? "true" : "false") << endl;
   cout << "  d2g-source-directory             : " << source_directory << endl;
   cout << "  d2g-max-neighbour-distance       : " << nbr_threshold << endl;
+  cout << "  d2g-neighbour-mode               : " << neighbour_mode << endl;
 
   string path_file_name;
   if (properties.hasProperty("d2g-path-template")) {
     path_file_name = file_name_from_template_and_level(properties.getProperty("d2g-path-template"), level);
   } else {
-    path_file_name = "paths.txt";
+    path_file_name = "paths.bin";
   }
   cout << "Loading paths from : " << path_file_name << endl;
 
@@ -386,51 +543,79 @@ int main(int argc, const char *argv[]) {
   }
   cout << "Saving output graph to : " << surfel_file_name << endl;
 
-  // Load all the data
-  unsigned int num_frames = 0;
+  // Paths come first so that each frame's data can be copied into the entries using it as it
+  // loads, rather than holding every frame until all of them have loaded
+  auto paths = load_paths(path_file_name);
+  cout << "Found " << paths.size() << " paths." << endl;
+  const EntriesByFrame entries_by_frame{paths};
+
   string pattern = file_name_from_template_and_level(pif_regex, level);
-  auto pixel_by_frame = load_pifs(source_directory, pattern, num_frames);
+  auto entry_pixels = entries_by_frame.make_values(Pixel{0, 0});
+  const auto frame_sizes = load_pifs(source_directory, pattern, entries_by_frame, entry_pixels);
+  entries_by_frame.check_set(entry_pixels, "pixels");
 
   pattern = file_name_from_template_and_level(point_cloud_regex, level);
-  auto vertices_by_frame = load_vec3s_from_directory(source_directory, pattern);
-
-  auto normals_by_frame = load_normals(normal_file_template, num_frames, level);
+  auto entry_vertices = entries_by_frame.make_values<Vector3f>(Vector3f::Zero());
+  for_each_vec3s_in_directory(source_directory, pattern, [&](unsigned int frame, vector<Vector3f> &&vertices) {
+    entries_by_frame.set(frame, vertices, "point", entry_vertices);
+  }, FrameLoader<vector<Vector3f>>::DEFAULT_MEMORY_CEILING);
+  entries_by_frame.check_set(entry_vertices, "points");
 
-  // Load paths
-  auto paths = load_paths(path_file_name);
-  cout << "Found " << paths.size() << " paths." << endl;
+  auto entry_normals = entries_by_frame.make_values<Vector3f>(Vector3f::Zero());
+  load_normals(normal_file_template, (unsigned int) frame_sizes.size(), level, entries_by_frame, entry_normals);
+  entries_by_frame.check_set(entry_normals, "normals");
 
   // Use the paths to generate surfels
-  map<PixelInFrame, SurfelGraphNodePtr> pif_to_surfel;
+  PixelIndex pixel_index{frame_sizes};
+  vector<SurfelGraphNodePtr> surfel_nodes;
+  surfel_nodes.reserve(paths.size());
 
   default_random_engine re{123};
   auto sb = new SurfelBuilder(re);
   auto *graph = new SurfelGraph();
 
-  unsigned int surfel_id = 0;
-  for (const auto &path: paths) {
+  for (unsigned int surfel_id = 0; surfel_id < paths.size(); ++surfel_id) {
     sb->reset();
     string surfel_name = "s_" + to_string(surfel_id);
     sb->with_id(surfel_name);
 
-    for (const auto &path_entry: path) {
-      PixelInFrame pif{pixel_by_frame[path_entry.first][path_entry.second], path_entry.first};
-      auto &v = vertices_by_frame[path_entry.first][path_entry.second];
-      auto &n = normals_by_frame[path_entry.first][path_entry.second];
-      sb->with_frame(pif, 0.0f, n, v);
+    for (auto entry = paths.offsets[surfel_id]; entry < paths.offsets[surfel_id + 1]; ++entry) {
+      PixelInFrame pif{entry_pixels.values[entry], paths.entries[entry].frame};
+      sb->with_frame(pif, 0.0f, entry_normals.values[entry], entry_vertices.values[entry]);
     }
 
-    auto node = graph->add_node(make_shared<Surfel>(sb->build()));
-    for (const auto &path_entry: path) {
-      PixelInFrame pif{pixel_by_frame[path_entry.first][path_entry.second], path_entry.first};
-      pif_to_surfel.emplace(pif, node);
+    surfel_nodes.push_back(graph->add_node(make_shared<Surfel>(sb->build())));
+    for (auto entry = paths.offsets[surfel_id]; entry < paths.offsets[surfel_id + 1]; ++entry) {
+      PixelInFrame pif{entry_pixels.values[entry], paths.entries[entry].frame};
+      pixel_index.add(pif, (int32_t) surfel_id);
     }
-
-    ++surfel_id;
   }
 
-  // Use adjacency of pixels in DMs to establish neighbourhoods
-  generate_edges(graph, pif_to_surfel, num_frames, nbr_threshold);
+  if (neighbour_mode == "pixel") {
+    // Use adjacency of pixels in DMs to establish neighbourhoods
+    generate_edges(graph, surfel_nodes, pixel_index, nbr_threshold);
+  } else if (neighbour_mode == "radius" || neighbour_mode == "nearest") {
+    auto radius = properties.getFloatProperty("d2g-neighbour-radius");
+    auto k = (neighbour_mode == "nearest") ? properties.getIntProperty("d2g-neighbour-k") : 0;
+    auto min_common_frames = properties.getIntProperty("d2g-neighbour-min-frames");
+    if (k < 0 || min_common_frames < 0) {
+      throw runtime_error("d2g-neighbour-k and d2g-neighbour-min-frames must not be negative");
+    }
+    cout << "  d2g-neighbour-radius             : " << radius << endl;
+    cout << "  d2g-neighbour-k                  : " << k << endl;
+    cout << "  d2g-neighbour-min-frames         : " << min_common_frames << endl;
+
+    vector<shared_ptr<Surfel>> surfels;
+    surfels.reserve(surfel_nodes.size());
+    for (const auto &node: surfel_nodes) {
+      surfels.push_back(node->data());
+    }
+    for (const auto &surfel_pair: find_proximate_surfels(surfels, radius, (unsigned int) k, (unsigned int) min_common_frames)) {
+      graph->add_edge(surfel_nodes[surfel_pair.first], surfel_nodes[surfel_pair.second], SurfelGraphEdge{1});
+    }
+  } else {
+    throw runtime_error("Unknown d2g-neighbour-mode " + neighbour_mode);
+  }
 
   save_surfel_graph_to_file(surfel_file_name, static_cast<const SurfelGraphPtr>(graph));
 
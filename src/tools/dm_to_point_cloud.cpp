@@ -12,6 +12,7 @@
 #include <fstream>
 
 #include <DepthMap/DepthMap.h>
+#include <DepthMap/PointImage.h>
 #include <Properties/Properties.h>
 #include <Camera/Camera.h>
 #include <Surfel/Pixel.h>
@@ -44,10 +45,11 @@ get_valid_pixels_for_depth_map(const DepthMap &depth_map) {
     using namespace std;
 
     // Filter out invalid points (points which have no normals is the thing)
+    const auto &normals = depth_map.get_normals();
     vector<Pixel> valid_pixels;
     for (unsigned int y = 0; y < depth_map.height(); ++y) {
         for (unsigned int x = 0; x < depth_map.width(); ++x) {
-            if (depth_map.is_normal_defined(x, y)) {
+            if (normals.is_defined(x, y)) {
                 valid_pixels.emplace_back(x, y);
             }
         }
@@ -67,15 +69,13 @@ project_pixels_to_point_cloud(const std::vector<Pixel> &pixels,
 
     Eigen::MatrixX3d m{pixels.size(), 3};
 
+    const auto points = backproject(depth_map, camera);
     unsigned int row = 0;
     for (const auto &pixel : pixels) {
-        float depth = depth_map.depth_at(pixel.x, pixel.y);
-
-        float xyz[3];
-        camera.to_world_coordinates(pixel.x, pixel.y, depth, xyz);
-        m(row, 0) = xyz[0];
-        m(row, 1) = xyz[1];
-        m(row, 2) = xyz[2];
+        const auto xyz = points(pixel.x, pixel.y);
+        m(row, 0) = xyz.x();
+        m(row, 1) = xyz.y();
+        m(row, 2) = xyz.z();
         row++;
     }
 
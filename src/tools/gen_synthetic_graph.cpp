@@ -0,0 +1,75 @@
+/**
+* Generate large multi-frame surfel graphs from deforming parametric surfaces
+* for scaling and load tests. The graph is streamed straight to disk.
+*/
+#include <Surfel/SyntheticSurfelGraph.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+
+void usage(const char *name) {
+    std::cerr << "Usage: " << name << " [-s plane|sphere|torus|cloth] [-w width] [-h height] [-f frames]" << std::endl
+              << "         [-k scale] [-n position_noise] [-m normal_noise] [-d dropout] [-e edge_dropout]" << std::endl
+              << "         [-4] [-r seed] [-o output_file]" << std::endl;
+}
+
+int main(int argc, char *const argv[]) {
+    SyntheticSurfelGraphParameters parameters;
+    std::string output_file = "synthetic_surfels.bin";
+    int ch;
+    const char *opts = "s:w:h:f:k:n:m:d:e:4r:o:";
+    try {
+        while ((ch = getopt(argc, argv, opts)) != -1) {
+            switch (ch) {
+                case 's':
+                    parameters.surface = synthetic_surface_with_name(optarg);
+                    break;
+                case 'w':
+                    parameters.width = std::stoul(optarg);
+                    break;
+                case 'h':
+                    parameters.height = std::stoul(optarg);
+                    break;
+                case 'f':
+                    parameters.num_frames = std::stoul(optarg);
+                    break;
+                case 'k':
+                    parameters.scale = std::stof(optarg);
+                    break;
+                case 'n':
+                    parameters.position_noise = std::stof(optarg);
+                    break;
+                case 'm':
+                    parameters.normal_noise = std::stof(optarg);
+                    break;
+                case 'd':
+                    parameters.dropout = std::stof(optarg);
+                    break;
+                case 'e':
+                    parameters.edge_dropout = std::stof(optarg);
+                    break;
+                case '4':
+                    parameters.eight_connected = false;
+                    break;
+                case 'r':
+                    parameters.seed = std::stoul(optarg);
+                    break;
+                case 'o':
+                    output_file = optarg;
+                    break;
+                default:
+                    usage(argv[0]);
+                    return 1;
+            }
+        }
+
+        SyntheticSurfelGraphGenerator generator{parameters};
+        generator.write(output_file);
+    } catch (const std::exception &e) {
+        spdlog::error("{}", e.what());
+        usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
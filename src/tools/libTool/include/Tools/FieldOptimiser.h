@@ -5,6 +5,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <Surfel/MultiResolutionSurfelGraph.h>
 
 class FieldOptimiser {
@@ -66,6 +67,9 @@ class FieldOptimiser {
 
   void label_edge(SurfelGraph::Edge &edge);
 
+  /* Name of the instrumentation timer for a phase of the current level */
+  std::string level_timer_name(const std::string &phase) const;
+
   void compute_k_for_edge( //
       const std::shared_ptr<Surfel> &from_surfel,
       const std::shared_ptr<Surfel> &to_surfel,
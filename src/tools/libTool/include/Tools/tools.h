@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <map>
 #include <vector>
 #include <string>
@@ -15,9 +17,24 @@ load_vec3f_from_file(const std::string& vec_filename);
  * Load all pointclouds from a directory given a regex pattern.
  * The regex should include one capture group that identifies the frame
  * number. This is assumed to be an integer and will be used as the key in the returned map.
+ * Parsed files are cached in binary beneath the directory and reused while the text is unchanged.
  */
 std::map<unsigned int, std::vector<Eigen::Vector3f>>
 load_vec3s_from_directory(const std::string& directory, const std::string& pattern);
 
+/**
+ * As load_vec3s_from_directory, but each file's vectors are handed to the consumer with their
+ * frame number, in file name order, as soon as they are read, so callers that only need part of
+ * each frame need not hold them all. At most memory_ceiling bytes are held waiting for the consumer.
+ */
+void
+for_each_vec3s_in_directory(const std::string &directory, const std::string &pattern,
+                            const std::function<void(unsigned int, std::vector<Eigen::Vector3f> &&)> &consume,
+                            size_t memory_ceiling);
+
+/**
+ * As load_vec3s_from_directory but widened to double precision matrices, for callers whose
+ * libraries need them. Prefer load_vec3s_from_directory otherwise.
+ */
 std::map<unsigned int, Eigen::MatrixX3d>
 load_vec3f_from_directory_as_matrices(const std::string &directory, const std::string &pattern);
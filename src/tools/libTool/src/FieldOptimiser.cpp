@@ -9,6 +9,13 @@
 #include <Geom/Geom.h>
 #include <RoSy/RoSy.h>
 #include <PoSy/PoSy.h>
+#include <Instrumentation/Instrumentation.h>
+
+namespace {
+  const auto NODES_VISITED = instrumentation::counter("nodes visited");
+  const auto EDGES_EVALUATED = instrumentation::counter("edges evaluated");
+  const auto FRAMES_TOUCHED = instrumentation::counter("frames touched");
+}
 
 FieldOptimiser::FieldOptimiser( //
     std::default_random_engine &rng,
@@ -64,9 +71,12 @@ FieldOptimiser::optimise_posy() {
 
   auto &graph = (*m_graph)[m_current_level];
   spdlog::info("  PoSy pass {}", m_num_iterations + 1);
+  instrumentation::ScopedTimer timer{level_timer_name("posy pass")};
 
   const auto &nodes = graph->nodes();
   auto indices = randomise_indices(nodes.size());
+  uint64_t frames_touched = 0;
+  uint64_t edges_evaluated = 0;
 
   for (auto node_index: indices) {
     auto node = nodes[node_index];
@@ -97,6 +107,8 @@ FieldOptimiser::optimise_posy() {
       // Get the neighbours of this surfel in this frame
       const auto &neighbours = get_node_neighbours_in_frame(graph, node, frame_idx);
       trace_log->info("    smoothing with {} neighbours", neighbours.size());
+      ++frames_touched;
+      edges_evaluated += neighbours.size();
 
       float sum_w = 0.0;
       for (const auto &nbr_node: neighbours) {
@@ -163,6 +175,9 @@ FieldOptimiser::optimise_posy() {
       node->data()->set_reference_lattice_offset({u, v});
     } // Next frame
   }
+  instrumentation::add(NODES_VISITED, nodes.size());
+  instrumentation::add(FRAMES_TOUCHED, frames_touched);
+  instrumentation::add(EDGES_EVALUATED, edges_evaluated);
 
   ++m_num_iterations;
   if (m_num_iterations == m_target_iterations) {
@@ -193,9 +208,12 @@ FieldOptimiser::optimise_rosy() {
   auto &graph = (*m_graph)[m_current_level];
 
   spdlog::info("  RoSy pass {}", m_num_iterations + 1);
+  instrumentation::ScopedTimer timer{level_timer_name("rosy pass")};
 
   const auto &nodes = graph->nodes();
   auto indices = randomise_indices(nodes.size());
+  uint64_t frames_touched = 0;
+  uint64_t edges_evaluated = 0;
 
   for (auto node_index: indices) {
     auto this_node = nodes[node_index];
@@ -232,6 +250,8 @@ FieldOptimiser::optimise_rosy() {
       // Get the neighbours of this node in the current frame
       auto
           neighbours = get_node_neighbours_in_frame(graph, this_node, current_frame_idx);
+      ++frames_touched;
+      edges_evaluated += neighbours.size();
 
       // Smooth with each neighbour in turn
       for (const auto &nbr: neighbours) {
@@ -294,6 +314,9 @@ FieldOptimiser::optimise_rosy() {
 
     this_surfel->set_rosy_correction(corrn);
   }
+  instrumentation::add(NODES_VISITED, nodes.size());
+  instrumentation::add(FRAMES_TOUCHED, frames_touched);
+  instrumentation::add(EDGES_EVALUATED, edges_evaluated);
 
   ++m_num_iterations;
   if (m_num_iterations == m_target_iterations) {
@@ -317,7 +340,10 @@ FieldOptimiser::end_level() {
     return;
   }
 
-  m_graph->propagate_completely(m_current_level, m_mode == ROSY, m_mode == POSY);
+  {
+    instrumentation::ScopedTimer timer{level_timer_name("propagate")};
+    m_graph->propagate_completely(m_current_level, m_mode == ROSY, m_mode == POSY);
+  }
   --m_current_level;
   m_state = STARTING_NEW_LEVEL;
 }
@@ -350,6 +376,7 @@ FieldOptimiser::label_edges() {
 
   auto trace_log = spdlog::get("optimiser");
   trace_log->trace("label_edges()");
+  instrumentation::ScopedTimer timer{"label edges"};
 
   for (auto &edge: (*m_graph)[0]->edges()) {
     label_edge(edge);
@@ -448,6 +475,11 @@ FieldOptimiser::label_edge(SurfelGraph::Edge &edge) {
   set_t((*m_graph)[0], edge.from(), t_ij, edge.to(), t_ji);
 }
 
+std::string
+FieldOptimiser::level_timer_name(const std::string &phase) const {
+  return "level " + std::to_string(m_current_level) + "/" + phase;
+}
+
 bool
 FieldOptimiser::optimise_once() {
   bool optimisation_complete = false;
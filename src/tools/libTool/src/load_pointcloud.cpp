@@ -1,33 +1,28 @@
 
 #include <tools.h>
 #include <regex>
+#include <limits>
 #include <FileUtils/FileUtils.h>
-#include <CommonUtilities/split.h>
+#include <FileUtils/FrameLoader.h>
+#include <FileUtils/TextFileParser.h>
+#include <FileUtils/Vec3fCache.h>
 
 /**
  * Load pointcloud from file
  */
 std::vector<Eigen::Vector3f>
 load_vec3f_from_file(const std::string &vec_filename) {
-  using namespace std;
-  using namespace Eigen;
-
-  vector<Vector3f> vectors;
-
-  process_file_by_lines(vec_filename, [&vectors](const std::string &line) {
-    auto vertex = string_to_vec3f(line);
-    vectors.emplace_back(vertex);
-  });
-  return vectors;
-};
+  return read_vec3f_text_file(vec_filename);
+}
 
 /**
- * Given a regex matching one or more files, which should include one capture group that identifies the frame
- * number. This is assumed to be an integer and will be used as the key in the returned map.
- * Read all vectors from these files and return in a map.
+ * Read the vectors of each file matching a regex on a pool of I/O threads and hand them to the
+ * consumer, in file name order, with the frame number captured by the regex.
  */
-std::map<unsigned int, std::vector<Eigen::Vector3f>>
-load_vec3s_from_directory(const std::string &directory, const std::string &pattern) {
+void
+for_each_vec3s_in_directory(const std::string &directory, const std::string &pattern,
+                            const std::function<void(unsigned int, std::vector<Eigen::Vector3f> &&)> &consume,
+                            size_t memory_ceiling) {
   using namespace std;
   using namespace Eigen;
 
@@ -41,7 +36,7 @@ load_vec3s_from_directory(const std::string &directory, const std::string &patte
   });
   sort(vec3_files.begin(), vec3_files.end());
 
-  map<unsigned int, vector<Vector3f>> vec3_by_file_index;
+  vector<unsigned int> file_indices;
   for (const auto &file_name: vec3_files) {
     smatch matches;
     string lc_filename = file_name;
@@ -50,11 +45,38 @@ load_vec3s_from_directory(const std::string &directory, const std::string &patte
       throw runtime_error("Invalid vec3 filename " + file_name);
     }
     // 0 is the whole string, 1 is the frame
-    unsigned int file_idx = stoi(matches[1].str());
-    auto vec3f = load_vec3f_from_file(file_name);
-    vec3_by_file_index.emplace(file_idx, vec3f);
+    file_indices.push_back(stoi(matches[1].str()));
   }
 
+  FrameLoader<vector<Vector3f>> loader{
+      (unsigned int) vec3_files.size(),
+      [&directory, &vec3_files](unsigned int file) {
+        return read_vec3f_text_file_cached(file_in_directory(directory, vec3_files[file]));
+      },
+      [](const vector<Vector3f> &vec3f) { return vec3f.size() * sizeof(Vector3f); },
+      memory_ceiling};
+  loader.for_each([&](unsigned int file, vector<Vector3f> &&vec3f) {
+    consume(file_indices[file], move(vec3f));
+  });
+}
+
+/**
+ * Given a regex matching one or more files, which should include one capture group that identifies the frame
+ * number. This is assumed to be an integer and will be used as the key in the returned map.
+ * Read all vectors from these files and return in a map.
+ * Parsed files are cached in binary beneath the directory and later runs read the cache
+ * for as long as the text file is unchanged.
+ */
+std::map<unsigned int, std::vector<Eigen::Vector3f>>
+load_vec3s_from_directory(const std::string &directory, const std::string &pattern) {
+  using namespace std;
+  using namespace Eigen;
+
+  // Every file is kept so the loaders are not held back
+  map<unsigned int, vector<Vector3f>> vec3_by_file_index;
+  for_each_vec3s_in_directory(directory, pattern, [&](unsigned int frame, vector<Vector3f> &&vec3f) {
+    vec3_by_file_index.emplace(frame, move(vec3f));
+  }, numeric_limits<size_t>::max());
   return vec3_by_file_index;
 }
 
@@ -46,9 +46,11 @@ int main(int argc, char *argv[]) {
   }
 
   cout << "Parsing " << infile_name << endl;
-  auto results = animesh::ObjFileParser::parse_file(infile_name, true);
-  auto points_with_normals = results.first;
-  auto adjacency = results.second;
+  const auto mesh = animesh::ObjFileParser::read_mesh(infile_name);
+  // One normal per vertex is taken to be that vertex's normal, as the file gives it
+  const auto normals = (mesh.normals.size() == mesh.vertices.size())
+                       ? mesh.normals
+                       : animesh::ObjFileParser::vertex_normals(mesh);
 
   // Now generate the graph
   cout << "Generating graph (scale: " << scale_factor << ")" << endl;
@@ -56,29 +58,22 @@ int main(int argc, char *argv[]) {
   vector<SurfelGraphNodePtr> nodes;
   std::default_random_engine rng{123};
   SurfelBuilder sb(rng);
-  size_t vertex_index = 0;
-
-  for (const auto &point_with_normal: points_with_normals) {
+  nodes.reserve(mesh.vertices.size());
+  for (size_t vertex_index = 0; vertex_index < mesh.vertices.size(); ++vertex_index) {
     auto surfel = sb.with_id("v_" + to_string(vertex_index))
         ->with_frame(PixelInFrame{1, 1, 0},
                      10,
-                     point_with_normal->normal(),
-                     point_with_normal->point() * scale_factor)
+                     normals[vertex_index],
+                     mesh.vertices[vertex_index] * scale_factor)
         ->build();
     auto node = graph.add_node(make_shared<Surfel>(surfel));
     nodes.push_back(node);
-    vertex_index++;
     sb.reset();
   }
 
-  set<pair<size_t, size_t>> added_edges;
-  for (const auto &adj: adjacency) {
-    // Only add each edge once
-    if (added_edges.count({adj.first, adj.second}) == 0 &&
-        added_edges.count({adj.second, adj.first}) == 0) {
-      graph.add_edge(nodes[adj.first], nodes[adj.second], SurfelGraphEdge{1.0});
-      added_edges.emplace(adj.first, adj.second);
-    }
+  // Edges are already unique
+  for (const auto &edge: mesh.edges) {
+    graph.add_edge(nodes[edge.first], nodes[edge.second], SurfelGraphEdge{1.0});
   }
   save_surfel_graph_to_file(outfile_name, make_shared<SurfelGraph>(graph), false, true);
 }
\ No newline at end of file
@@ -7,18 +7,61 @@
 #include <Properties/Properties.h>
 #include <Surfel/MultiResolutionSurfelGraph.h>
 #include <Surfel/Surfel_IO.h>
+#include <Instrumentation/Instrumentation.h>
 #include "../libTool/include/Tools/FieldOptimiser.h"
 
+/*
+ * Parse a size in bytes with an optional K, M or G suffix, e.g. 48G
+ */
+size_t
+parse_memory_size(const std::string &value) {
+  size_t pos = 0;
+  auto size = std::stoull(value, &pos);
+  const auto suffix = value.substr(pos);
+  if (suffix.empty()) {
+    return size;
+  }
+  if (suffix == "K" || suffix == "k") {
+    return size << 10;
+  }
+  if (suffix == "M" || suffix == "m") {
+    return size << 20;
+  }
+  if (suffix == "G" || suffix == "g") {
+    return size << 30;
+  }
+  throw std::invalid_argument("Bad memory size " + value);
+}
+
+void
+report_memory(const std::shared_ptr<MultiResolutionSurfelGraph> &graph) {
+  const auto report = graph->memory_report();
+  spdlog::info("Estimated graph memory {} MB over {} levels", report.total() >> 20, graph->num_levels());
+  for (const auto &category: report.bytes_by_category) {
+    spdlog::info("  {:<28} {:>10} KB", category.first, category.second >> 10);
+    instrumentation::set_gauge("memory/" + category.first, category.second);
+  }
+  instrumentation::set_gauge("memory/total", report.total());
+  spdlog::info("Peak RSS {} MB", instrumentation::peak_rss_bytes() >> 20);
+}
+
 std::shared_ptr<MultiResolutionSurfelGraph>
-load_graph(std::default_random_engine &rng, const std::string &file_name, int num_levels) {
+load_graph(std::default_random_engine &rng, const std::string &file_name, int num_levels, size_t memory_budget) {
   if (num_levels <= 0) {
     throw std::runtime_error("Must be at least one level");
   }
-  auto surfel_graph = load_surfel_graph_from_file(file_name, rng);
+  std::shared_ptr<SurfelGraph> surfel_graph;
+  {
+    instrumentation::ScopedTimer timer{"load"};
+    surfel_graph = load_surfel_graph_from_file(file_name, rng);
+  }
   auto multi_res = std::make_shared<MultiResolutionSurfelGraph>(surfel_graph, rng);
+  multi_res->set_memory_budget(memory_budget);
   if (num_levels > 1) {
+    instrumentation::ScopedTimer timer{"build hierarchy"};
     multi_res->generate_levels(num_levels);
   }
+  report_memory(multi_res);
   return multi_res;
 }
 
@@ -41,6 +84,14 @@ check_properties(const std::shared_ptr<Properties>& properties) {
       throw std::invalid_argument("Bad value for 'rho'");
     }
   }
+  if (properties->hasProperty("memory-budget")) {
+    parse_memory_size(properties->getProperty("memory-budget"));
+  }
+  if (properties->hasProperty("instrumentation-report-interval")) {
+    if (properties->getIntProperty("instrumentation-report-interval") < 0) {
+      throw std::invalid_argument("Bad value for 'instrumentation-report-interval'");
+    }
+  }
 }
 
 std::shared_ptr<Properties>
@@ -74,8 +125,12 @@ int main(int argc, char *argv[]) {
   auto num_levels = properties->hasProperty("num-levels")
                     ? properties->getIntProperty("num-levels")
                     : 1;
+  // Levels which would take the graph over budget are not generated
+  auto memory_budget = properties->hasProperty("memory-budget")
+                       ? parse_memory_size(properties->getProperty("memory-budget"))
+                       : 0;
   std::default_random_engine rng{123};
-  auto graph = load_graph(rng, input_file_name, num_levels);
+  auto graph = load_graph(rng, input_file_name, num_levels, memory_budget);
 
   auto num_iterations = properties->getIntProperty("num-iterations");
   auto rho = (properties->hasProperty("rho"))
@@ -85,13 +140,38 @@ int main(int argc, char *argv[]) {
   auto optimiser = std::make_shared<FieldOptimiser>(rng, num_iterations, rho);
   optimiser->set_graph(graph);
 
+  // Optionally stream a snapshot of the instrumentation every N optimisation steps
+  auto report_interval = properties->hasProperty("instrumentation-report-interval")
+                         ? properties->getIntProperty("instrumentation-report-interval")
+                         : 0;
+  string stream_file_name = properties->hasProperty("instrumentation-stream-file")
+                            ? properties->getProperty("instrumentation-stream-file")
+                            : "instrumentation-stream.jsonl";
+
   auto start_time = chrono::system_clock::now();
-  while (!optimiser->optimise_once());
+  {
+    instrumentation::ScopedTimer timer{"optimise"};
+    int steps = 0;
+    while (!optimiser->optimise_once()) {
+      if (report_interval > 0 && ++steps % report_interval == 0) {
+        instrumentation::append_json_snapshot(stream_file_name);
+      }
+    }
+  }
   auto end_time = chrono::system_clock::now();
   report_timing(start_time, end_time);
 
   string output_file_name = properties->getProperty("output-file");
-  save_surfel_graph_to_file(output_file_name, (*graph)[0], true, true);
+  {
+    instrumentation::ScopedTimer timer{"save"};
+    save_surfel_graph_to_file(output_file_name, (*graph)[0], true, true);
+  }
+
+  string instrumentation_file_name = properties->hasProperty("instrumentation-file")
+                                     ? properties->getProperty("instrumentation-file")
+                                     : "instrumentation.json";
+  instrumentation::write_json_report(instrumentation_file_name);
+  spdlog::info("Wrote instrumentation report to {}", instrumentation_file_name);
 
   return 0;
 
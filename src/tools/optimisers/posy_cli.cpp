@@ -3,6 +3,7 @@
 #include <PoSy/MultiResolutionPoSyOptimiser.h>
 #include <Properties/Properties.h>
 #include <Surfel/Surfel_IO.h>
+#include <Instrumentation/Instrumentation.h>
 
 #include "spdlog/cfg/env.h"
 #include <string>
@@ -66,5 +67,11 @@ int main(int argc, char *argv[]) {
   save_surfel_graph_to_file(output_file_name, surfel_graph, true, true);
   info("Saved to {}", output_file_name);
 
+  string instrumentation_file_name = properties.hasProperty("instrumentation-file")
+                                     ? properties.getProperty("instrumentation-file")
+                                     : "instrumentation.json";
+  instrumentation::write_json_report(instrumentation_file_name);
+  info("Wrote instrumentation report to {}", instrumentation_file_name);
+
   return 0;
 }
@@ -5,7 +5,8 @@
 #include <vector>
 #include <Eigen/Core>
 #include <FileUtils/FileUtils.h>
-#include <CommonUtilities/split.h>
+#include <FileUtils/TextFileParser.h>
+#include <FileUtils/Vec3fCache.h>
 #include <fstream>
 #include <Correspondence/CorrespondenceIO.h>
 #include <Surfel/SurfelBuilder.h>
@@ -41,34 +42,17 @@ int main(int argc, char *argv[]) {
     const int NUM_FRAMES = 4;
     for (unsigned int frameIdx = 0; frameIdx < NUM_FRAMES; ++frameIdx) {
         string file_name = file_name_for_frame_and_level("normals", frameIdx, LEVEL);
-        vector<Vector3f> normals_for_frame;
-        process_file_by_lines(file_name, [&](
-                const string &line) {
-            Vector3f v = string_to_vec3f(line);
-            normals_for_frame.push_back(v);
-        });
-        normals.push_back(normals_for_frame);
+        normals.push_back(read_vec3f_text_file_cached(file_name));
 
         file_name = file_name_for_frame_and_level("pointcloud", frameIdx, LEVEL);
-        vector<Vector3f> positions_for_frame;
-        process_file_by_lines(file_name, [&](
-                const string &line) {
-            Vector3f v = string_to_vec3f(line);
-            positions_for_frame.push_back(v);
-        });
-        surfel_locations.push_back(positions_for_frame);
+        surfel_locations.push_back(read_vec3f_text_file_cached(file_name));
 
         file_name = file_name_for_frame_and_level("pifs", frameIdx, LEVEL);
         size_t line_no = 0;
-        process_file_by_lines(file_name, [&](
-                const string &line) {
-            auto values = line.substr(1, line.size() - 2);
-            auto coords = split(values, ',');
-            unsigned int px = stoi(coords[0]);
-            unsigned int py = stoi(coords[1]);
-            pifs.emplace(PixelInFrame{px, py, frameIdx}, line_no);
+        for (const auto &coords: read_uint_pair_text_file(file_name)) {
+            pifs.emplace(PixelInFrame{coords.first, coords.second, frameIdx}, line_no);
             ++line_no;
-        });
+        }
     }
 
     // Load path data
@@ -5,9 +5,7 @@
 #include <Surfel/Surfel_IO.h>
 #include <Surfel/SurfelGraph.h>
 #include <Quad/Quad.h>
-#include <Graph/CycleExtractor.h>
-#include <map>
-#include <set>
+#include <GeomFileUtils/PlyFileParser.h>
 #include <fstream>
 #include <Eigen/Geometry>
 #include <tclap/CmdLine.h>
@@ -20,118 +18,28 @@ struct Args {
   float rho;
 };
 
-void save_ply_header(const std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>> &graph,
-                     const std::string &file_name,
-                     bool binary = true,
-                     bool little_endian = true) {
-  using namespace std;
-  using namespace Eigen;
-
-  // Save as PLY
-  map<shared_ptr<animesh::Graph<Vector3f, EdgeType>::GraphNode>, int> node_id_to_vertex_index;
-  ofstream output_file(file_name, ios::out);
-  output_file << "ply" << endl;
-  if (binary) {
-    output_file << "format binary_";
-    if (little_endian) {
-      output_file << "little";
-    } else {
-      output_file << "big";
-    }
-    output_file << "_endian 1.0" << endl;
-  } else {
-    output_file << "format ascii 1.0" << endl;
-  }
-  output_file << "element vertex " << graph->num_nodes() << endl;
-  output_file << "property float x" << endl;
-  output_file << "property float y" << endl;
-  output_file << "property float z" << endl;
-  output_file << "element edge " << graph->num_edges() << endl;
-  output_file << "property int vertex1" << endl;
-  output_file << "property int vertex2" << endl;
-  output_file << "property uchar red" << endl;
-  output_file << "property uchar green" << endl;
-  output_file << "property uchar blue" << endl;
-  output_file << "end_header" << endl;
-  output_file.close();
-}
-
-void save_ply_body_as_bin(const std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>> &graph,
-                          const std::string &file_name) {
-  using namespace std;
-  using namespace Eigen;
-
-  int vertex_index = 0;
-  ofstream output_file{file_name, ios_base::app | ios::binary};
-  map<const shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>::GraphNode>, int> node_id_to_vertex_index;
-  for (const auto &node: graph->nodes()) {
-    node_id_to_vertex_index.insert({node, vertex_index});
-    float x = node->data().location[0];
-    float y = node->data().location[1];
-    float z = node->data().location[2];
-    output_file.write(reinterpret_cast<char *>(&x), 4);
-    output_file.write(reinterpret_cast<char *>(&y), 4);
-    output_file.write(reinterpret_cast<char *>(&z), 4);
-    vertex_index++;
-  }
-  for (const auto &edge: graph->edges()) {
-    int from = node_id_to_vertex_index.at(edge.from());
-    int to = node_id_to_vertex_index.at(edge.to());
-    output_file.write(reinterpret_cast<char *>(&from), 4);
-    output_file.write(reinterpret_cast<char *>(&to), 4);
-    unsigned char blue_red[]{0, 0, 255, 0, 0};
-    if (*edge.data() == EDGE_TYPE_RED) {
-      output_file.write(reinterpret_cast<char *>(blue_red + 2), 3);
-    } else {
-      output_file.write(reinterpret_cast<char *>(blue_red), 3);
-    }
-  }
-  output_file.close();
-}
-
-void save_ply_body_as_ascii(const std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>> &graph,
-                            const std::string &file_name) {
-  using namespace std;
-  using namespace Eigen;
-
-  ofstream output_file{file_name, ios_base::app};
-  map<const shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>::GraphNode>, int> node_id_to_vertex_index;
-  int vertex_index = 0;
-  for (const auto &node: graph->nodes()) {
-    node_id_to_vertex_index.insert({node, vertex_index});
-    output_file <<
-                node->data().location[0] << " " <<
-                node->data().location[1] << " " <<
-                node->data().location[2] << endl;
-    vertex_index++;
-  }
-  for (const auto &edge: graph->edges()) {
-    output_file << node_id_to_vertex_index.at(edge.from())
-                << " "
-                << node_id_to_vertex_index.at(edge.to())
-                << " ";
-    if (*edge.data() == EDGE_TYPE_RED) {
-      output_file << "255 0 0" << endl;
-    } else {
-      output_file << "0 0 255" << endl;
-    }
-  }
-}
-
-void save_as_ply(const std::shared_ptr<animesh::Graph<ConsensusGraphVertex, EdgeType>> &graph,
+void save_as_ply(const IndexedConsensusGraph &graph,
                  const std::string &file_name,
                  bool binary = true,
                  bool little_endian = true) {
-  using namespace std;
   using namespace Eigen;
 
-  save_ply_header(graph, file_name, binary, little_endian);
+  animesh::PlyMesh mesh;
+  mesh.vertices.resize((Index) graph.vertices.size(), 3);
+  for (size_t i = 0; i < graph.vertices.size(); ++i) {
+    mesh.vertices.row((Index) i) = graph.vertices[i].location.transpose();
+  }
 
-  if (!binary) {
-    save_ply_body_as_ascii(graph, file_name);
-  } else {
-    save_ply_body_as_bin(graph, file_name);
+  // Red edges are drawn red and blue edges blue
+  mesh.edges = graph.edges;
+  for (const auto edge_type: graph.edge_types) {
+    if (edge_type == EDGE_TYPE_RED) {
+      mesh.edge_colours.push_back({255, 0, 0});
+    } else {
+      mesh.edge_colours.push_back({0, 0, 255});
+    }
   }
+  animesh::PlyFileParser::write_mesh(file_name, mesh, binary, little_endian);
 }
 
 Args
@@ -190,35 +98,24 @@ int main(int argc, char *argv[]) {
 
   // Make an interim graph per frame
   for (auto frame_index = 0; frame_index < get_num_frames(graph); ++frame_index) {
-    auto out_graph = build_consensus_graph(graph, frame_index, args.rho);
-    collapse(out_graph);
+    const auto out_graph = collapse(build_indexed_consensus_graph(graph, frame_index, args.rho));
 
     // Extract the mesh
-    vector<Vector3f> vertices;
-    set<pair<int, int>> edges;
-    set<tuple<int, int, int, int>> faces;
-    set<vector<ConsensusGraphNodePtr>> cycles;
-    animesh::CycleExtractor<ConsensusGraphVertex, EdgeType> ce;
-    ce.extract_cycles(out_graph, cycles);
+    vector<uint32_t> face_offsets;
+    vector<uint32_t> face_vertices;
+    extract_faces(out_graph, face_offsets, face_vertices);
 
     const auto file_name = args.save_file_name + to_string(frame_index + 1) + ".obj";
     ofstream output_file{file_name, ios_base::app};
 
-    std::map<string, int> name_to_index;
-    int vertex_id = 0;
-    for (const auto &n: out_graph->nodes()) {
-      output_file << "v " << n->data().location[0] << " " << n->data().location[1] << " " << n->data().location[2]
-                  << endl;
-      name_to_index.emplace(n->data().surfel_id, ++vertex_id);
+    for (const auto &v: out_graph.vertices) {
+      output_file << "v " << v.location[0] << " " << v.location[1] << " " << v.location[2] << endl;
     }
 
-    for (const auto &c: cycles) {
-      if (c.size() > 4) {
-        continue;
-      }
+    for (size_t f = 0; f + 1 < face_offsets.size(); ++f) {
       output_file << "f ";
-      for (const auto &v: c) {
-        output_file << name_to_index[v->data().surfel_id] << " ";
+      for (auto i = face_offsets[f]; i < face_offsets[f + 1]; ++i) {
+        output_file << face_vertices[i] + 1 << " ";
       }
       output_file << endl;
     }